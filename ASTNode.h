@@ -6,11 +6,13 @@
 
 namespace sql {
 
-    /// A simple binary comparison expression, e.g. age >= 18
+    /// A simple binary comparison expression, e.g. age >= 18, or a
+    /// membership test, e.g. id IN (1, 2, 3)
     struct Expression {
         std::string lhs;   // left side, e.g. column name
-        std::string op;    // operator: =, !=, <, <=, >, >=
-        std::string rhs;   // right side, e.g. value or column
+        std::string op;    // operator: =, !=, <, <=, >, >=, IN
+        std::string rhs;   // right side, e.g. value or column (unused for IN)
+        std::vector<std::string> list;  // IN: the listed values
     };
 
     /// Base class for all AST nodes
@@ -23,7 +25,9 @@ namespace sql {
             Update,
             Delete,
             Transaction,
-           
+            Reindex,
+            Vacuum,
+            Copy,
         };
 
         explicit ASTNode(NodeType t) : type(t) {}
@@ -35,7 +39,8 @@ namespace sql {
         NodeType type;
     };
 
-    /// AST for: SELECT col1, col2 FROM table [ WHERE expr ]
+    /// AST for: SELECT col1, col2 FROM table [ WHERE expr ] [ ORDER BY col [ASC|DESC] ]
+    ///          [ LIMIT n ]
     class SelectNode : public ASTNode {
     public:
         SelectNode() : ASTNode(NodeType::Select) {}
@@ -43,16 +48,19 @@ namespace sql {
         std::vector<std::string> columns;      // list of column names or {"*"}
         std::string              table;        // table name
         std::optional<Expression> whereClause; // optional WHERE
+        std::string              orderBy;      // ORDER BY column, empty if none
+        bool                     descending = false;  // ORDER BY ... DESC
+        long                     limit = -1;   // LIMIT n, -1 if none
     };
 
-    /// AST for: INSERT INTO table [(col1,...)] VALUES (v1,...)
+    /// AST for: INSERT INTO table [(col1,...)] VALUES (v1,...)[, (v1,...) ...]
     class InsertNode : public ASTNode {
     public:
         InsertNode() : ASTNode(NodeType::Insert) {}
 
-        std::string              table;
-        std::vector<std::string> columns;  // may be empty => all columns
-        std::vector<std::string> values;   // each literal/value
+        std::string                           table;
+        std::vector<std::string>              columns;  // may be empty => all columns
+        std::vector<std::vector<std::string>> rows;     // one literal list per row
     };
 
     /// AST for: UPDATE table SET col=val[, ...] [ WHERE expr ]
@@ -71,8 +79,11 @@ namespace sql {
         std::string table;
         // list of (colName, colType)
         std::vector<std::pair<std::string, std::string>> columns;
-        // optional list of PK columns
+        // optional list of PK columns, "col:hash" / "col:art" for USING, then
+        // "+inc" per INCLUDE column
         std::vector<std::string> primaryKeys;
+        // "pax" for a trailing USING PAX, else empty (row storage)
+        std::string storage;
     };
 
     /// AST for: DELETE FROM table [ WHERE expr ]
@@ -84,6 +95,31 @@ namespace sql {
         std::optional<Expression> whereClause;
     };
 
+    /// AST for: REINDEX table
+    class ReindexNode : public ASTNode {
+    public:
+        ReindexNode() : ASTNode(NodeType::Reindex) {}
+
+        std::string table;
+    };
+
+    /// AST for: VACUUM table
+    class VacuumNode : public ASTNode {
+    public:
+        VacuumNode() : ASTNode(NodeType::Vacuum) {}
+
+        std::string table;
+    };
+
+    /// AST for: COPY table FROM 'file.csv'
+    class CopyNode : public ASTNode {
+    public:
+        CopyNode() : ASTNode(NodeType::Copy) {}
+
+        std::string table;
+        std::string path;   // without the quotes
+    };
+
     /// AST for transaction control: BEGIN; COMMIT; or ROLLBACK;
     class TransactionNode : public ASTNode {
     public:
@@ -73,7 +73,8 @@ void LRUCache::clearAll() {
 char* LRUCache::getPage(
     const std::string& filePath,
     uint32_t        pageNum,
-    std::function<void(const BMKey&, char*)> readFromDisk)
+    std::function<void(const BMKey&, char*)> readFromDisk,
+    std::function<void(const BMKey&, char*)> writeToDisk)
 {
     BMKey key{ filePath, pageNum };
 
@@ -97,13 +98,9 @@ char* LRUCache::getPage(
             return nullptr;
         }
 
-        // If it was dirty, write it back
+        // If it was dirty, write it back before the frame is reused
         if (node->dirty) {
-        writeFromDisk:;  // (dummy label)
-            // We need a way to call writeToDisk; 
-            // but writeToDisk is provided by the higher?level BufferManager,
-            // so itll actually supply the correct function. Here, we just comment:
-           //  writeToDisk(node->key, node->data);
+            writeToDisk(node->key, node->data);
         }
         node->dirty = false;
         node->pinCount = 0;
@@ -171,6 +168,45 @@ void LRUCache::flushAll(std::function<void(const BMKey&, char*)> writeToDisk) {
     }
 }
 
+/// Drop frames at or beyond fromPage for one file (used when it is truncated)
+void LRUCache::discardFrom(const std::string& filePath, uint32_t fromPage) {
+    FrameNode* cur = head;
+    while (cur) {
+        FrameNode* nxt = cur->next;
+        if (cur->key.filePath == filePath && cur->key.pageNum >= fromPage) {
+            if (cur->pinCount == 0) {
+                detach(cur);
+                mp.erase(cur->key);
+                delete cur;
+            }
+            else {
+                cur->dirty = false;
+            }
+        }
+        cur = nxt;
+    }
+}
+
+/// Drop the frames of every file under dir (used when a table is deleted)
+void LRUCache::discardUnder(const std::string& dir) {
+    const std::string prefix = dir + "/";
+    FrameNode* cur = head;
+    while (cur) {
+        FrameNode* nxt = cur->next;
+        if (cur->key.filePath.compare(0, prefix.size(), prefix) == 0) {
+            if (cur->pinCount == 0) {
+                detach(cur);
+                mp.erase(cur->key);
+                delete cur;
+            }
+            else {
+                cur->dirty = false;
+            }
+        }
+        cur = nxt;
+    }
+}
+
 /// Print contents of this cache (from head=MRU to tail=LRU)
 void LRUCache::printCache(const std::string& label) {
     std::cout << "--- " << label << " (capacity=" << cap << ") ---\n";
@@ -242,17 +278,14 @@ char* BufferManager::getPage(const std::string& filePath,
     uint32_t        pageNum,
     PageType        type)
 {
-    std::cout << "inside get page" << std::endl;
-    std::cout << filePath << " " << pageNum << " "  << std::endl;
     std::lock_guard<std::mutex> guard(mtx);
-    std::cout << "check 4" << std::endl;
     switch (type) {
     case PageType::DATA:
-        return dataCache.getPage(filePath, pageNum, readPageFromDisk);
+        return dataCache.getPage(filePath, pageNum, readPageFromDisk, writePageToDisk);
     case PageType::INDEX:
-        return indexCache.getPage(filePath, pageNum, readPageFromDisk);
+        return indexCache.getPage(filePath, pageNum, readPageFromDisk, writePageToDisk);
     case PageType::META:
-        return metaCache.getPage(filePath, pageNum, readPageFromDisk);
+        return metaCache.getPage(filePath, pageNum, readPageFromDisk, writePageToDisk);
     }
     return nullptr;
 }
@@ -304,6 +337,33 @@ void BufferManager::flushAll() {
     metaCache.flushAll(writePageToDisk);
 }
 
+/// Forget cached pages past the new end of a truncated file
+void BufferManager::discardPages(const std::string& filePath,
+    uint32_t        fromPage,
+    PageType        type)
+{
+    std::lock_guard<std::mutex> guard(mtx);
+    switch (type) {
+    case PageType::DATA:
+        dataCache.discardFrom(filePath, fromPage);
+        break;
+    case PageType::INDEX:
+        indexCache.discardFrom(filePath, fromPage);
+        break;
+    case PageType::META:
+        metaCache.discardFrom(filePath, fromPage);
+        break;
+    }
+}
+
+/// Forget cached pages of a directory that is being deleted
+void BufferManager::discardDirectory(const std::string& dir) {
+    std::lock_guard<std::mutex> guard(mtx);
+    dataCache.discardUnder(dir);
+    indexCache.discardUnder(dir);
+    metaCache.discardUnder(dir);
+}
+
 /// Print the status of all three LRU caches
 void BufferManager::printCacheStatus() {
     std::lock_guard<std::mutex> guard(mtx);
@@ -76,10 +76,12 @@ public:
     }
 
     /// Pin (or load) the page. Returns its 4 KB buffer (or nullptr if no free frame).
+    /// A dirty victim is written back through writeToDisk before its frame is reused.
     char* getPage(
         const std::string& filePath,
         uint32_t        pageNum,
-        std::function<void(const BMKey&, char*)> readFromDisk);
+        std::function<void(const BMKey&, char*)> readFromDisk,
+        std::function<void(const BMKey&, char*)> writeToDisk);
 
     /// Unpin a page; if isDirty, mark it so.
     void unpinPage(
@@ -97,6 +99,12 @@ public:
     void flushAll(
         std::function<void(const BMKey&, char*)> writeToDisk);
 
+    /// Drop every frame of filePath with pageNum >= fromPage without writing it.
+    void discardFrom(const std::string& filePath, uint32_t fromPage);
+
+    /// Drop every frame of every file under directory `dir` without writing it.
+    void discardUnder(const std::string& dir);
+
     /// Print contents of this LRU cache (for debugging).
     void printCache(const std::string& label);
 
@@ -157,6 +165,18 @@ public:
     /// Flush all dirty pages in all three partitions back to disk.
     void flushAll();
 
+    /// Forget cached pages of filePath from fromPage on (file is being truncated).
+    /// Pinned frames are kept but marked clean so they never extend the file again.
+    void discardPages(
+        const std::string& filePath,
+        uint32_t        fromPage,
+        PageType        type);
+
+    /// Forget cached pages of every file under directory `dir`, in all three
+    /// partitions (the directory is being deleted).  Pinned frames are kept
+    /// but marked clean, as in discardPages.
+    void discardDirectory(const std::string& dir);
+
     /// Print status of all three caches (for debugging).
     void printCacheStatus();
 
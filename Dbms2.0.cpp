@@ -9,6 +9,8 @@
 
 #include "table_manager.h"
 #include "record_manager.h"
+#include "table_handle.h"
+#include "vacuum.h"
 #include "BufferManager.h"
 
 #include "LockManager.h"
@@ -81,7 +83,10 @@ int main() {
             // shut down flusher
             keepRunning = false;
             if (flusher.joinable()) flusher.join();
-            // final flush
+            // stop a background VACUUM between steps
+            Vacuum::stop();
+            // close open tables (index headers), then final flush
+            TableHandle::closeAll();
             bufferManager.flushAll();
             std::cout << "Exiting.\n";
             return 0;
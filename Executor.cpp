@@ -1,10 +1,14 @@
 ﻿// File: Executor.cpp
 #include "Executor.h"
 #include "record_manager_sql.h"
+#include "QueryPlanner.h"
 #include "table_manager.h"
+#include "vacuum.h"
 #include "Schema.h"
+#include <algorithm>
 #include <iostream>
 #include <iomanip>
+#include <cstdlib>
 
 using namespace sql;
 
@@ -35,54 +39,175 @@ void Executor::execute(const AST& ast) {
     case ASTNode::NodeType::Create:
         execCreate(*static_cast<const CreateNode*>(ast.get()));
         break;
+    case ASTNode::NodeType::Reindex:
+        execReindex(*static_cast<const ReindexNode*>(ast.get()));
+        break;
+    case ASTNode::NodeType::Vacuum:
+        execVacuum(*static_cast<const VacuumNode*>(ast.get()));
+        break;
+    case ASTNode::NodeType::Copy:
+        execCopy(*static_cast<const CopyNode*>(ast.get()));
+        break;
+    }
+}
+
+namespace {
+
+    /// Print the selected columns of a row, in SELECT order.
+    void printRow(const Row& r, const std::vector<int>& projection) {
+        for (int col : projection) std::cout << r[col] << " ";
+        std::cout << "\n";
+    }
+
+    /// WHERE / ORDER BY comparison: numeric if both sides parse as numbers,
+    /// byte-wise otherwise.
+    int compareValues(const std::string& value, const std::string& rhs) {
+        char* endL = nullptr;
+        char* endR = nullptr;
+        double l = std::strtod(value.c_str(), &endL);
+        double r = std::strtod(rhs.c_str(), &endR);
+        if (!value.empty() && !rhs.empty() && *endL == '\0' && *endR == '\0') {
+            return (l > r) - (l < r);
+        }
+        int cmp = value.compare(rhs);
+        return (cmp > 0) - (cmp < 0);
+    }
+
+    bool matches(const std::string& value, const std::string& op, const std::string& rhs) {
+        int cmp = compareValues(value, rhs);
+        if (op == "=")  return cmp == 0;
+        if (op == "!=") return cmp != 0;
+        if (op == "<")  return cmp < 0;
+        if (op == "<=") return cmp <= 0;
+        if (op == ">")  return cmp > 0;
+        if (op == ">=") return cmp >= 0;
+        return true;
+    }
+
+    /// Whole WHERE expression; IN holds if any listed value is equal.
+    bool matches(const std::string& value, const Expression& e) {
+        if (e.op != "IN") return matches(value, e.op, e.rhs);
+        return std::any_of(e.list.begin(), e.list.end(),
+            [&](const std::string& v) { return matches(value, "=", v); });
     }
 }
 
 void Executor::execSelect(const SelectNode& s) {
-    if (!s.whereClause) {
-        auto rows = RecordManagerSQL::scanAll(s.table);
-        for (auto& r : rows) {
-            for (auto& v : r) std::cout << v << " ";
-            std::cout << "\n";
+    AccessPath path = QueryPlanner::plan(s);
+    std::cout << "[PLAN] " << QueryPlanner::describe(path) << "\n";
+    for (size_t i = 0; i < path.projection.size(); ++i) {
+        if (path.projection[i] < 0) {
+            std::cerr << "[EXEC] SELECT: no column '" << s.columns[i] << "' in "
+                << s.table << "\n";
+            return;
         }
+    }
+    if (!s.orderBy.empty() && path.orderColumn < 0) {
+        std::cerr << "[EXEC] SELECT: no column '" << s.orderBy << "' in " << s.table << "\n";
         return;
     }
 
-    auto& expr = *s.whereClause;
-    if (expr.op == "=") {
-        if (auto opt = RecordManagerSQL::findRecord(s.table, expr.lhs, expr.rhs)) {
-            for (auto& v : *opt) std::cout << v << " ";
-            std::cout << "\n";
+    // Only the columns the statement looks at are decoded, and long text is
+    // read from the overflow file only for those.
+    ColumnMask needed;
+    for (int col : path.projection) {
+        if (col >= static_cast<int>(needed.size())) needed.resize(col + 1);
+        needed[col] = true;
+    }
+    for (int col : { path.column, path.orderColumn }) {
+        if (col < 0) continue;
+        if (col >= static_cast<int>(needed.size())) needed.resize(col + 1);
+        needed[col] = true;
+    }
+
+    // Lookups (and index-only reads) come back whole; ranges and scans are
+    // pulled through a cursor, so unless they must be sorted, rows print as
+    // they are read and memory stays at one page or index batch.
+    Rows rows;
+    std::unique_ptr<RowCursor> cursor;
+    bool filter = false;   // the cursor's rows still need the WHERE test
+    switch (path.kind) {
+    case AccessPath::Kind::IndexLookup: {
+        const auto& expr = *s.whereClause;
+        if (path.indexOnly) {
+            // Covering index: the rows come straight from the leaves.
+            std::vector<std::string> values = expr.op == "IN" ? expr.list
+                : std::vector<std::string>{ expr.rhs };
+            rows = RecordManagerSQL::findRecordsIndexOnly(s.table, expr.lhs, values);
+        }
+        else if (expr.op == "IN") {
+            rows = RecordManagerSQL::findRecords(s.table, expr.lhs, expr.list, needed);
         }
+        else if (auto opt = RecordManagerSQL::findRecord(s.table, expr.lhs, expr.rhs, needed)) {
+            rows.push_back(std::move(*opt));
+        }
+        break;
     }
-    else if (expr.op == ">=") {
-        auto rows = RecordManagerSQL::scanGreaterEqual(s.table, expr.lhs, expr.rhs);
-        for (auto& r : rows) {
-            for (auto& v : r) std::cout << v << " ";
-            std::cout << "\n";
+    case AccessPath::Kind::IndexRange: {
+        // An ordered walk only needs the first LIMIT keys from its end.
+        const std::size_t limit = path.ordered && s.limit >= 0
+            ? static_cast<std::size_t>(s.limit) : 0;
+        if (path.ordered && s.limit == 0) break;
+        if (path.indexOnly) {
+            rows = RecordManagerSQL::scanBetweenIndexOnly(s.table, path.field, path.low, path.high,
+                path.descending, limit);
         }
+        else {
+            cursor = RecordManagerSQL::openRange(s.table, path.field, path.low, path.high,
+                path.descending, limit, needed);
+        }
+        break;
     }
-    else if (expr.op == "<=") {
-        auto rows = RecordManagerSQL::scanLessEqual(s.table, expr.lhs, expr.rhs);
-        for (auto& r : rows) {
-            for (auto& v : r) std::cout << v << " ";
-            std::cout << "\n";
+    case AccessPath::Kind::FullScan: {
+        if (s.whereClause && path.column >= 0) {
+            // Compared in the pages against the stored values, when it can be.
+            const auto& expr = *s.whereClause;
+            cursor = RecordManagerSQL::openScanWhere(s.table, expr.lhs, expr.op,
+                expr.op == "IN" ? expr.list : std::vector<std::string>{ expr.rhs }, needed);
+            filter = !cursor;
         }
+        if (!cursor) cursor = RecordManagerSQL::openScan(s.table, needed);
+        break;
     }
-    else {
-        auto rows = RecordManagerSQL::scanAll(s.table);
-        for (auto& r : rows) {
-            for (auto& v : r) std::cout << v << " ";
-            std::cout << "\n";
+    }
+
+    const bool sort = !s.orderBy.empty() && !path.ordered;
+    if (cursor) {
+        long printed = 0;
+        Row r;
+        while ((sort || s.limit < 0 || printed < s.limit) && cursor->next(r)) {
+            if (filter && !matches(r[path.column], *s.whereClause)) continue;
+            if (sort) {
+                rows.push_back(std::move(r));
+                continue;
+            }
+            printRow(r, path.projection);
+            ++printed;
         }
+        cursor->close();
+        if (!sort) return;
     }
+
+    if (sort) {
+        const int col = path.orderColumn;
+        std::stable_sort(rows.begin(), rows.end(), [&](const Row& a, const Row& b) {
+            int cmp = compareValues(a[col], b[col]);
+            return s.descending ? cmp > 0 : cmp < 0;
+        });
+    }
+    if (s.limit >= 0 && rows.size() > static_cast<std::size_t>(s.limit)) {
+        rows.resize(static_cast<std::size_t>(s.limit));
+    }
+    for (auto& r : rows) printRow(r, path.projection);
 }
 
 void Executor::execInsert(const InsertNode& ins) {
     std::cout << "[EXEC] INSERT into " << ins.table << "\n";
-    long off = RecordManagerSQL::insertRecord(ins.table, ins.values);
-    if (off < 0) std::cerr << "[EXEC] INSERT failed\n";
-    else         std::cout << "[EXEC] INSERT at offset " << off << "\n";
+    std::vector<long> offs = RecordManagerSQL::insertRecords(ins.table, ins.rows);
+    for (long off : offs) {
+        if (off < 0) std::cerr << "[EXEC] INSERT failed\n";
+        else         std::cout << "[EXEC] INSERT at offset " << off << "\n";
+    }
 }
 
 void Executor::execUpdate(const UpdateNode& upd) {
@@ -132,6 +257,36 @@ void Executor::execTransaction(const TransactionNode& t) {
     }
 }
 
+void Executor::execReindex(const ReindexNode& r) {
+    std::cout << "[EXEC] REINDEX " << r.table << "\n";
+    if (!RecordManagerSQL::reindex(r.table)) {
+        std::cerr << "[EXEC] REINDEX: no such table '" << r.table << "'\n";
+    }
+}
+
+void Executor::execVacuum(const VacuumNode& v) {
+    std::cout << "[EXEC] VACUUM " << v.table << "\n";
+    if (!Vacuum::start(v.table)) {
+        std::cerr << "[EXEC] VACUUM: no such table '" << v.table << "'\n";
+        return;
+    }
+    std::cout << "[EXEC] VACUUM of '" << v.table << "' runs in the background\n";
+}
+
+void Executor::execCopy(const CopyNode& c) {
+    std::cout << "[EXEC] COPY " << c.table << " FROM '" << c.path << "'\n";
+    long rejected = 0;
+    long loaded = RecordManagerSQL::copyFrom(c.table, c.path, rejected);
+    if (loaded < 0) {
+        std::cerr << "[EXEC] COPY: cannot open table '" << c.table << "' or file '"
+            << c.path << "'\n";
+        return;
+    }
+    std::cout << "[EXEC] COPY loaded " << loaded << " rows";
+    if (rejected > 0) std::cout << ", rejected " << rejected;
+    std::cout << "\n";
+}
+
 void Executor::execCreate(const CreateNode& c) {
     std::string schemaStr;
     for (size_t i = 0; i < c.columns.size(); ++i) {
@@ -146,7 +301,7 @@ void Executor::execCreate(const CreateNode& c) {
     }
 
     try {
-        TableManager::createTable(c.table, schemaStr, keysStr);
+        TableManager::createTable(c.table, schemaStr, keysStr, c.storage);
         std::cout << "[EXEC] Table '" << c.table << "' created.\n";
     }
     catch (const std::exception& e) {
@@ -24,6 +24,9 @@ namespace sql {
         void execDelete(const DeleteNode& del);
         void execTransaction(const TransactionNode& t);
         void execCreate(const CreateNode& c);
+        void execReindex(const ReindexNode& r);
+        void execVacuum(const VacuumNode& v);
+        void execCopy(const CopyNode& c);
     };
 
 } // namespace sql
@@ -14,9 +14,13 @@ namespace sql {
         {"WHERE",  TokenType::WHERE},
         {"ORDER",  TokenType::ORDER},
         {"BY",     TokenType::BY},
+        {"ASC",    TokenType::ASC},
+        {"DESC",   TokenType::DESC},
+        {"LIMIT",  TokenType::LIMIT},
         {"INTO",   TokenType::INTO},
         {"VALUES", TokenType::VALUES},
         {"SET",    TokenType::SET},
+        {"IN",     TokenType::IN},
         {"BEGIN",  TokenType::BEGIN},
         {"COMMIT", TokenType::COMMIT},
         {"ROLLBACK", TokenType::ROLLBACK},
@@ -30,6 +34,11 @@ namespace sql {
         { "TABLE",  TokenType::TABLE },   // ←
         { "PRIMARY",TokenType::PRIMARY }, // ←
         { "KEY",    TokenType::KEY },     // ←
+        { "REINDEX", TokenType::REINDEX },
+        { "VACUUM", TokenType::VACUUM },
+        { "COPY",   TokenType::COPY },
+        { "USING",  TokenType::USING },
+        { "INCLUDE", TokenType::INCLUDE },
         {"ON", TokenType::ON}
     };
 
@@ -13,8 +13,8 @@ namespace sql {
 
         // Keywords
         SELECT, INSERT, UPDATE, DELETE_,
-        FROM, WHERE, ORDER, BY,
-        INTO, VALUES, SET,
+        FROM, WHERE, ORDER, BY, ASC, DESC, LIMIT,
+        INTO, VALUES, SET, IN,
         BEGIN, COMMIT, ROLLBACK,
         // joins
         JOIN,       // simple JOIN
@@ -27,8 +27,13 @@ namespace sql {
         // Identifiers & literals
         CREATE,    
         TABLE,     
+        REINDEX,
+        VACUUM,
+        COPY,
         PRIMARY,   
         KEY,       
+        USING,
+        INCLUDE,
         IDENTIFIER,
         NUMERIC_LITERAL,
         STRING_LITERAL,
@@ -2,6 +2,7 @@
 
 #include "Parser.h"
 #include <stdexcept>
+#include <algorithm>
 #include <cctype>
 using namespace sql;
 
@@ -39,6 +40,9 @@ std::unique_ptr<ASTNode> Parser::parseStatement() {
     case TokenType::INSERT:  return parseInsert();
     case TokenType::UPDATE:  return parseUpdate();
     case TokenType::DELETE_: return parseDelete();
+    case TokenType::REINDEX: return parseReindex();
+    case TokenType::VACUUM:  return parseVacuum();
+    case TokenType::COPY:    return parseCopy();
     case TokenType::BEGIN:
     case TokenType::COMMIT:
     case TokenType::ROLLBACK:
@@ -75,6 +79,28 @@ std::unique_ptr<SelectNode> Parser::parseSelect() {
         node->whereClause = parseExpression();
     }
 
+    if (accept(TokenType::ORDER)) {
+        expect(TokenType::BY);
+        if (_cur.type != TokenType::IDENTIFIER) {
+            throw std::runtime_error("Parser error: expected column after ORDER BY at pos "
+                + std::to_string(_cur.position));
+        }
+        node->orderBy = _cur.text;
+        nextToken();
+        if (accept(TokenType::DESC)) node->descending = true;
+        else accept(TokenType::ASC);
+    }
+
+    if (accept(TokenType::LIMIT)) {
+        if (_cur.type != TokenType::NUMERIC_LITERAL
+            || _cur.text.find_first_not_of("0123456789") != std::string::npos) {
+            throw std::runtime_error("Parser error: expected row count after LIMIT at pos "
+                + std::to_string(_cur.position));
+        }
+        node->limit = std::stol(_cur.text);
+        nextToken();
+    }
+
     expect(TokenType::SEMICOLON);
     return node;
 }
@@ -98,23 +124,14 @@ std::unique_ptr<InsertNode> Parser::parseInsert() {
     }
 
     expect(TokenType::VALUES);
-    expect(TokenType::LPAREN);
 
-    // values list
-    while (true) {
-        if (_cur.type != TokenType::STRING_LITERAL
-            && _cur.type != TokenType::NUMERIC_LITERAL)
-        {
-            throw std::runtime_error("Parser error: expected literal at pos "
-                + std::to_string(_cur.position));
-        }
-        node->values.push_back(_cur.text);
-        nextToken();
-        if (accept(TokenType::COMMA)) continue;
-        break;
-    }
+    // one or more parenthesized rows
+    do {
+        expect(TokenType::LPAREN);
+        node->rows.push_back(parseLiteralList());
+        expect(TokenType::RPAREN);
+    } while (accept(TokenType::COMMA));
 
-    expect(TokenType::RPAREN);
     expect(TokenType::SEMICOLON);
     return node;
 }
@@ -144,22 +161,69 @@ std::unique_ptr<CreateNode> Parser::parseCreate() {
         }
         std::string colType = _cur.text;
         nextToken();
+        if (accept(TokenType::LPAREN)) {  // char(N)
+            if (_cur.type != TokenType::NUMERIC_LITERAL) {
+                throw std::runtime_error("Parser error: expected column width at pos " +
+                    std::to_string(_cur.position));
+            }
+            colType += "(" + _cur.text + ")";
+            nextToken();
+            expect(TokenType::RPAREN);
+        }
 
         node->columns.emplace_back(colName, colType);
 
         if (!accept(TokenType::COMMA)) break;
     }
 
-    // Handle optional PRIMARY KEY(...)
+    // Handle optional PRIMARY KEY(col [USING HASH|BTREE] [INCLUDE (col, ...)], ...)
     if (_cur.type == TokenType::PRIMARY) {
         nextToken();
         expect(TokenType::KEY);
         expect(TokenType::LPAREN);
-        node->primaryKeys = parseIdentifierList();
+        while (true) {
+            if (_cur.type != TokenType::IDENTIFIER) {
+                throw std::runtime_error("Parser error: expected identifier at pos "
+                    + std::to_string(_cur.position));
+            }
+            std::string key = _cur.text;
+            nextToken();
+            if (accept(TokenType::USING)) {
+                std::string kind = _cur.text;
+                std::transform(kind.begin(), kind.end(), kind.begin(),
+                    [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+                if (_cur.type != TokenType::IDENTIFIER || (kind != "hash" && kind != "art" && kind != "btree")) {
+                    throw std::runtime_error("Parser error: expected HASH, ART or BTREE at pos "
+                        + std::to_string(_cur.position));
+                }
+                nextToken();
+                if (kind != "btree") key += ":" + kind;  // meta.txt spelling
+            }
+            if (accept(TokenType::INCLUDE)) {
+                expect(TokenType::LPAREN);
+                for (const auto& col : parseIdentifierList()) key += "+" + col;  // meta.txt spelling
+                expect(TokenType::RPAREN);
+            }
+            node->primaryKeys.push_back(key);
+            if (!accept(TokenType::COMMA)) break;
+        }
         expect(TokenType::RPAREN);
     }
 
     expect(TokenType::RPAREN);
+
+    // Optional USING PAX|ROW: how data.tbl lays out its pages
+    if (accept(TokenType::USING)) {
+        std::string storage = _cur.text;
+        std::transform(storage.begin(), storage.end(), storage.begin(),
+            [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        if (_cur.type != TokenType::IDENTIFIER || (storage != "pax" && storage != "row")) {
+            throw std::runtime_error("Parser error: expected PAX or ROW at pos "
+                + std::to_string(_cur.position));
+        }
+        nextToken();
+        if (storage == "pax") node->storage = storage;  // meta.txt spelling
+    }
     expect(TokenType::SEMICOLON);
 
     return node;
@@ -231,6 +295,59 @@ std::unique_ptr<DeleteNode> Parser::parseDelete() {
     return node;
 }
 
+std::unique_ptr<VacuumNode> Parser::parseVacuum() {
+    auto node = std::make_unique<VacuumNode>();
+    expect(TokenType::VACUUM);
+
+    if (_cur.type != TokenType::IDENTIFIER) {
+        throw std::runtime_error("Parser error: expected table name at pos "
+            + std::to_string(_cur.position));
+    }
+    node->table = _cur.text;
+    nextToken();
+
+    expect(TokenType::SEMICOLON);
+    return node;
+}
+
+std::unique_ptr<ReindexNode> Parser::parseReindex() {
+    auto node = std::make_unique<ReindexNode>();
+    expect(TokenType::REINDEX);
+
+    if (_cur.type != TokenType::IDENTIFIER) {
+        throw std::runtime_error("Parser error: expected table name at pos "
+            + std::to_string(_cur.position));
+    }
+    node->table = _cur.text;
+    nextToken();
+
+    expect(TokenType::SEMICOLON);
+    return node;
+}
+
+std::unique_ptr<CopyNode> Parser::parseCopy() {
+    auto node = std::make_unique<CopyNode>();
+    expect(TokenType::COPY);
+
+    if (_cur.type != TokenType::IDENTIFIER) {
+        throw std::runtime_error("Parser error: expected table name at pos "
+            + std::to_string(_cur.position));
+    }
+    node->table = _cur.text;
+    nextToken();
+
+    expect(TokenType::FROM);
+    if (_cur.type != TokenType::STRING_LITERAL || _cur.text.size() < 2) {
+        throw std::runtime_error("Parser error: expected a quoted file name at pos "
+            + std::to_string(_cur.position));
+    }
+    node->path = _cur.text.substr(1, _cur.text.size() - 2);
+    nextToken();
+
+    expect(TokenType::SEMICOLON);
+    return node;
+}
+
 std::unique_ptr<TransactionNode> Parser::parseTransaction() {
     TransactionNode::Action act;
     if (accept(TokenType::BEGIN)) {
@@ -270,8 +387,24 @@ std::vector<std::string> Parser::parseIdentifierList() {
     return ids;
 }
 
+std::vector<std::string> Parser::parseLiteralList() {
+    std::vector<std::string> values;
+    while (true) {
+        if (_cur.type != TokenType::STRING_LITERAL
+            && _cur.type != TokenType::NUMERIC_LITERAL)
+        {
+            throw std::runtime_error("Parser error: expected literal at pos "
+                + std::to_string(_cur.position));
+        }
+        values.push_back(_cur.text);
+        nextToken();
+        if (!accept(TokenType::COMMA)) break;
+    }
+    return values;
+}
+
 Expression Parser::parseExpression() {
-    // very simple: lhs op rhs  (no parentheses, no AND/OR)
+    // very simple: lhs op rhs, or lhs IN (v1, ...)  (no AND/OR)
     Expression e;
     if (_cur.type != TokenType::IDENTIFIER) {
         throw std::runtime_error("Parser error: expected identifier in expression at pos "
@@ -280,6 +413,14 @@ Expression Parser::parseExpression() {
     e.lhs = _cur.text;
     nextToken();
 
+    if (accept(TokenType::IN)) {
+        e.op = "IN";
+        expect(TokenType::LPAREN);
+        e.list = parseLiteralList();
+        expect(TokenType::RPAREN);
+        return e;
+    }
+
     // operator
     switch (_cur.type) {
     case TokenType::EQ:  e.op = "=";  break;
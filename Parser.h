@@ -38,12 +38,18 @@ namespace sql {
         std::unique_ptr<DeleteNode>     parseDelete();
         std::unique_ptr<TransactionNode> parseTransaction();
         std::unique_ptr<CreateNode> parseCreate();
+        std::unique_ptr<ReindexNode> parseReindex();
+        std::unique_ptr<VacuumNode> parseVacuum();
+        std::unique_ptr<CopyNode> parseCopy();
 
         // Helpers:
         /// Parse a comma‐separated list of identifiers.
         std::vector<std::string> parseIdentifierList();
 
-        /// Parse a simple expression of form `lhs op rhs`
+        /// Parse a comma-separated list of string/numeric literals.
+        std::vector<std::string> parseLiteralList();
+
+        /// Parse a simple expression of form `lhs op rhs` or `lhs IN (...)`
         Expression parseExpression();
     };
 
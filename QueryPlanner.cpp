@@ -1 +1,127 @@
 #include "QueryPlanner.h"
+#include "table_handle.h"
+#include "record_manager.h"
+#include "Schema.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+using namespace sql;
+
+AccessPath QueryPlanner::plan(const SelectNode& s) {
+    AccessPath path;
+
+    auto table = TableHandle::open(s.table, *RecordManager::bufMgr);
+    if (!table) return path;
+    const Schema& schema = table->schema;
+    const auto& fields = table->fields;
+    const auto& uniqueKeys = table->uniqueKeys;
+    const IndexManager& idx = table->indexes;
+
+    // Every row carries each unique key exactly once, so any index's key
+    // count is the table's cardinality.
+    long tableRows = -1;
+    BPlusTree::Stats st;
+    if (!uniqueKeys.empty() && idx.getStats(uniqueKeys.front(), st)) {
+        tableRows = st.keyCount;
+    }
+    path.estimatedRows = tableRows;
+
+    std::vector<std::string> selected;
+    for (const auto& col : s.columns) {
+        if (col == "*") {
+            for (const auto& f : fields) selected.push_back(f.name);
+        }
+        else {
+            selected.push_back(col);
+        }
+    }
+    for (const auto& col : selected) {
+        int pos = -1;
+        for (size_t i = 0; i < fields.size(); ++i) {
+            if (fields[i].name == col) pos = static_cast<int>(i);
+        }
+        path.projection.push_back(pos);
+    }
+    auto columnOf = [&](const std::string& name) {
+        for (size_t i = 0; i < fields.size(); ++i) {
+            if (fields[i].name == name) return static_cast<int>(i);
+        }
+        return -1;
+    };
+    auto isKey = [&](const std::string& name) {
+        return std::find(uniqueKeys.begin(), uniqueKeys.end(), name) != uniqueKeys.end();
+    };
+    // A B+ tree orders a number key as a number (see Schema::encodeKey) and
+    // a text key byte-wise, as WHERE compares them, as long as the bound is
+    // of the key's kind: WHERE compares two numbers numerically and a number
+    // with text byte-wise, so a text key with a number bound (or the other
+    // way round) is scanned.
+    auto rangeBound = [&](int column, const std::string& bound) {
+        const Schema::Field& f = fields[column];
+        if (f.kind != Schema::Kind::Char) {
+            std::string bytes;
+            return Schema::encodeValue(f, bound, bytes);
+        }
+        char* end = nullptr;
+        std::strtod(bound.c_str(), &end);
+        return bound.empty() || *end != '\0';
+    };
+    if (!s.orderBy.empty()) path.orderColumn = columnOf(s.orderBy);
+    path.descending = s.descending;
+
+    if (s.whereClause) {
+        const Expression& expr = *s.whereClause;
+        path.field = expr.lhs;
+        path.column = columnOf(expr.lhs);
+
+        if (!isKey(expr.lhs)) {
+            // scan and filter
+        }
+        else if (expr.op == "=") {
+            path.kind = AccessPath::Kind::IndexLookup;
+            path.estimatedRows = tableRows == 0 ? 0 : 1;
+        }
+        else if (expr.op == "IN") {
+            path.kind = AccessPath::Kind::IndexLookup;
+            path.estimatedRows = static_cast<long>(expr.list.size());
+            if (tableRows >= 0) path.estimatedRows = std::min(path.estimatedRows, tableRows);
+        }
+        else if ((expr.op == ">=" || expr.op == "<=") && schema.getIndexType(expr.lhs) != "hash"
+            && rangeBound(path.column, expr.rhs)) {
+            // No histograms: assume an open range keeps a third of the keys.
+            path.kind = AccessPath::Kind::IndexRange;
+            (expr.op == ">=" ? path.low : path.high) = expr.rhs;
+            path.estimatedRows = tableRows < 0 ? -1 : (tableRows + 2) / 3;
+        }
+    }
+    else if (isKey(s.orderBy) && schema.getIndexType(s.orderBy) != "hash") {
+        // No filter but ORDER BY a B+ tree key: walk its whole leaf chain.
+        path.kind = AccessPath::Kind::IndexRange;
+        path.field = s.orderBy;
+        path.column = path.orderColumn;
+    }
+
+    // A range over the ORDER BY key comes out of the leaf chain in order
+    // (backwards for DESC), so LIMIT can stop the walk early.
+    path.ordered = path.kind == AccessPath::Kind::IndexRange && path.field == s.orderBy;
+    if (s.limit >= 0 && (path.estimatedRows < 0 || path.estimatedRows > s.limit)) {
+        path.estimatedRows = s.limit;
+    }
+    path.indexOnly = path.kind != AccessPath::Kind::FullScan && idx.covers(path.field, selected);
+    return path;
+}
+
+std::string QueryPlanner::describe(const AccessPath& path) {
+    std::string out;
+    std::string index = path.indexOnly ? "index-only " : "index ";
+    switch (path.kind) {
+    case AccessPath::Kind::IndexLookup: out = index + "lookup on " + path.field; break;
+    case AccessPath::Kind::IndexRange:  out = index + "range on " + path.field;  break;
+    case AccessPath::Kind::FullScan:    out = "full scan";                       break;
+    }
+    if (path.ordered && path.descending) out += " backward";
+    out += ", est. rows ";
+    out += path.estimatedRows < 0 ? std::string("?") : std::to_string(path.estimatedRows);
+    return out;
+}
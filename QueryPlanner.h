@@ -1,5 +1,44 @@
 #pragma once
-class QueryPlanner
-{
-};
 
+#include "AST.h"
+#include <string>
+#include <vector>
+
+namespace sql {
+
+    /// How execSelect should fetch the rows of one SELECT.
+    struct AccessPath {
+        enum class Kind {
+            IndexLookup,   // '=' or IN on an indexed column: one probe per B+ tree leaf or hash bucket
+            IndexRange,    // '>=' / '<=' on a B+ tree column, or no WHERE and ORDER BY
+                           // one: leaf-chain walk
+            FullScan       // everything else: read data.tbl and filter
+        };
+
+        Kind        kind = Kind::FullScan;
+        std::string field;              // indexed column, or the filtered column for a scan
+        int         column = -1;        // position of 'field' in the schema, -1 if none
+        std::string low, high;          // IndexRange bounds; empty = open
+        int         orderColumn = -1;   // position of the ORDER BY column, -1 if none
+        bool        ordered = false;    // rows come back in ORDER BY order (IndexRange on
+                                        // that key), so no sort is needed
+        bool        descending = false; // ORDER BY ... DESC: an ordered walk runs backwards
+        long        estimatedRows = -1; // -1 = no statistics available
+        bool        indexOnly = false;  // index lookup/range whose index holds every
+                                        // selected column: data.tbl is not read
+        std::vector<int> projection;    // schema positions of the selected columns,
+                                        // -1 for an unknown name; all columns for '*'
+    };
+
+    /// Chooses an access path from the table schema and the statistics kept in
+    /// each index header.  Opening an index only reads its header page, so
+    /// planning costs no more than the lookup it replaces.
+    class QueryPlanner {
+    public:
+        static AccessPath plan(const SelectNode& s);
+
+        /// One-line description for the "[PLAN]" trace.
+        static std::string describe(const AccessPath& path);
+    };
+
+} // namespace sql
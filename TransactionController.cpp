@@ -2,10 +2,12 @@
 
 #include "TransactionController.h"
 #include "record_manager.h"   // for Schema
-#include "index_manager.h"    // for IndexManager
+#include "table_handle.h"     // for TableHandle
+#include "heap_page.h"        // for HeapPage
 #include <iostream>
 #include <fstream>
 #include <limits>
+#include <sstream>
 #include <cstring>
 
 using TransactionID = uint64_t;
@@ -18,18 +20,13 @@ void TransactionController::run(BufferManager& bufMgr, LockManager& lockMgr, WAL
     std::cin >> table;
     std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
 
-    // 2) Load schema & unique keys
-    std::string schemaLine, keysLine;
-    {
-        std::ifstream meta("Tables/" + table + "/meta.txt");
-        if (!meta) {
-            std::cerr << "[Transaction] Table not found: " << table << "\n";
-            return;
-        }
-        std::getline(meta, schemaLine);
-        std::getline(meta, keysLine);
+    // 2) Open the table: schema, unique keys and indexes
+    auto handle = TableHandle::open(table, bufMgr);
+    if (!handle) {
+        std::cerr << "[Transaction] Table not found: " << table << "\n";
+        return;
     }
-    Schema schema(schemaLine, keysLine);
+    const Schema& schema = handle->schema;
 
     // 3) Prompt for the unique‐key field & value
     std::string field, value;
@@ -38,38 +35,84 @@ void TransactionController::run(BufferManager& bufMgr, LockManager& lockMgr, WAL
     std::cout << "Enter its value: ";
     std::cin >> value;
 
-    // 4) Build & load the index for that table
-    IndexManager idxMgr(table, "Tables/" + table, bufMgr);
-    idxMgr.loadIndexes(schema.getUniqueKeys());
+    // 4) The table's indexes are already open
+    IndexManager& idxMgr = handle->indexes;
 
-    // 5) Find the record’s offset via B+ tree
-    long offset = idxMgr.searchIndex(field, value);
-    if (offset < 0) {
+    // 5) Make sure the row is there before asking for its new values; it is
+    //    looked up again once the locks are held
+    if (idxMgr.searchIndex(field, handle->keyOf(field, value)) < 0) {
         std::cerr << "[Transaction] Row not found for "
             << field << "=" << value << "\n";
         return;
     }
 
-    // 6) Read the "before" image by pinning the page
-    auto pageNum = static_cast<uint32_t>(offset / BufferManager::PAGE_SIZE);
+    // 6) Prompt for new comma‐separated values and encode them as stored;
+    //    long text goes to the overflow file.  Nothing is locked or pinned
+    //    while the user types, so other statements and VACUUM go on.
+    std::cout << "Enter new comma-separated values for all fields:\n> ";
+    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    std::string line;
+    std::getline(std::cin, line);
+    std::vector<std::string> values;
+    std::stringstream valueStream(line);
+    for (std::string v; std::getline(valueStream, v, ',');) {
+        v.erase(0, v.find_first_not_of(" \t"));
+        v.erase(v.find_last_not_of(" \t") + 1);
+        values.push_back(v);
+    }
+    std::string afterImage;
+    if (!handle->encode(values, afterImage)) {
+        std::cerr << "[Transaction] Expected " << schema.getFields().size()
+            << " values, each valid for its column, fitting one page\n";
+        return;
+    }
+
+    // 7) Find the record’s offset again and read the "before" image by
+    //    pinning the page.  The record ID must stay the row's until the
+    //    update is done, and the page's layout changes under the FSM lock.
+    std::shared_lock<std::shared_mutex> rowsLock(handle->rowsMtx);
+    long offset = idxMgr.searchIndex(field, handle->keyOf(field, value));
+    if (offset < 0) {
+        std::cerr << "[Transaction] Row was deleted\n";
+        handle->releaseExternal(afterImage);
+        return;
+    }
+    std::lock_guard<std::mutex> fsmLock(handle->freeSpaceMtx);
+    auto pageNum = HeapPage::pageOf(offset);
     char* pageBuf = bufMgr.getPage(
-        "Tables/" + table + "/data.tbl",
+        handle->dataFile,
         pageNum,
         PageType::DATA
     );
     if (!pageBuf) {
         std::cerr << "[Transaction] Cannot pin page " << pageNum << "\n";
+        handle->releaseExternal(afterImage);
+        return;
+    }
+    DataPage page = handle->page(pageBuf);
+    std::string assembled;
+    std::string beforeImage(page.record(HeapPage::slotOf(offset), assembled));
+    if (beforeImage.empty()) {
+        std::cerr << "[Transaction] Row was deleted\n";
+        bufMgr.unpinPage(handle->dataFile, pageNum, PageType::DATA, false);
+        handle->releaseExternal(afterImage);
         return;
     }
-    int recSize = schema.getRecordSize();
-    size_t withinPage = offset % BufferManager::PAGE_SIZE;
-    std::string beforeImage(pageBuf + withinPage, recSize);
 
-    // 7) Prompt for new comma‐separated row image
-    std::cout << "Enter new comma-separated values for all fields:\n> ";
-    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-    std::string afterImage;
-    std::getline(std::cin, afterImage);
+    //     A unique key that changes must be free and fit its index
+    const auto& fields = handle->fields;
+    std::vector<std::string> before = handle->decode(beforeImage);
+    std::vector<std::string> after = handle->decode(afterImage);
+    for (size_t i = 0; i < fields.size(); ++i) {
+        const std::string& name = fields[i].name;
+        if (!handle->isUnique(name) || after[i] == before[i]) continue;
+        if (!idxMgr.keyFits(name, after[i]) || idxMgr.existsInIndex(name, after[i])) {
+            std::cerr << "[Transaction] New " << name << " is already taken or too long for its index\n";
+            bufMgr.unpinPage(handle->dataFile, pageNum, PageType::DATA, false);
+            handle->releaseExternal(afterImage);
+            return;
+        }
+    }
 
     // 8) BEGIN transaction
     TransactionID tid = txnMgr.beginTransaction();
@@ -89,22 +132,39 @@ void TransactionController::run(BufferManager& bufMgr, LockManager& lockMgr, WAL
     std::cout << "send to walmanager to update" << std::endl;
     walMgr.logUpdate(rec);
 
-    // 11) Apply the new image into the in-memory page buffer
-    std::memcpy(
-        pageBuf + withinPage,
-        afterImage.data(),
-        static_cast<size_t>(std::min<int>(afterImage.size(), recSize))
-    );
+    // 11) Apply the new image into the in-memory page buffer; the record
+    //     keeps its slot, so it must still fit its page
+    if (!page.update(HeapPage::slotOf(offset), afterImage)) {
+        bufMgr.unpinPage(handle->dataFile, pageNum, PageType::DATA, false);
+        handle->releaseExternal(afterImage);
+        txnMgr.abort(tid);
+        std::cerr << "[Transaction] T" << tid << " aborted: the new row does not fit its page\n";
+        return;
+    }
+    handle->freeSpace.setFreeSpace(pageNum, page.freeSpace());
+    handle->zones.update(pageNum, page);
 
     // 12) Unpin & mark dirty so BufferManager knows to flush later
     bufMgr.unpinPage(
-        "Tables/" + table + "/data.tbl",
+        handle->dataFile,
         pageNum,
         PageType::DATA,
         /* isDirty = */ true
     );
 
-    // 13) COMMIT transaction
+    // 13) Bring each unique key's index entry up to date: a changed key
+    //     moves, and a covering index gets the new INCLUDE payload
+    for (size_t i = 0; i < fields.size(); ++i) {
+        const std::string& name = fields[i].name;
+        if (!handle->isUnique(name)) continue;
+        std::string payload = idxMgr.makePayload(name, after);
+        if (after[i] == before[i] && payload == idxMgr.makePayload(name, before)) continue;
+        idxMgr.removeFromIndex(name, before[i]);
+        idxMgr.insertIntoIndex(name, after[i], offset, payload);
+    }
+
+    // 14) COMMIT transaction; the old row's out-of-line values go only now
     txnMgr.commit(tid);
+    handle->releaseExternal(beforeImage);
     std::cout << "[Transaction] T" << tid << " committed successfully.\n";
 }
@@ -0,0 +1,545 @@
+#include "art_index.h"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace {
+
+    enum class Kind : uint8_t { Leaf, N4, N16, N48, N256 };
+
+    struct Node {
+        Kind        kind;
+        uint16_t    count = 0;  // children in use (inner nodes)
+        std::string prefix;     // bytes every key below shares after the parent's branch byte
+        explicit Node(Kind k) : kind(k) {}
+    };
+
+    struct Leaf : Node {
+        std::string key;
+        long        offset;
+        Leaf(std::string k, long off) : Node(Kind::Leaf), key(std::move(k)), offset(off) {}
+    };
+
+    /// 4 or 16 children: branch bytes kept sorted, children parallel to them.
+    template <int N, Kind K>
+    struct SmallNode : Node {
+        uint8_t bytes[N];
+        Node*   child[N];
+        SmallNode() : Node(K) {}
+    };
+    using Node4 = SmallNode<4, Kind::N4>;
+    using Node16 = SmallNode<16, Kind::N16>;
+
+    /// 48 children: a byte map (slot + 1, 0 = none) into an unordered child array.
+    struct Node48 : Node {
+        uint8_t slot[256] = {};
+        Node*   child[48] = {};
+        Node48() : Node(Kind::N48) {}
+    };
+
+    struct Node256 : Node {
+        Node* child[256] = {};
+        Node256() : Node(Kind::N256) {}
+    };
+
+    /// Byte `depth` of `key`, 0 past its end.
+    uint8_t byteAt(const std::string& key, std::size_t depth) {
+        return depth < key.size() ? static_cast<uint8_t>(key[depth]) : 0;
+    }
+
+    /// Delete one node as its real type (Node has no virtual destructor).
+    void destroy(Node* n) {
+        switch (n->kind) {
+        case Kind::Leaf: delete static_cast<Leaf*>(n);    break;
+        case Kind::N4:   delete static_cast<Node4*>(n);   break;
+        case Kind::N16:  delete static_cast<Node16*>(n);  break;
+        case Kind::N48:  delete static_cast<Node48*>(n);  break;
+        case Kind::N256: delete static_cast<Node256*>(n); break;
+        }
+    }
+
+    /// Call fn(byte, child) for each child in byte order (reversed if
+    /// `descending`) until it returns false.  Returns false if it did.
+    template <typename F>
+    bool forEachChild(Node* n, bool descending, F&& fn) {
+        auto small = [&](auto* s) {
+            for (int j = 0; j < s->count; ++j) {
+                int i = descending ? s->count - 1 - j : j;
+                if (!fn(s->bytes[i], s->child[i])) return false;
+            }
+            return true;
+        };
+        switch (n->kind) {
+        case Kind::N4:  return small(static_cast<Node4*>(n));
+        case Kind::N16: return small(static_cast<Node16*>(n));
+        case Kind::N48: {
+            auto* s = static_cast<Node48*>(n);
+            for (int j = 0; j < 256; ++j) {
+                int b = descending ? 255 - j : j;
+                if (s->slot[b] && !fn(static_cast<uint8_t>(b), s->child[s->slot[b] - 1])) return false;
+            }
+            return true;
+        }
+        case Kind::N256: {
+            auto* s = static_cast<Node256*>(n);
+            for (int j = 0; j < 256; ++j) {
+                int b = descending ? 255 - j : j;
+                if (s->child[b] && !fn(static_cast<uint8_t>(b), s->child[b])) return false;
+            }
+            return true;
+        }
+        default:
+            return true;
+        }
+    }
+
+    void destroyTree(Node* n) {
+        if (!n) return;
+        forEachChild(n, false, [](uint8_t, Node* c) { destroyTree(c); return true; });
+        destroy(n);
+    }
+
+    /// Slot holding the child under byte b, or nullptr.
+    Node** findChild(Node* n, uint8_t b) {
+        auto small = [&](auto* s) -> Node** {
+            for (int i = 0; i < s->count; ++i) {
+                if (s->bytes[i] == b) return &s->child[i];
+            }
+            return nullptr;
+        };
+        switch (n->kind) {
+        case Kind::N4:  return small(static_cast<Node4*>(n));
+        case Kind::N16: return small(static_cast<Node16*>(n));
+        case Kind::N48: {
+            auto* s = static_cast<Node48*>(n);
+            return s->slot[b] ? &s->child[s->slot[b] - 1] : nullptr;
+        }
+        case Kind::N256: {
+            auto* s = static_cast<Node256*>(n);
+            return s->child[b] ? &s->child[b] : nullptr;
+        }
+        default:
+            return nullptr;
+        }
+    }
+
+    template <typename S>
+    void insertSorted(S* s, uint8_t b, Node* child) {
+        int i = s->count;
+        for (; i > 0 && s->bytes[i - 1] > b; --i) {
+            s->bytes[i] = s->bytes[i - 1];
+            s->child[i] = s->child[i - 1];
+        }
+        s->bytes[i] = b;
+        s->child[i] = child;
+        ++s->count;
+    }
+
+    template <typename S>
+    void eraseSorted(S* s, uint8_t b) {
+        int i = 0;
+        while (i < s->count && s->bytes[i] != b) ++i;
+        for (; i + 1 < s->count; ++i) {
+            s->bytes[i] = s->bytes[i + 1];
+            s->child[i] = s->child[i + 1];
+        }
+        --s->count;
+    }
+
+    /// Copy a small node's children into a bigger or smaller small node.
+    template <typename To, typename From>
+    To* resized(From* from) {
+        auto* to = new To;
+        to->prefix = std::move(from->prefix);
+        for (int i = 0; i < from->count; ++i) insertSorted(to, from->bytes[i], from->child[i]);
+        delete from;
+        return to;
+    }
+
+    /// Add `child` under byte b of the node at `ref`, growing it if full.
+    void addChild(Node*& ref, uint8_t b, Node* child) {
+        switch (ref->kind) {
+        case Kind::N4: {
+            auto* s = static_cast<Node4*>(ref);
+            if (s->count == 4) {
+                ref = resized<Node16>(s);
+                addChild(ref, b, child);
+                return;
+            }
+            insertSorted(s, b, child);
+            return;
+        }
+        case Kind::N16: {
+            auto* s = static_cast<Node16*>(ref);
+            if (s->count == 16) {
+                auto* g = new Node48;
+                g->prefix = std::move(s->prefix);
+                for (int i = 0; i < 16; ++i) {
+                    g->child[i] = s->child[i];
+                    g->slot[s->bytes[i]] = static_cast<uint8_t>(i + 1);
+                }
+                g->count = 16;
+                delete s;
+                ref = g;
+                addChild(ref, b, child);
+                return;
+            }
+            insertSorted(s, b, child);
+            return;
+        }
+        case Kind::N48: {
+            auto* s = static_cast<Node48*>(ref);
+            if (s->count == 48) {
+                auto* g = new Node256;
+                g->prefix = std::move(s->prefix);
+                for (int c = 0; c < 256; ++c) {
+                    if (s->slot[c]) g->child[c] = s->child[s->slot[c] - 1];
+                }
+                g->count = 48;
+                delete s;
+                ref = g;
+                addChild(ref, b, child);
+                return;
+            }
+            int i = 0;
+            while (s->child[i]) ++i;  // removes leave holes
+            s->child[i] = child;
+            s->slot[b] = static_cast<uint8_t>(i + 1);
+            ++s->count;
+            return;
+        }
+        case Kind::N256: {
+            auto* s = static_cast<Node256*>(ref);
+            s->child[b] = child;
+            ++s->count;
+            return;
+        }
+        default:
+            return;
+        }
+    }
+
+    /// Drop the child under byte b of the node at `ref` (the child itself is
+    /// the caller's) and shrink the node once it is well under capacity.  A
+    /// node left with one child is folded into it.
+    void removeChild(Node*& ref, uint8_t b) {
+        switch (ref->kind) {
+        case Kind::N4: {
+            auto* s = static_cast<Node4*>(ref);
+            eraseSorted(s, b);
+            if (s->count > 1) return;
+            Node* only = s->child[0];
+            if (only->kind != Kind::Leaf) {
+                only->prefix = s->prefix + static_cast<char>(s->bytes[0]) + only->prefix;
+            }
+            delete s;
+            ref = only;
+            return;
+        }
+        case Kind::N16: {
+            auto* s = static_cast<Node16*>(ref);
+            eraseSorted(s, b);
+            if (s->count <= 3) ref = resized<Node4>(s);
+            return;
+        }
+        case Kind::N48: {
+            auto* s = static_cast<Node48*>(ref);
+            s->child[s->slot[b] - 1] = nullptr;
+            s->slot[b] = 0;
+            if (--s->count > 12) return;
+            auto* g = new Node16;
+            g->prefix = std::move(s->prefix);
+            for (int c = 0; c < 256; ++c) {
+                if (s->slot[c]) insertSorted(g, static_cast<uint8_t>(c), s->child[s->slot[c] - 1]);
+            }
+            delete s;
+            ref = g;
+            return;
+        }
+        case Kind::N256: {
+            auto* s = static_cast<Node256*>(ref);
+            s->child[b] = nullptr;
+            if (--s->count > 37) return;
+            auto* g = new Node48;
+            g->prefix = std::move(s->prefix);
+            for (int c = 0; c < 256; ++c) {
+                if (!s->child[c]) continue;
+                g->child[g->count] = s->child[c];
+                g->slot[c] = static_cast<uint8_t>(++g->count);
+            }
+            delete s;
+            ref = g;
+            return;
+        }
+        default:
+            return;
+        }
+    }
+
+    /// Put `leaf` into the subtree at `ref`, whose keys agree with it on
+    /// their first `depth` bytes.  Returns the leaf already holding its key
+    /// (and leaves `leaf` unused), or nullptr.
+    Leaf* insertAt(Node*& ref, Leaf* leaf, std::size_t depth) {
+        const std::string& key = leaf->key;
+        if (!ref) {
+            ref = leaf;
+            return nullptr;
+        }
+        if (ref->kind == Kind::Leaf) {
+            auto* old = static_cast<Leaf*>(ref);
+            if (old->key == key) return old;
+            // Keys differ, so they part at or before the shorter one's end.
+            std::size_t i = depth;
+            while (byteAt(old->key, i) == byteAt(key, i)) ++i;
+            auto* split = new Node4;
+            split->prefix = key.substr(depth, i - depth);
+            insertSorted(split, byteAt(old->key, i), old);
+            insertSorted(split, byteAt(key, i), leaf);
+            ref = split;
+            return nullptr;
+        }
+
+        Node* n = ref;
+        std::size_t p = 0;
+        while (p < n->prefix.size() && static_cast<uint8_t>(n->prefix[p]) == byteAt(key, depth + p)) ++p;
+        if (p < n->prefix.size()) {
+            // The key leaves the node's prefix: split the prefix there.
+            auto* split = new Node4;
+            split->prefix = n->prefix.substr(0, p);
+            uint8_t branch = static_cast<uint8_t>(n->prefix[p]);
+            n->prefix.erase(0, p + 1);
+            insertSorted(split, branch, n);
+            insertSorted(split, byteAt(key, depth + p), leaf);
+            ref = split;
+            return nullptr;
+        }
+
+        depth += n->prefix.size();
+        uint8_t b = byteAt(key, depth);
+        if (Node** child = findChild(n, b)) return insertAt(*child, leaf, depth + 1);
+        addChild(ref, b, leaf);
+        return nullptr;
+    }
+
+    /// Take `key` out of the subtree at `ref`, whose keys agree with it on
+    /// their first `depth` bytes.  Returns the unlinked leaf, or nullptr.
+    Leaf* removeAt(Node*& ref, const std::string& key, std::size_t depth) {
+        if (!ref) return nullptr;
+        if (ref->kind == Kind::Leaf) {
+            auto* leaf = static_cast<Leaf*>(ref);
+            if (leaf->key != key) return nullptr;
+            ref = nullptr;
+            return leaf;
+        }
+
+        Node* n = ref;
+        if (key.compare(depth, n->prefix.size(), n->prefix) != 0) return nullptr;
+        depth += n->prefix.size();
+        uint8_t b = byteAt(key, depth);
+        Node** child = findChild(n, b);
+        if (!child) return nullptr;
+        if ((*child)->kind != Kind::Leaf) return removeAt(*child, key, depth + 1);
+
+        auto* leaf = static_cast<Leaf*>(*child);
+        if (leaf->key != key) return nullptr;
+        removeChild(ref, b);
+        return leaf;
+    }
+
+    /// Leaf holding `key`, or nullptr.  Prefixes are skipped rather than
+    /// compared: the leaf's full key settles it.
+    Leaf* findLeaf(Node* n, const std::string& key) {
+        std::size_t depth = 0;
+        while (n && n->kind != Kind::Leaf) {
+            depth += n->prefix.size();
+            Node** child = findChild(n, byteAt(key, depth++));
+            n = child ? *child : nullptr;
+        }
+        auto* leaf = static_cast<Leaf*>(n);
+        return leaf && leaf->key == key ? leaf : nullptr;
+    }
+
+    /// In-order walk of the leaves within [low, high]; empty bounds are open.
+    struct RangeWalk {
+        const std::string&             low;
+        const std::string&             high;
+        bool                           descending;
+        std::size_t                    limit;
+        std::vector<ArtIndex::Entry>&  out;
+        std::string                    path;  // bytes leading to the node being visited
+
+        /// False once `limit` entries are in.
+        bool visit(Node* n) {
+            if (n->kind == Kind::Leaf) {
+                auto* leaf = static_cast<Leaf*>(n);
+                if ((!low.empty() && leaf->key < low) || (!high.empty() && leaf->key > high)) {
+                    return true;
+                }
+                out.emplace_back(leaf->key, leaf->offset);
+                return limit == 0 || out.size() < limit;
+            }
+
+            // Every key below starts with `path`: skip subtrees wholly
+            // above high or below low.
+            std::size_t mark = path.size();
+            path += n->prefix;
+            bool more = true;
+            if ((high.empty() || path <= high)
+                && (low.empty() || path.compare(0, path.size(), low, 0, path.size()) >= 0)) {
+                more = forEachChild(n, descending, [&](uint8_t b, Node* child) {
+                    path.push_back(static_cast<char>(b));
+                    bool goOn = visit(child);
+                    path.pop_back();
+                    return goOn;
+                });
+            }
+            path.resize(mark);
+            return more;
+        }
+    };
+}
+
+// 
+// Shared per-index state
+// 
+
+struct ArtIndex::SharedState {
+    std::shared_mutex mtx;
+    Node*             root = nullptr;
+    long              keyCount = 0;
+    bool              built = false;
+
+    ~SharedState() { destroyTree(root); }
+};
+
+struct ArtIndex::Registry {
+    std::mutex                                                    mtx;
+    std::unordered_map<std::string, std::shared_ptr<SharedState>> states;
+};
+
+ArtIndex::Registry& ArtIndex::registry() {
+    static Registry r;
+    return r;
+}
+
+ArtIndex::ArtIndex(const std::string& name_)
+    : name(name_)
+{
+    Registry& r = registry();
+    std::lock_guard<std::mutex> guard(r.mtx);
+    std::shared_ptr<SharedState>& shared = r.states[name];
+    if (!shared) shared = std::make_shared<SharedState>();
+    state = shared;
+}
+
+void ArtIndex::forget(const std::string& tablePath) {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> guard(r.mtx);
+    const std::string dir = tablePath + "/";
+    for (auto it = r.states.begin(); it != r.states.end();) {
+        if (it->first.compare(0, dir.size(), dir) == 0) it = r.states.erase(it);
+        else ++it;
+    }
+}
+
+void ArtIndex::build(const std::function<std::vector<Entry>()>& load) {
+    std::unique_lock<std::shared_mutex> lock(state->mtx);
+    if (state->built) return;
+    // Inserts made while the first open scans wait for it on the lock.
+    for (auto& e : load()) {
+        if (e.first.size() >= KEY_SIZE) continue;
+        auto* leaf = new Leaf(e.first, e.second);
+        if (Leaf* old = insertAt(state->root, leaf, 0)) {
+            old->offset = leaf->offset;
+            delete leaf;
+        }
+        else {
+            ++state->keyCount;
+        }
+    }
+    state->built = true;
+}
+
+long ArtIndex::size() const {
+    std::shared_lock<std::shared_mutex> lock(state->mtx);
+    return state->keyCount;
+}
+
+// 
+// Point operations
+// 
+
+void ArtIndex::insert(const std::string& key, long recordOffset) {
+    if (key.size() >= KEY_SIZE) return;
+    auto* leaf = new Leaf(key, recordOffset);
+    std::unique_lock<std::shared_mutex> lock(state->mtx);
+    if (Leaf* old = insertAt(state->root, leaf, 0)) {
+        old->offset = recordOffset;
+        delete leaf;
+        return;
+    }
+    ++state->keyCount;
+}
+
+bool ArtIndex::search(const std::string& key, long& recordOffset) const {
+    if (key.size() >= KEY_SIZE) return false;
+    std::shared_lock<std::shared_mutex> lock(state->mtx);
+    Leaf* leaf = findLeaf(state->root, key);
+    if (!leaf) return false;
+    recordOffset = leaf->offset;
+    return true;
+}
+
+bool ArtIndex::remove(const std::string& key) {
+    if (key.size() >= KEY_SIZE) return false;
+    std::unique_lock<std::shared_mutex> lock(state->mtx);
+    Leaf* leaf = removeAt(state->root, key, 0);
+    if (!leaf) return false;
+    delete leaf;
+    --state->keyCount;
+    return true;
+}
+
+// 
+// Ordered scans
+// 
+
+void ArtIndex::rangeSearch(const std::string& startKey,
+    const std::string& endKey,
+    std::vector<Entry>& out,
+    bool descending,
+    std::size_t limit) const
+{
+    std::shared_lock<std::shared_mutex> lock(state->mtx);
+    if (!state->root) return;
+    RangeWalk walk{ startKey, endKey, descending, limit, out, std::string() };
+    walk.visit(state->root);
+}
+
+void ArtIndex::prefixSearch(const std::string& prefix, std::vector<Entry>& out) const {
+    std::shared_lock<std::shared_mutex> lock(state->mtx);
+    // Descend while the prefix still picks the branch.
+    Node* n = state->root;
+    std::size_t depth = 0;
+    while (n && n->kind != Kind::Leaf && depth < prefix.size()) {
+        std::size_t len = std::min(n->prefix.size(), prefix.size() - depth);
+        if (n->prefix.compare(0, len, prefix, depth, len) != 0) return;
+        depth += n->prefix.size();
+        if (depth >= prefix.size()) break;
+        Node** child = findChild(n, byteAt(prefix, depth++));
+        n = child ? *child : nullptr;
+    }
+    if (!n) return;
+    if (n->kind == Kind::Leaf) {
+        auto* leaf = static_cast<Leaf*>(n);
+        if (leaf->key.compare(0, prefix.size(), prefix) == 0) out.emplace_back(leaf->key, leaf->offset);
+        return;
+    }
+    // Everything below n starts with the prefix.
+    const std::string open;
+    RangeWalk walk{ open, open, false, 0, out, std::string() };
+    walk.visit(n);
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <functional>
+#include <utility>
+
+/// In-memory adaptive radix tree for unique keys of small, hot tables.
+/// Nothing is written to disk: the tree is built from data.tbl the first
+/// time the table's index is opened in the process, and the insert and
+/// delete paths keep it current after that.
+///
+/// Inner nodes branch on one key byte and come in four sizes (4, 16, 48 and
+/// 256 children), growing and shrinking as children come and go.  Runs of
+/// bytes shared by every key below a node are folded into the node's prefix,
+/// so a probe touches one small node per distinguishing byte and compares the
+/// full key once, at the leaf.  '\0' stands in for the end of a key, so a key
+/// that is a prefix of another sorts first: text keys never contain '\0', and
+/// the keys of a number column (see Schema::encodeKey), which may, all have
+/// the same width.
+///
+/// The tree keeps keys in byte order, so it answers ranges and prefixes as
+/// well as equality probes.
+///
+/// Concurrency: one reader/writer lock per index, shared by every ArtIndex
+/// object opened on it.  Lookups share it; inserts and removes take it
+/// exclusively.
+class ArtIndex {
+public:
+    static constexpr int KEY_SIZE = 40;  // longer keys are not stored, as in BPlusTree
+
+    using Entry = std::pair<std::string, long>;  // key, record offset
+
+    /// name: identifies the index within the process
+    ///       (e.g. "Tables/myTable/id.art"); no file of that name is made.
+    explicit ArtIndex(const std::string& name);
+
+    /// First open in the process: fill the tree with the entries `load`
+    /// returns.  Later calls, from any object on the same index, do nothing.
+    void build(const std::function<std::vector<Entry>()>& load);
+
+    /// Insert a (key -> recordOffset) pair; an existing key gets the new offset.
+    /// A key of KEY_SIZE bytes or more is not stored, and search/remove never
+    /// find one.
+    void insert(const std::string& key, long recordOffset);
+
+    /// Exact lookup; if found, recordOffset is set and returns true.
+    bool search(const std::string& key, long& recordOffset) const;
+
+    /// Remove an exact key.  Returns true if found & removed.
+    bool remove(const std::string& key);
+
+    /// Every entry with startKey <= key <= endKey, in key order or, if
+    /// `descending`, highest key first.  An empty bound is open; a non-zero
+    /// `limit` stops after that many entries.
+    void rangeSearch(const std::string& startKey,
+        const std::string& endKey,
+        std::vector<Entry>& out,
+        bool descending = false,
+        std::size_t limit = 0) const;
+
+    /// Every entry whose key starts with `prefix`, in key order.
+    void prefixSearch(const std::string& prefix, std::vector<Entry>& out) const;
+
+    /// Number of keys; no tree walk.
+    long size() const;
+
+    /// Drop the in-memory trees of every index under `tablePath`, e.g. when
+    /// the table is deleted.  The next open rebuilds them from data.tbl.
+    static void forget(const std::string& tablePath);
+
+private:
+    struct SharedState;         // per-index lock + tree (defined in .cpp)
+    struct Registry;            // name -> SharedState for the process (defined in .cpp)
+
+    static Registry& registry();
+
+    std::string name;
+    std::shared_ptr<SharedState> state;
+};
@@ -0,0 +1,90 @@
+#include "bloom_filter.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+BloomFilter::BloomFilter(long capacity_)
+    : capacity(std::max(capacity_, MIN_CAPACITY)),
+    bitCount(static_cast<uint64_t>(capacity) * BITS_PER_KEY),
+    words(new std::atomic<uint64_t>[(bitCount + 63) / 64])
+{
+    for (uint64_t i = 0; i < (bitCount + 63) / 64; ++i) {
+        words[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void BloomFilter::add(const std::string& key) {
+    // Double hashing: probe i is h1 + i * h2.
+    uint64_t h1 = Utils::fnv1a(key);
+    uint64_t h2 = Utils::mixHash(h1) | 1;
+    for (int i = 0; i < HASHES; ++i) {
+        uint64_t bit = (h1 + i * h2) % bitCount;
+        words[bit / 64].fetch_or(1ULL << (bit % 64), std::memory_order_relaxed);
+    }
+    added.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool BloomFilter::mayContain(const std::string& key) const {
+    uint64_t h1 = Utils::fnv1a(key);
+    uint64_t h2 = Utils::mixHash(h1) | 1;
+    for (int i = 0; i < HASHES; ++i) {
+        uint64_t bit = (h1 + i * h2) % bitCount;
+        if (!(words[bit / 64].load(std::memory_order_relaxed) & (1ULL << (bit % 64)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool BloomFilter::needsRebuild() const {
+    long a = added.load(std::memory_order_relaxed);
+    long r = removed.load(std::memory_order_relaxed);
+    return a > capacity || (r > MIN_CAPACITY && r * 2 > a);
+}
+
+bool BloomFilter::save(const std::string& path, long indexKeys) const {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+
+    uint64_t wordCount = (bitCount + 63) / 64;
+    std::vector<uint64_t> snapshot(wordCount);
+    for (uint64_t i = 0; i < wordCount; ++i) {
+        snapshot[i] = words[i].load(std::memory_order_relaxed);
+    }
+    long a = added.load(), r = removed.load();
+    out.write(reinterpret_cast<const char*>(&FILE_MAGIC), sizeof(FILE_MAGIC));
+    out.write(reinterpret_cast<const char*>(&indexKeys), sizeof(indexKeys));
+    out.write(reinterpret_cast<const char*>(&capacity), sizeof(capacity));
+    out.write(reinterpret_cast<const char*>(&a), sizeof(a));
+    out.write(reinterpret_cast<const char*>(&r), sizeof(r));
+    out.write(reinterpret_cast<const char*>(snapshot.data()), wordCount * sizeof(uint64_t));
+    return static_cast<bool>(out);
+}
+
+std::unique_ptr<BloomFilter> BloomFilter::load(const std::string& path, long indexKeys) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return nullptr;
+
+    uint32_t magic = 0;
+    long keys = -1, cap = 0, a = 0, r = 0;
+    in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    in.read(reinterpret_cast<char*>(&keys), sizeof(keys));
+    in.read(reinterpret_cast<char*>(&cap), sizeof(cap));
+    in.read(reinterpret_cast<char*>(&a), sizeof(a));
+    in.read(reinterpret_cast<char*>(&r), sizeof(r));
+    if (!in || magic != FILE_MAGIC || keys != indexKeys || cap < MIN_CAPACITY) return nullptr;
+
+    auto filter = std::make_unique<BloomFilter>(cap);
+    uint64_t wordCount = (filter->bitCount + 63) / 64;
+    std::vector<uint64_t> snapshot(wordCount);
+    in.read(reinterpret_cast<char*>(snapshot.data()), wordCount * sizeof(uint64_t));
+    if (!in) return nullptr;
+    for (uint64_t i = 0; i < wordCount; ++i) {
+        filter->words[i].store(snapshot[i], std::memory_order_relaxed);
+    }
+    filter->added.store(a);
+    filter->removed.store(r);
+    return filter;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/// Bloom filter over index keys: answers "definitely absent" or "maybe
+/// present".  Bits are only ever set, with atomic ORs, so one filter can be
+/// shared by every thread using an index without a lock.  Deleted keys keep
+/// their bits; the owner counts them and builds a fresh filter once too many
+/// have piled up (see needsRebuild).
+class BloomFilter {
+public:
+    static constexpr int BITS_PER_KEY = 10;   // about 1% false positives
+    static constexpr int HASHES = 7;
+    static constexpr long MIN_CAPACITY = 1024;
+
+    /// Sized for 'capacity' keys at BITS_PER_KEY.
+    explicit BloomFilter(long capacity);
+
+    void add(const std::string& key);
+    bool mayContain(const std::string& key) const;
+
+    /// Note a deleted key (its bits stay set).
+    void noteRemoved() { removed.fetch_add(1, std::memory_order_relaxed); }
+
+    /// True once the filter has taken more keys than it was sized for, or
+    /// more than half of what it holds has since been deleted.
+    bool needsRebuild() const;
+
+    long getCapacity() const { return capacity; }
+
+    /// Write the filter to 'path', tagged with the index's key count so a
+    /// reader can tell whether it still describes the index.
+    bool save(const std::string& path, long indexKeys) const;
+
+    /// Read a filter written by save(); nullptr if the file is missing,
+    /// damaged, or was saved for a different key count.
+    static std::unique_ptr<BloomFilter> load(const std::string& path, long indexKeys);
+
+private:
+    long                                   capacity;
+    uint64_t                               bitCount;
+    std::unique_ptr<std::atomic<uint64_t>[]> words;
+    std::atomic<long>                      added{ 0 };
+    std::atomic<long>                      removed{ 0 };
+
+    static constexpr uint32_t FILE_MAGIC = 0x464D4C42;  // "BLMF"
+};
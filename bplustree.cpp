@@ -1,35 +1,453 @@
 #include "BPlusTree.h"
+#include "bloom_filter.h"
 
 #include <fstream>
 #include <iostream>
 #include <cstring>
 #include <algorithm>
+#include <array>
+#include <climits>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <string_view>
+#include <unordered_map>
+#include <filesystem>
+
+// 
+// Optimistic latches
+// 
+
+namespace {
+
+    struct NodeLatch;
+
+    /// Decoded image of an inner page, tagged with the latch version it was
+    /// read at.  Never modified once published: a page write moves the latch
+    /// past 'version', which is all it takes to make the image stale.
+    struct CachedInner {
+        uint64_t               version;
+        BPlusTree::Node        node;
+        std::vector<NodeLatch*> childLatches;  // swizzled: latch (and cache slot) of child i
+    };
+
+    /// Version word of one page.  Bit 1 set = write-locked; every write unlock
+    /// bumps the counter, so a reader that saw version v before copying a node
+    /// knows the copy is consistent iff the word still equals v afterwards.
+    /// Inner pages also carry their cached image here.
+    struct NodeLatch {
+        std::atomic<uint64_t>     version{ 0 };
+        std::atomic<CachedInner*> cached{ nullptr };
+    };
+
+    constexpr uint64_t LOCKED_BIT = 2;
+
+    /// Cached image of 'page' if it is current at 'version'.
+    const CachedInner* cachedAt(NodeLatch& latch, long page, uint64_t version) {
+        const CachedInner* c = latch.cached.load(std::memory_order_acquire);
+        return c && c->version == version && c->node.selfPage == page ? c : nullptr;
+    }
+
+    /// Wait until the node is not write-locked and return its version.
+    uint64_t readLock(NodeLatch& latch) {
+        uint64_t version = latch.version.load(std::memory_order_acquire);
+        while (version & LOCKED_BIT) {
+            std::this_thread::yield();
+            version = latch.version.load(std::memory_order_acquire);
+        }
+        return version;
+    }
+
+    /// True if nobody has written the node since readLock returned 'version'.
+    bool validate(NodeLatch& latch, uint64_t version) {
+        return latch.version.load(std::memory_order_acquire) == version;
+    }
+
+    /// Turn an optimistic read at 'version' into an exclusive write lock.
+    bool upgrade(NodeLatch& latch, uint64_t version) {
+        return latch.version.compare_exchange_strong(version, version + LOCKED_BIT,
+            std::memory_order_acq_rel);
+    }
+
+    void writeUnlock(NodeLatch& latch) {
+        latch.version.fetch_add(LOCKED_BIT, std::memory_order_release);
+    }
+
+    /// Length of the common prefix of two keys.
+    int commonPrefix(const std::string& a, const std::string& b) {
+        std::size_t n = std::min(a.size(), b.size());
+        std::size_t i = 0;
+        while (i < n && a[i] == b[i]) ++i;
+        return static_cast<int>(i);
+    }
+
+    /// Shortest key s with left < s <= right: the separator a leaf split needs.
+    /// Equal neighbours (duplicate keys) leave nothing to cut.
+    std::string shortestSeparator(const std::string& left, const std::string& right) {
+        if (!(left < right)) return right;
+        return right.substr(0, commonPrefix(left, right) + 1);
+    }
+
+    /// Page bytes of a node holding keys[b, e).  'sums' are running entry
+    /// lengths (sums[i] = total heap bytes of keys and payloads [0, i)).  Leaves store the range's
+    /// common prefix once; inner nodes are charged for the full keys and have
+    /// one pointer more than keys, the first living in the node header.
+    int rangeBytes(const std::vector<std::string>& keys, const std::vector<int>& sums,
+        int b, int e, bool leaf)
+    {
+        int n = e - b;
+        int prefix = leaf && n > 0 ? commonPrefix(keys[b], keys[e - 1]) : 0;
+        return BPlusTree::NODE_HEADER_SIZE + prefix + n * BPlusTree::SLOT_SIZE
+            + (sums[e] - sums[b]) - n * prefix;
+    }
+
+    /// Where to cut keys so the two halves use about the same number of bytes.
+    /// Leaves keep every key: left gets [0, k), right [k, n).  Inner nodes push
+    /// keys[k] up: left gets [0, k), right [k + 1, n).
+    int balancedSplit(const std::vector<std::string>& keys,
+        const std::vector<std::string>& payloads, bool leaf)
+    {
+        const int n = static_cast<int>(keys.size());
+        std::vector<int> sums(n + 1, 0);
+        for (int i = 0; i < n; ++i) {
+            sums[i + 1] = sums[i] + static_cast<int>(keys[i].size());
+            if (!payloads.empty()) sums[i + 1] += 1 + static_cast<int>(payloads[i].size());
+        }
+
+        int best = n / 2;
+        int bestCost = INT_MAX;
+        int last = leaf ? n - 1 : n - 2;
+        for (int k = 1; k <= last; ++k) {
+            int left = rangeBytes(keys, sums, 0, k, leaf);
+            int right = rangeBytes(keys, sums, leaf ? k : k + 1, n, leaf);
+            if (std::max(left, right) < bestCost) {
+                bestCost = std::max(left, right);
+                best = k;
+            }
+        }
+        return best;
+    }
+
+    /// Byte offsets inside the header page.  magic and freeListHead predate the
+    /// version field, so a file whose version reads 0 has the older layout.
+    constexpr std::size_t HDR_MAGIC = 0;
+    constexpr std::size_t HDR_FREE_HEAD = 4;
+    constexpr std::size_t HDR_VERSION = 12;
+    constexpr std::size_t HDR_ROOT = 16;
+    constexpr std::size_t HDR_PAGES = 24;
+    constexpr std::size_t HDR_KEYS = 32;
+    constexpr std::size_t HDR_HEIGHT = 40;
+
+    template <typename T>
+    T loadField(const char* page, std::size_t offset) {
+        T value;
+        std::memcpy(&value, page + offset, sizeof(T));
+        return value;
+    }
+
+    template <typename T>
+    void storeField(char* page, std::size_t offset, T value) {
+        std::memcpy(page + offset, &value, sizeof(T));
+    }
+}
+
+/// State shared by every BPlusTree opened on the same index file: the page
+/// latches, the inner-node cache and an in-memory copy of the header page.
+/// The counters must be shared as well, since pages allocated by one
+/// IndexManager may still sit unflushed in the buffer pool when the next one
+/// opens the file.
+///
+/// Cached inner images are replaced, never edited, so a reader may still be
+/// looking at one that was just swapped out.  Those go on 'retired' and are
+/// freed once no operation is in flight: every public operation counts itself
+/// in 'active' for its duration (see Section).
+struct BPlusTree::SharedState {
+    static constexpr std::size_t CHUNK = 1024;      // latches per chunk
+    static constexpr std::size_t DIRECTORY = 4096;  // chunks (4M pages)
+
+    std::atomic<long> pageCount{ 0 };
+    std::atomic<long> rootPage{ -1 };               // -1 = empty tree; changes under latch(HEADER_PAGE)
+    std::atomic<long> keyCount{ 0 };
+    std::atomic<int>  height{ 0 };
+    std::mutex        rootMtx;                      // serializes creating the first root
+    std::mutex        allocMtx;                     // guards freeListHead + header page
+    long              freeListHead = -1;
+    long              savedKeyCount = 0;            // keyCount as of the last header write
+    std::array<std::atomic<NodeLatch*>, DIRECTORY> chunks{};
+
+    std::atomic<long>         active{ 0 };          // operations in flight
+    std::atomic<long>         retiredCount{ 0 };
+    std::mutex                retireMtx;
+    std::vector<CachedInner*> retired;
+
+    // Key filter.  'filter' answers mayContain; inserts also go to 'newest',
+    // which differs from it only while a rebuild is filling a replacement.
+    std::string                              bloomPath;     // next to the .idx file
+    std::atomic<std::shared_ptr<BloomFilter>> filter;
+    std::atomic<std::shared_ptr<BloomFilter>> newest;
+    std::atomic<bool>                        rebuilding{ false };
+    std::atomic<bool>                        filterSaved{ false };  // bloomPath matches the index
+
+    std::atomic<bool> forgotten{ false };           // file deleted (see forget): write nothing back
+
+    ~SharedState() {
+        // Saved with the key count the header will carry; if the two ever
+        // disagree at the next open the filter is rebuilt instead of trusted.
+        // A forgotten file's filter is dropped: saved next to a table created
+        // again under the same name, it would pass for that index's filter.
+        std::shared_ptr<BloomFilter> f = filter.load();
+        if (f && !filterSaved.load() && !forgotten.load()) f->save(bloomPath, keyCount.load());
+
+        for (auto& c : chunks) {
+            NodeLatch* chunk = c.load();
+            if (!chunk) continue;
+            for (std::size_t i = 0; i < CHUNK; ++i) delete chunk[i].cached.load();
+            delete[] chunk;
+        }
+        for (CachedInner* c : retired) delete c;
+    }
+
+    /// Counts one operation as in flight; the last one out frees what was
+    /// retired before it looked.
+    struct Section {
+        SharedState& s;
+        explicit Section(SharedState& state) : s(state) { s.active.fetch_add(1); }
+        ~Section() {
+            if (s.active.fetch_sub(1) == 1 && s.retiredCount.load() > 0) s.reclaim();
+        }
+    };
+
+    void retire(CachedInner* c) {
+        if (!c) return;
+        std::lock_guard<std::mutex> guard(retireMtx);
+        retired.push_back(c);
+        retiredCount.fetch_add(1);
+    }
+
+    void reclaim() {
+        std::vector<CachedInner*> batch;
+        {
+            std::lock_guard<std::mutex> guard(retireMtx);
+            batch.swap(retired);
+        }
+        // Everything in 'batch' was unlinked before the swap, so only an
+        // operation already running then could hold it.  None is running now.
+        if (active.load() == 0) {
+            retiredCount.fetch_sub(static_cast<long>(batch.size()));
+            for (CachedInner* c : batch) delete c;
+            return;
+        }
+        std::lock_guard<std::mutex> guard(retireMtx);
+        retired.insert(retired.end(), batch.begin(), batch.end());
+    }
+
+    /// Publish a freshly decoded inner node read at 'version', unless a newer
+    /// image is already there.
+    void install(long page, uint64_t version, const BPlusTree::Node& node) {
+        NodeLatch& l = latch(page);
+        CachedInner* fresh = new CachedInner{ version, node, {} };
+        fresh->childLatches.reserve(node.children.size());
+        for (long child : node.children) fresh->childLatches.push_back(&latch(child));
+
+        CachedInner* cur = l.cached.load(std::memory_order_acquire);
+        while (!cur || cur->node.selfPage != page || cur->version < version) {
+            if (l.cached.compare_exchange_weak(cur, fresh, std::memory_order_acq_rel)) {
+                retire(cur);
+                return;
+            }
+        }
+        delete fresh;
+    }
+
+    /// Latch for 'page'; chunks are allocated lazily and never move.
+    NodeLatch& latch(long page) {
+        std::size_t idx = static_cast<std::size_t>(page) % (CHUNK * DIRECTORY);
+        std::atomic<NodeLatch*>& slot = chunks[idx / CHUNK];
+        NodeLatch* chunk = slot.load(std::memory_order_acquire);
+        if (!chunk) {
+            NodeLatch* fresh = new NodeLatch[CHUNK];
+            if (slot.compare_exchange_strong(chunk, fresh, std::memory_order_acq_rel)) {
+                chunk = fresh;
+            }
+            else {
+                delete[] fresh;   // another thread won the race; 'chunk' holds its array
+            }
+        }
+        return chunk[idx % CHUNK];
+    }
+};
 
 // 
 // Constructor & Destructor
 // 
 
+struct BPlusTree::Registry {
+    std::mutex                                                    mtx;
+    std::unordered_map<std::string, std::shared_ptr<SharedState>> states;
+};
+
+BPlusTree::Registry& BPlusTree::registry() {
+    static Registry r;
+    return r;
+}
+
 BPlusTree::BPlusTree(const std::string& filename, BufferManager& bm)
     : filePath(filename),
-    bufMgr(bm),
-    pageCount(0)
+    bufMgr(bm)
 {
-    // On construction, determine how many pages currently exist in the file.
-    std::ifstream in(filePath, std::ios::binary | std::ios::ate);
-    if (!in) {
-        // File doesnt exist yet ? create it empty:
-        std::ofstream create(filePath, std::ios::binary);
-        create.close();
-        pageCount = 0;
+    // Attach to (or create) the shared state for this file.  Only the first
+    // open reads the header page; later ones find everything in memory.
+    Registry& r = registry();
+    std::lock_guard<std::mutex> guard(r.mtx);
+    std::shared_ptr<SharedState>& shared = r.states[filePath];
+    if (!shared) {
+        shared = std::make_shared<SharedState>();
+        state = shared;
+        openFile();
+        openFilter();
+        return;
     }
-    else {
-        long size = in.tellg();
-        pageCount = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+    state = shared;
+}
+
+bool BPlusTree::isEmpty() const {
+    return state->rootPage.load() < 0;
+}
+
+BPlusTree::Stats BPlusTree::stats() const {
+    Stats s;
+    s.keyCount = state->keyCount.load();
+    s.height = state->height.load();
+    s.pageCount = state->pageCount.load();
+    return s;
+}
+
+// 
+// Header page: magic, format version, root pointer, free-list head, statistics
+// 
+
+void BPlusTree::openFile() {
+    char* pageBuf = bufMgr.getPage(filePath, HEADER_PAGE, PageType::INDEX);
+    if (!pageBuf) {
+        std::cerr << "[BPlusTree] openFile: cannot pin header of " << filePath << "\n";
+        return;
+    }
+    const uint32_t magic = loadField<uint32_t>(pageBuf, HDR_MAGIC);
+    const uint32_t version = loadField<uint32_t>(pageBuf, HDR_VERSION);
+    const long oldRootPage = loadField<long>(pageBuf, HDR_ROOT);
+    bool blank = std::all_of(pageBuf, pageBuf + PAGE_SIZE, [](char c) { return c == 0; });
+    if (magic == MAGIC && version == FORMAT_VERSION) {
+        state->freeListHead = loadField<long>(pageBuf, HDR_FREE_HEAD);
+        state->rootPage.store(loadField<long>(pageBuf, HDR_ROOT));
+        state->pageCount.store(loadField<long>(pageBuf, HDR_PAGES));
+        state->keyCount.store(loadField<long>(pageBuf, HDR_KEYS));
+        state->height.store(loadField<int>(pageBuf, HDR_HEIGHT));
+        state->savedKeyCount = state->keyCount.load();
     }
+    bufMgr.unpinPage(filePath, HEADER_PAGE, PageType::INDEX, /*isDirty=*/false);
+
+    if (blank || (magic == MAGIC && version == FORMAT_VERSION)) return;
+
+    // Older file.  Take the page count from the file size this once.
+    // Format 3 has today's pages minus the leaves' back links; format 2 has
+    // fixed 40-byte key slots and recorded its root; without a version, page
+    // 1 was the root, and without the magic page 0 was (or, after a lost root
+    // split, the leftmost leaf).  Either way the leaf chain reaches every key,
+    // so re-pack it.
+    std::error_code ec;
+    std::uintmax_t size = std::filesystem::file_size(filePath, ec);
+    state->pageCount.store(ec ? 0 : static_cast<long>((size + PAGE_SIZE - 1) / PAGE_SIZE));
+    long oldRoot = magic != MAGIC ? 0 : version == 0 ? 1 : oldRootPage;
+    std::cout << "[BPlusTree] upgrading " << filePath << " to format v"
+        << FORMAT_VERSION << "\n";
+    bulkLoad(collectEntries(oldRoot, /*fixedSlots=*/magic != MAGIC || version < 3));
+}
+
+void BPlusTree::openFilter() {
+    state->bloomPath = std::filesystem::path(filePath).replace_extension(".bloom").string();
+    std::shared_ptr<BloomFilter> saved = BloomFilter::load(state->bloomPath, state->keyCount.load());
+    if (saved) {
+        state->filter.store(saved);
+        state->newest.store(saved);
+        state->filterSaved.store(true);
+        return;
+    }
+    rebuildFilter();
+}
+
+void BPlusTree::rebuildFilter() {
+    bool idle = false;
+    if (!state->rebuilding.compare_exchange_strong(idle, true)) return;
+
+    // Inserts from here on reach 'fresh' through 'newest' while the scan
+    // below fills in everything already in the tree; only then does it take
+    // over answering queries.
+    auto fresh = std::make_shared<BloomFilter>(2 * state->keyCount.load());
+    state->newest.store(fresh);
+    scanRange("", "", [&](const std::string& key, long, const std::string&) {
+        fresh->add(key);
+        return true;
+    });
+    state->filter.store(fresh);
+    state->filterSaved.store(false);
+    state->rebuilding.store(false);
+}
+
+void BPlusTree::noteModified() {
+    // The saved filter stops describing the index with the first change; drop
+    // it now so that a crash cannot leave a stale one behind.
+    if (state->filterSaved.exchange(false)) {
+        std::error_code ec;
+        std::filesystem::remove(state->bloomPath, ec);
+    }
+}
+
+bool BPlusTree::mayContain(const std::string& key) const {
+    std::shared_ptr<BloomFilter> f = state->filter.load();
+    if (key.size() >= KEY_SIZE) return false;   // never stored
+    return !f || f->mayContain(key);
+}
+
+void BPlusTree::writeHeader() {
+    char* pageBuf = bufMgr.getPage(filePath, HEADER_PAGE, PageType::INDEX);
+    if (!pageBuf) {
+        std::cerr << "[BPlusTree] writeHeader: cannot pin page 0\n";
+        return;
+    }
+    long keys = state->keyCount.load();
+    std::memset(pageBuf, 0, PAGE_SIZE);
+    storeField(pageBuf, HDR_MAGIC, MAGIC);
+    storeField(pageBuf, HDR_FREE_HEAD, state->freeListHead);
+    storeField(pageBuf, HDR_VERSION, FORMAT_VERSION);
+    storeField(pageBuf, HDR_ROOT, state->rootPage.load());
+    storeField(pageBuf, HDR_PAGES, state->pageCount.load());
+    storeField(pageBuf, HDR_KEYS, keys);
+    storeField(pageBuf, HDR_HEIGHT, state->height.load());
+    bufMgr.unpinPage(filePath, HEADER_PAGE, PageType::INDEX, /*isDirty=*/true);
+    state->savedKeyCount = keys;
 }
 
 BPlusTree::~BPlusTree() {
-    // Nothing special: buffer manager will flush dirty pages at shutdown if needed.
+    // Structural changes write the header as they happen; the key count is
+    // only brought up to date here, so a plain insert touches a single page.
+    std::lock_guard<std::mutex> guard(state->allocMtx);
+    if (!state->forgotten.load() && state->rootPage.load() >= 0
+        && state->savedKeyCount != state->keyCount.load()) {
+        writeHeader();
+    }
+}
+
+void BPlusTree::forget(const std::string& tablePath) {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> guard(r.mtx);
+    const std::string dir = tablePath + "/";
+    for (auto it = r.states.begin(); it != r.states.end();) {
+        if (it->first.compare(0, dir.size(), dir) == 0) {
+            it->second->forgotten.store(true);
+            it = r.states.erase(it);
+        }
+        else ++it;
+    }
 }
 
 // 
@@ -37,29 +455,101 @@ BPlusTree::~BPlusTree() {
 // 
 
 long BPlusTree::allocateNode() {
-    long newPage = pageCount;
+    long newPage;
+    {
+        std::lock_guard<std::mutex> guard(state->allocMtx);
+        if (state->freeListHead != -1) {
+            // Pop the free list; a free page links to the next one.
+            newPage = state->freeListHead;
+            state->freeListHead = readNode(newPage).nextLeafPage;
+            writeHeader();
+        }
+        else {
+            // The header records the page count, so it must never lag behind a
+            // page that could reach the disk.
+            newPage = state->pageCount.fetch_add(1);
+            writeHeader();
+        }
+    }
     Node n;
     n.selfPage = newPage;
-    n.isLeaf = true;
-    n.keyCount = 0;
-    n.parentPage = -1;
-    n.nextLeafPage = -1;
-    std::memset(n.keys, 0, sizeof(n.keys));
-    std::fill(n.children, n.children + ORDER + 1, -1L);
-
-    // Write this empty node to its page via buffer:
+
+    // Write this empty node to its page via buffer.  Nobody can reach it until
+    // the caller links it into a (write-locked) parent or sibling.
     writeNode(n);
 
-    // Expand fileCount:
-    ++pageCount;
+    // Its latch moves on as if it had been written under it, so nothing
+    // cached or copied for the page's previous life can be taken as current.
+    NodeLatch& latch = state->latch(newPage);
+    latch.version.fetch_add(2 * LOCKED_BIT, std::memory_order_acq_rel);
+    state->retire(latch.cached.exchange(nullptr));
     return newPage;
 }
 
+void BPlusTree::freeNode(long page) {
+    state->retire(state->latch(page).cached.exchange(nullptr));
+    std::lock_guard<std::mutex> guard(state->allocMtx);
+    Node n(false);
+    n.selfPage = page;
+    n.nextLeafPage = state->freeListHead;
+    writeNode(n);
+    state->freeListHead = page;
+    writeHeader();
+}
+
 // 
-// writeNode: serialize a Node object into its 4 KB buffer, then unpin dirty
+// writeNode: encode a Node object into its 4 KB buffer, then unpin dirty
 // 
 
+namespace {
+
+    /// Byte offsets inside a node page; see the class comment for the layout.
+    constexpr std::size_t NODE_IS_LEAF = 0;
+    constexpr std::size_t NODE_PREFIX_LEN = 1;
+    constexpr std::size_t NODE_KEY_COUNT = 2;
+    constexpr std::size_t NODE_HEAP_START = 4;
+    constexpr std::size_t NODE_FLAGS = 6;
+    constexpr std::size_t NODE_NEXT_LEAF = 8;
+    constexpr std::size_t NODE_FIRST_CHILD = 16;
+    constexpr std::size_t NODE_PREV_LEAF = 16;  // leaves have no first child
+
+    /// NODE_FLAGS bits.
+    constexpr uint8_t FLAG_PAYLOADS = 1;  // each key suffix is followed by (u8 length, payload)
+
+    /// Put a leaf entry at `pos`.  Once any entry in the leaf has a payload,
+    /// `payloads` runs parallel to `keys`, with "" for those that have none.
+    void insertLeafEntry(BPlusTree::Node& leaf, int pos, const BPlusTree::Entry& e) {
+        if (!leaf.payloads.empty() || !e.payload.empty()) {
+            leaf.payloads.resize(leaf.keys.size());
+            leaf.payloads.insert(leaf.payloads.begin() + pos, e.payload);
+        }
+        leaf.keys.insert(leaf.keys.begin() + pos, e.key);
+        leaf.children.insert(leaf.children.begin() + pos, e.offset);
+    }
+
+    void eraseLeafEntry(BPlusTree::Node& leaf, int pos) {
+        leaf.keys.erase(leaf.keys.begin() + pos);
+        leaf.children.erase(leaf.children.begin() + pos);
+        if (!leaf.payloads.empty()) leaf.payloads.erase(leaf.payloads.begin() + pos);
+    }
+}
+
 void BPlusTree::writeNode(const Node& node) {
+    const int n = node.keyCount();
+    const int prefix = n > 0 ? commonPrefix(node.keys.front(), node.keys.back()) : 0;
+    const bool payloads = node.isLeaf && !node.payloads.empty();
+    int size = NODE_HEADER_SIZE + prefix + n * SLOT_SIZE;
+    for (const std::string& k : node.keys) size += static_cast<int>(k.size()) - prefix;
+    if (payloads) {
+        for (const std::string& p : node.payloads) size += 1 + static_cast<int>(p.size());
+    }
+    if (size > PAGE_SIZE) {
+        // Callers split before this can happen; refuse rather than corrupt.
+        std::cerr << "[BPlusTree] writeNode: page " << node.selfPage << " overflows ("
+            << size << " bytes)\n";
+        return;
+    }
+
     // 1) Pin the page in the INDEX partition:
     char* pageBuf = bufMgr.getPage(filePath,
         static_cast<uint32_t>(node.selfPage),
@@ -69,32 +559,42 @@ void BPlusTree::writeNode(const Node& node) {
         return;
     }
 
-    // 2) Zero?fill the entire 4 KB page buffer first:
+    // 2) Zero-fill the entire 4 KB page buffer first:
     std::memset(pageBuf, 0, PAGE_SIZE);
 
-    // 3) Copy header fields into buffer at offset 0:
-    std::size_t offset = 0;
-    std::memcpy(pageBuf + offset, &node.isLeaf, sizeof(node.isLeaf));
-    offset += sizeof(node.isLeaf);
-
-    std::memcpy(pageBuf + offset, &node.keyCount, sizeof(node.keyCount));
-    offset += sizeof(node.keyCount);
-
-    std::memcpy(pageBuf + offset, &node.parentPage, sizeof(node.parentPage));
-    offset += sizeof(node.parentPage);
-
-    std::memcpy(pageBuf + offset, &node.nextLeafPage, sizeof(node.nextLeafPage));
-    offset += sizeof(node.nextLeafPage);
-
-    // 4) Copy the entire keys[][] array:
-    std::memcpy(pageBuf + offset, node.keys, sizeof(node.keys));
-    offset += sizeof(node.keys);
-
-    // 5) Copy the entire children[] array:
-    std::memcpy(pageBuf + offset, node.children, sizeof(node.children));
-    // (offset += sizeof(node.children); // not needed further)
+    // 3) Node header, then the shared prefix right after it:
+    long firstChild = !node.isLeaf && !node.children.empty() ? node.children[0] : -1;
+    storeField<uint8_t>(pageBuf, NODE_IS_LEAF, node.isLeaf ? 1 : 0);
+    storeField<uint8_t>(pageBuf, NODE_PREFIX_LEN, static_cast<uint8_t>(prefix));
+    storeField<uint16_t>(pageBuf, NODE_KEY_COUNT, static_cast<uint16_t>(n));
+    storeField<uint8_t>(pageBuf, NODE_FLAGS, payloads ? FLAG_PAYLOADS : 0);
+    storeField(pageBuf, NODE_NEXT_LEAF, node.nextLeafPage);
+    if (node.isLeaf) storeField(pageBuf, NODE_PREV_LEAF, node.prevLeafPage);
+    else             storeField(pageBuf, NODE_FIRST_CHILD, firstChild);
+    if (n > 0) std::memcpy(pageBuf + NODE_HEADER_SIZE, node.keys[0].data(), prefix);
+
+    // 4) Slots grow up from the prefix, key suffixes (each followed by its
+    //    payload, if any) grow down from the end:
+    std::size_t slot = NODE_HEADER_SIZE + prefix;
+    std::size_t heap = PAGE_SIZE;
+    for (int i = 0; i < n; ++i) {
+        std::size_t len = node.keys[i].size() - prefix;
+        if (payloads) {
+            const std::string& p = node.payloads[i];
+            heap -= 1 + p.size();
+            storeField<uint8_t>(pageBuf, heap, static_cast<uint8_t>(p.size()));
+            std::memcpy(pageBuf + heap + 1, p.data(), p.size());
+        }
+        heap -= len;
+        std::memcpy(pageBuf + heap, node.keys[i].data() + prefix, len);
+        storeField<uint16_t>(pageBuf, slot, static_cast<uint16_t>(heap));
+        storeField<uint8_t>(pageBuf, slot + 2, static_cast<uint8_t>(len));
+        storeField(pageBuf, slot + 3, node.children[node.isLeaf ? i : i + 1]);
+        slot += SLOT_SIZE;
+    }
+    storeField<uint16_t>(pageBuf, NODE_HEAP_START, static_cast<uint16_t>(heap));
 
-    // 6) Unpin, marking dirty so buffer will schedule a write later:
+    // 5) Unpin, marking dirty so buffer will schedule a write later:
     bufMgr.unpinPage(filePath,
         static_cast<uint32_t>(node.selfPage),
         PageType::INDEX,
@@ -103,7 +603,7 @@ void BPlusTree::writeNode(const Node& node) {
 
 // 
 // readNode: fetch a 4 KB page from buffer (loading from disk if needed) and
-//           deserialize into a Node struct
+//           decode it into a Node struct
 // 
 
 BPlusTree::Node BPlusTree::readNode(long page) {
@@ -117,31 +617,42 @@ BPlusTree::Node BPlusTree::readNode(long page) {
         return node; // returns an empty node (undefined)
     }
 
-    // 2) Deserialize header:
-    std::size_t offset = 0;
-    std::memcpy(&node.isLeaf, pageBuf + offset, sizeof(node.isLeaf));
-    offset += sizeof(node.isLeaf);
-
-    std::memcpy(&node.keyCount, pageBuf + offset, sizeof(node.keyCount));
-    offset += sizeof(node.keyCount);
-
-    std::memcpy(&node.parentPage, pageBuf + offset, sizeof(node.parentPage));
-    offset += sizeof(node.parentPage);
-
-    std::memcpy(&node.nextLeafPage, pageBuf + offset, sizeof(node.nextLeafPage));
-    offset += sizeof(node.nextLeafPage);
-
-    // 3) Deserialize keys[][]:
-    std::memcpy(node.keys, pageBuf + offset, sizeof(node.keys));
-    offset += sizeof(node.keys);
-
-    // 4) Deserialize children[]:
-    std::memcpy(node.children, pageBuf + offset, sizeof(node.children));
-    offset += sizeof(node.children);
-
+    // 2) Decode header; a slot array running off the page means a damaged
+    //    page, which reads as empty rather than crashing.
+    node.isLeaf = loadField<uint8_t>(pageBuf, NODE_IS_LEAF) != 0;
+    int prefix = loadField<uint8_t>(pageBuf, NODE_PREFIX_LEN);
+    int n = loadField<uint16_t>(pageBuf, NODE_KEY_COUNT);
+    bool payloads = node.isLeaf && (loadField<uint8_t>(pageBuf, NODE_FLAGS) & FLAG_PAYLOADS);
+    node.nextLeafPage = loadField<long>(pageBuf, NODE_NEXT_LEAF);
+    if (NODE_HEADER_SIZE + prefix + n * SLOT_SIZE > PAGE_SIZE) n = 0;
+    if (!node.isLeaf) node.children.push_back(loadField<long>(pageBuf, NODE_FIRST_CHILD));
+    else              node.prevLeafPage = loadField<long>(pageBuf, NODE_PREV_LEAF);
+    if (payloads) node.payloads.reserve(n);
+
+    // 3) Rebuild each key from the prefix and its slot's suffix:
+    const char* prefixBytes = pageBuf + NODE_HEADER_SIZE;
+    std::size_t slot = NODE_HEADER_SIZE + prefix;
+    node.keys.reserve(n);
+    node.children.reserve(n + 1);
+    for (int i = 0; i < n; ++i, slot += SLOT_SIZE) {
+        std::size_t off = loadField<uint16_t>(pageBuf, slot);
+        std::size_t len = loadField<uint8_t>(pageBuf, slot + 2);
+        if (off + len > PAGE_SIZE) len = 0;
+        std::string key;
+        key.reserve(prefix + len);
+        key.append(prefixBytes, prefix).append(pageBuf + off, len);
+        node.keys.push_back(std::move(key));
+        node.children.push_back(loadField<long>(pageBuf, slot + 3));
+        if (payloads) {
+            std::size_t at = off + len;
+            std::size_t plen = at < PAGE_SIZE ? loadField<uint8_t>(pageBuf, at) : 0;
+            if (at + 1 + plen > PAGE_SIZE) plen = 0;
+            node.payloads.emplace_back(pageBuf + at + 1, plen);
+        }
+    }
     node.selfPage = page;
 
-    // 5) Unpin without marking dirty (read?only):
+    // 4) Unpin without marking dirty (read-only):
     bufMgr.unpinPage(filePath,
         static_cast<uint32_t>(page),
         PageType::INDEX,
@@ -150,203 +661,596 @@ BPlusTree::Node BPlusTree::readNode(long page) {
     return node;
 }
 
+BPlusTree::Node BPlusTree::readFixedSlotNode(long page) {
+    // Format 2 and older: bool isLeaf, int keyCount, long parentPage,
+    // long nextLeafPage, char keys[84][40], long children[85].
+    constexpr int OLD_ORDER = 84;
+    constexpr std::size_t OLD_KEYS = sizeof(bool) + sizeof(int) + 2 * sizeof(long);
+    constexpr std::size_t OLD_CHILDREN = OLD_KEYS + OLD_ORDER * KEY_SIZE;
+
+    Node node;
+    char* pageBuf = bufMgr.getPage(filePath, static_cast<uint32_t>(page), PageType::INDEX);
+    if (!pageBuf) {
+        std::cerr << "[BPlusTree] readFixedSlotNode: cannot pin page " << page << "\n";
+        return node;
+    }
+    node.isLeaf = loadField<bool>(pageBuf, 0);
+    int n = std::clamp(loadField<int>(pageBuf, sizeof(bool)), 0, OLD_ORDER);
+    node.nextLeafPage = loadField<long>(pageBuf, sizeof(bool) + sizeof(int) + sizeof(long));
+    for (int i = 0; i < n; ++i) {
+        const char* k = pageBuf + OLD_KEYS + i * KEY_SIZE;
+        node.keys.emplace_back(k, strnlen(k, KEY_SIZE));
+    }
+    int ptrs = n + (node.isLeaf ? 0 : 1);
+    for (int i = 0; i < ptrs; ++i) {
+        node.children.push_back(loadField<long>(pageBuf, OLD_CHILDREN + i * sizeof(long)));
+    }
+    node.selfPage = page;
+    bufMgr.unpinPage(filePath, static_cast<uint32_t>(page), PageType::INDEX, /*isDirty=*/false);
+    return node;
+}
+
+
+namespace {
+
+    /// Compare the key in 'slot' (page prefix + slot suffix) with 'key', like
+    /// std::string::compare, without building the stored key.
+    int compareStored(const char* page, int prefix, std::size_t slot, const std::string& key) {
+        std::size_t head = std::min<std::size_t>(prefix, key.size());
+        int c = std::memcmp(page + BPlusTree::NODE_HEADER_SIZE, key.data(), head);
+        if (c != 0) return c;
+        if (key.size() < static_cast<std::size_t>(prefix)) return 1;
+
+        std::size_t off = loadField<uint16_t>(page, slot);
+        std::size_t len = loadField<uint8_t>(page, slot + 2);
+        if (off + len > BPlusTree::PAGE_SIZE) len = 0;
+        return std::string_view(page + off, len).compare(std::string_view(key).substr(prefix));
+    }
+}
+
+bool BPlusTree::probePage(long page, const std::string& key, bool leftmost,
+    bool& isLeaf, long& result)
+{
+    const char* pageBuf = bufMgr.getPage(filePath, static_cast<uint32_t>(page), PageType::INDEX);
+    if (!pageBuf) {
+        std::cerr << "[BPlusTree] probePage: cannot pin page " << page << "\n";
+        return false;
+    }
+    isLeaf = loadField<uint8_t>(pageBuf, NODE_IS_LEAF) != 0;
+    int prefix = loadField<uint8_t>(pageBuf, NODE_PREFIX_LEN);
+    int n = loadField<uint16_t>(pageBuf, NODE_KEY_COUNT);
+    if (NODE_HEADER_SIZE + prefix + n * SLOT_SIZE > PAGE_SIZE) n = 0;
+    auto slotAt = [&](int i) { return NODE_HEADER_SIZE + prefix + i * SLOT_SIZE; };
+
+    if (!isLeaf) {
+        // child[i] holds keys in [keys[i-1], keys[i]), so count the keys <= key
+        int lo = 0, hi = leftmost ? 0 : n;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (compareStored(pageBuf, prefix, slotAt(mid), key) <= 0) lo = mid + 1;
+            else hi = mid;
+        }
+        result = lo == 0 ? loadField<long>(pageBuf, NODE_FIRST_CHILD)
+                         : loadField<long>(pageBuf, slotAt(lo - 1) + 3);
+    }
+    else {
+        int lo = 0, hi = n;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (compareStored(pageBuf, prefix, slotAt(mid), key) < 0) lo = mid + 1;
+            else hi = mid;
+        }
+        bool hit = lo < n && compareStored(pageBuf, prefix, slotAt(lo), key) == 0;
+        result = hit ? loadField<long>(pageBuf, slotAt(lo) + 3) : -1;
+    }
+
+    bufMgr.unpinPage(filePath, static_cast<uint32_t>(page), PageType::INDEX, /*isDirty=*/false);
+    return true;
+}
+
 // 
-// insert: public entry point
+// Slot helpers
 // 
 
-void BPlusTree::insert(const std::string& key, long recordOffset) {
-    if (pageCount == 0) {
-        // Empty file ? create root
-        long rootPage = allocateNode();
-        (void)rootPage;
+int BPlusTree::childIndex(const Node& node, const std::string& key) {
+    // child[i] holds keys in [keys[i-1], keys[i]), so count the keys <= key
+    return static_cast<int>(std::upper_bound(node.keys.begin(), node.keys.end(), key)
+        - node.keys.begin());
+}
+
+int BPlusTree::lowerBound(const Node& node, const std::string& key) {
+    return static_cast<int>(std::lower_bound(node.keys.begin(), node.keys.end(), key)
+        - node.keys.begin());
+}
+
+int BPlusTree::nodeBytes(const Node& node, const Entry* extra) {
+    int n = node.keyCount();
+    int total = 0;
+    for (const std::string& k : node.keys) total += static_cast<int>(k.size());
+    if (extra) {
+        ++n;
+        total += static_cast<int>(extra->key.size());
     }
-    Node root = readNode(0);
-    insertRecursive(root, key, recordOffset);
+    if (!node.payloads.empty() || (extra && !extra->payload.empty())) {
+        // a length byte per entry, whether it has a payload or not
+        total += n;
+        for (const std::string& p : node.payloads) total += static_cast<int>(p.size());
+        if (extra) total += static_cast<int>(extra->payload.size());
+    }
+
+    int prefix = 0;
+    if (node.isLeaf && n > 0) {
+        // Keys are sorted, so the prefix shared by all is that of the extremes.
+        const std::string* key = extra ? &extra->key : nullptr;
+        const std::string& first = key && (node.keys.empty() || *key < node.keys.front())
+            ? *key : node.keys.front();
+        const std::string& last = key && (node.keys.empty() || node.keys.back() < *key)
+            ? *key : node.keys.back();
+        prefix = commonPrefix(first, last);
+    }
+    return NODE_HEADER_SIZE + prefix + n * SLOT_SIZE + total - n * prefix;
 }
 
 // 
-// search: standard B+ Tree lookup
+// enterRoot / descendToLeaf: optimistic root-to-leaf walk with lock coupling
 // 
 
-bool BPlusTree::search(const std::string& key, long& recordOffset) {
-    if (pageCount == 0) return false;
-    long page = 0;  // start at root
+bool BPlusTree::enterRoot(Node& root, uint64_t& version, uint64_t& headerVersion) {
+    // The header latch guards the root pointer the same way a parent's latch
+    // guards its child pointers.
+    NodeLatch& header = state->latch(HEADER_PAGE);
+    headerVersion = readLock(header);
+    long rootPage = state->rootPage.load();
+    NodeLatch& latch = state->latch(rootPage);
+    version = readLock(latch);
+    if (!validate(header, headerVersion)) return false;
+
+    root = fetchNode(rootPage, version);
+    return validate(latch, version);
+}
+
+BPlusTree::Node BPlusTree::fetchNode(long page, uint64_t version) {
+    NodeLatch& latch = state->latch(page);
+    if (const CachedInner* c = cachedAt(latch, page, version)) {
+        return c->node;
+    }
+    Node node = readNode(page);
+    if (!node.isLeaf && validate(latch, version)) {
+        state->install(page, version, node);
+    }
+    return node;
+}
+
+bool BPlusTree::descendToLeafPage(const std::string& key, bool leftmost,
+    long& leafPage, uint64_t& version, long& match)
+{
+    // Readers search the page images in place; only writers decode nodes.
+    NodeLatch& header = state->latch(HEADER_PAGE);
+    uint64_t headerVersion = readLock(header);
+    long page = state->rootPage.load();
+    NodeLatch* latch = &state->latch(page);
+    version = readLock(*latch);
+    if (!validate(header, headerVersion)) return false;
 
     while (true) {
-        Node node = readNode(page);
-        int i = 0;
-        // find first key ? desired
-        while (i < node.keyCount && key > std::string(node.keys[i])) {
-            ++i;
+        long next;
+        NodeLatch* childLatch;
+        if (const CachedInner* c = cachedAt(*latch, page, version)) {
+            // Inner level in memory: follow the swizzled pointer, no buffer pool.
+            int slot = leftmost ? 0 : childIndex(c->node, key);
+            next = c->node.children[slot];
+            childLatch = c->childLatches[slot];
         }
-        if (node.isLeaf) {
-            if (i < node.keyCount && key == std::string(node.keys[i])) {
-                recordOffset = node.children[i];
-                return true;
+        else {
+            bool isLeaf;
+            if (!probePage(page, key, leftmost, isLeaf, next)) return false;
+            if (isLeaf) {
+                match = next;
+                break;
             }
-            return false;
+            // First visit since the page last changed: cache it for next time.
+            fetchNode(page, version);
+            childLatch = &state->latch(next);
         }
-        // Not leaf ? descend into child[i]
-        page = node.children[i];
+        uint64_t childVersion = readLock(*childLatch);
+        // What we read, and so the pointer we followed, must still be current
+        // when we enter the child.
+        if (!validate(*latch, version)) return false;
+
+        page = next;
+        latch = childLatch;
+        version = childVersion;
     }
+    if (!validate(*latch, version)) return false;
+    leafPage = page;
+    return true;
+}
+
+bool BPlusTree::descendToLeaf(const std::string& key, bool leftmost,
+    Node& leaf, uint64_t& version)
+{
+    long leafPage, match;
+    if (!descendToLeafPage(key, leftmost, leafPage, version, match)) return false;
+    leaf = readNode(leafPage);
+    return validate(state->latch(leafPage), version);
+}
+
+bool BPlusTree::readNeighbour(long page, Node& leaf, uint64_t& version) {
+    NodeLatch& latch = state->latch(page);
+    version = readLock(latch);
+    leaf = readNode(page);
+    return validate(latch, version);
 }
 
 // 
-// insertRecursive: insert into a nodes subtree
+// insert: public entry point
 // 
 
-void BPlusTree::insertRecursive(Node& node,
-    const std::string& key,
-    long recordOffset)
-{
-    if (node.isLeaf) {
-        // 1) Find position to insert (sorted)
-        int pos = std::lower_bound(
-            &node.keys[0],
-            &node.keys[node.keyCount],
-            key,
-            [](const char a[KEY_SIZE], const std::string& k) {
-                return std::string(a) < k;
-            }
-        ) - &node.keys[0];
+void BPlusTree::insert(const std::string& key, long recordOffset, const std::string& payload) {
+    insertBatch({ { key, recordOffset, payload } });
+}
 
-        // 2) Shift keys/children right
-        for (int j = node.keyCount; j > pos; --j) {
-            std::memcpy(node.keys[j], node.keys[j - 1], KEY_SIZE);
-            node.children[j] = node.children[j - 1];
+void BPlusTree::insertBatch(std::vector<Entry> entries) {
+    if (entries.empty()) return;
+    // A longer key would be stored cut and then never found by its full
+    // value; callers turn such keys away (IndexManager::keyFits).
+    auto tooLong = [](const Entry& e) { return e.key.size() >= KEY_SIZE; };
+    if (std::any_of(entries.begin(), entries.end(), tooLong)) {
+        std::cerr << "[BPlusTree] insert: key longer than " << KEY_SIZE - 1
+            << " bytes not stored in " << filePath << "\n";
+        entries.erase(std::remove_if(entries.begin(), entries.end(), tooLong), entries.end());
+        if (entries.empty()) return;
+    }
+    for (auto& e : entries) {
+        if (e.payload.size() > MAX_PAYLOAD_SIZE) e.payload.resize(MAX_PAYLOAD_SIZE);
+    }
+    if (entries.size() > 1) {
+        std::stable_sort(entries.begin(), entries.end(),
+            [](const Entry& a, const Entry& b) { return a.key < b.key; });
+    }
+    SharedState::Section section(*state);
+    noteModified();
+
+    // Keys go into the filter before the tree, so a reader that finds one in
+    // a leaf can never be told "absent" by the filter.
+    std::shared_ptr<BloomFilter> f = state->filter.load();
+    if (f) {
+        for (const auto& e : entries) f->add(e.key);
+    }
+    bool loaded = false;
+    if (isEmpty()) {
+        // Empty file ? a batch is written bottom-up from its sorted keys, as
+        // compact() does, instead of one split after another; a single key
+        // gets a header + root.  Either way nothing is published before its
+        // pages are written, so no reader ever sees them half-initialized.
+        std::lock_guard<std::mutex> guard(state->rootMtx);
+        if (isEmpty() && entries.size() > 1) {
+            bulkLoad(entries);
+            loaded = true;
+        }
+        else if (isEmpty()) {
+            state->pageCount.store(HEADER_PAGE + 1);
+            Node root(true);
+            root.selfPage = allocateNode();
+            writeNode(root);
+            std::lock_guard<std::mutex> alloc(state->allocMtx);
+            state->height.store(1);
+            state->rootPage.store(root.selfPage);
+            writeHeader();
         }
+    }
+    std::size_t done = loaded ? entries.size() : 0;
+    while (done < entries.size()) {
+        // Each successful attempt fills one leaf with as many keys as belong
+        // there; a failed one means a concurrent writer changed our path.
+        tryInsert(entries.data(), entries.size(), done);
+    }
+    std::shared_ptr<BloomFilter> n = state->newest.load();
+    if (n && n != f) {
+        for (const auto& e : entries) n->add(e.key);
+    }
+    if (n && n->needsRebuild()) rebuildFilter();
+}
 
-        // 3) Copy new key into keys[pos]
-        size_t len = std::min(key.size(), static_cast<size_t>(KEY_SIZE - 1));
-        std::memcpy(node.keys[pos], key.data(), len);
-        node.keys[pos][len] = '\0';
+bool BPlusTree::tryInsert(const Entry* entries, std::size_t count, std::size_t& done) {
+    const std::string& key = entries[done].key;
+    Node node;
+    uint64_t version, headerVersion;
+    if (!enterRoot(node, version, headerVersion)) return false;
+    NodeLatch* latch = &state->latch(node.selfPage);
 
-        // 4) Insert recordOffset
-        node.children[pos] = recordOffset;
-        node.keyCount++;
+    NodeLatch* parentLatch = nullptr;
+    uint64_t parentVersion = 0;
+    Node parent;
+    std::string fence;                 // the leaf holds keys below this...
+    bool fenced = false;               // ...if the path ever went left of a separator
 
-        // 5) Write back this node
-        writeNode(node);
-    }
-    else {
-        // Not leaf: find child to descend
-        int pos = std::lower_bound(
-            &node.keys[0],
-            &node.keys[node.keyCount],
-            key,
-            [](const char a[KEY_SIZE], const std::string& k) {
-                return std::string(a) < k;
+    while (true) {
+        // A leaf is full if the key doesn't fit; an inner node if it couldn't
+        // take the separator of a child split, whatever that turns out to be.
+        bool full = node.isLeaf ? nodeBytes(node, &entries[done]) > PAGE_SIZE
+                                : nodeBytes(node) + MAX_ENTRY_SIZE > PAGE_SIZE;
+        if (full && node.keyCount() >= 2) {
+            // Full node: split it now, while the parent is known to have room
+            // (every full node above us was already split on an earlier pass).
+            // The root's "parent" is the header page holding the root pointer.
+            // A leaf's successor gets a new left neighbour, so it is
+            // latched too.  (The root, when a leaf, is the only leaf.)
+            Node next;
+            NodeLatch* nextLatch = nullptr;
+            uint64_t nextVersion = 0;
+            if (node.isLeaf && node.nextLeafPage != -1) {
+                if (!readNeighbour(node.nextLeafPage, next, nextVersion)) return false;
+                nextLatch = &state->latch(next.selfPage);
+            }
+            NodeLatch* above = parentLatch ? parentLatch : &state->latch(HEADER_PAGE);
+            if (!upgrade(*above, parentLatch ? parentVersion : headerVersion)) return false;
+            if (!upgrade(*latch, version)) {
+                writeUnlock(*above);
+                return false;
             }
-        ) - &node.keys[0];
+            if (nextLatch && !upgrade(*nextLatch, nextVersion)) {
+                writeUnlock(*latch);
+                writeUnlock(*above);
+                return false;
+            }
+            if (parentLatch) splitChild(parent, node, nextLatch ? &next : nullptr);
+            else             splitRoot(node);
+            if (nextLatch) writeUnlock(*nextLatch);
+            writeUnlock(*latch);
+            writeUnlock(*above);
+            return false;  // restart: the key may now belong to the new sibling
+        }
 
-        Node child = readNode(node.children[pos]);
-        insertRecursive(child, key, recordOffset);
-    }
+        if (node.isLeaf) {
+            if (!upgrade(*latch, version)) return false;
+
+            // Take the key, then every following one that belongs in this
+            // leaf and still fits, and write the page once.
+            std::size_t first = done;
+            do {
+                const Entry& e = entries[done];
+                insertLeafEntry(node, lowerBound(node, e.key), e);
+                ++done;
+            } while (done < count
+                && (!fenced || entries[done].key < fence)
+                && nodeBytes(node, &entries[done]) <= PAGE_SIZE);
+
+            writeNode(node);
+            writeUnlock(*latch);
+            state->keyCount.fetch_add(static_cast<long>(done - first));
+            return true;
+        }
 
-    // If overflowed, split
-    if (node.keyCount > ORDER) {
-        splitNode(node);
+        // Not leaf: find child to descend
+        int slot = childIndex(node, key);
+        long childPage = node.children[slot];
+        NodeLatch* childLatch = &state->latch(childPage);
+        uint64_t childVersion = readLock(*childLatch);
+        if (!validate(*latch, version)) return false;
+
+        Node child = fetchNode(childPage, childVersion);
+        if (!validate(*childLatch, childVersion)) return false;
+
+        parent = node;
+        parentLatch = latch;
+        parentVersion = version;
+        if (slot < parent.keyCount()) {
+            fence = parent.keys[slot];
+            fenced = true;
+        }
+        node = child;
+        latch = childLatch;
+        version = childVersion;
     }
 }
 
 // 
-// splitNode: when node.keyCount > ORDER, split into two pages
+// search: standard B+ Tree lookup
 // 
 
-void BPlusTree::splitNode(Node& node) {
-    // 1) Create right sibling
-    Node right(node.isLeaf);
-    right.selfPage = allocateNode();
-    right.parentPage = node.parentPage;
+bool BPlusTree::search(const std::string& key, long& recordOffset) {
+    if (isEmpty()) return false;
+    bool found = false;
+    SharedState::Section section(*state);
+    while (!trySearch(key, found, recordOffset)) {
+        // leaf or path changed under us; retry
+    }
+    return found;
+}
+
+bool BPlusTree::trySearch(const std::string& key, bool& found, long& recordOffset) {
+    long leafPage, match;
+    uint64_t version;
+    if (!descendToLeafPage(key, false, leafPage, version, match)) return false;
 
-    int mid = node.keyCount / 2;
+    found = match != -1;
+    if (found) recordOffset = match;
+    return true;
+}
 
-    // 2) Move keys[mid..end) & children into right
-    for (int i = mid; i < node.keyCount; ++i) {
-        std::memcpy(right.keys[i - mid], node.keys[i], KEY_SIZE);
-        right.children[i - mid + (node.isLeaf ? 0 : 1)] =
-            node.children[i + (node.isLeaf ? 0 : 1)];
+bool BPlusTree::searchCovering(const std::string& key, long& recordOffset, std::string& payload) {
+    if (isEmpty()) return false;
+    SharedState::Section section(*state);
+    Node leaf;
+    uint64_t version;
+    while (!descendToLeaf(key, false, leaf, version)) {
+        // leaf or path changed under us; retry
     }
-    right.keyCount = node.keyCount - mid;
-    node.keyCount = mid;
+    int pos = lowerBound(leaf, key);
+    if (pos == leaf.keyCount() || leaf.keys[pos] != key) return false;
+    recordOffset = leaf.children[pos];
+    payload = leaf.payloads.empty() ? std::string() : leaf.payloads[pos];
+    return true;
+}
 
-    // 3) If leaf, fix next?leaf pointers
-    if (node.isLeaf) {
-        right.nextLeafPage = node.nextLeafPage;
-        node.nextLeafPage = right.selfPage;
+int BPlusTree::searchBatch(const std::vector<std::string>& keys, std::vector<long>& offsets,
+    std::vector<std::string>* payloads)
+{
+    offsets.assign(keys.size(), -1);
+    if (payloads) payloads->assign(keys.size(), std::string());
+    if (isEmpty() || keys.empty()) return 0;
+
+    // Visit the keys in sorted order so neighbours share a leaf.  Keys the
+    // filter rules out need no visit at all.
+    std::vector<std::size_t> order;
+    order.reserve(keys.size());
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        if (mayContain(keys[i])) order.push_back(i);
     }
+    std::sort(order.begin(), order.end(),
+        [&](std::size_t a, std::size_t b) { return keys[a] < keys[b]; });
 
-    // 4) Write both pages out
-    writeNode(node);
-    writeNode(right);
+    SharedState::Section section(*state);
+    std::size_t done = 0;
+    while (done < order.size()) {
+        trySearchBatch(keys, order, done, offsets, payloads);
+    }
+    return static_cast<int>(std::count_if(offsets.begin(), offsets.end(),
+        [](long off) { return off != -1; }));
+}
+
+bool BPlusTree::trySearchBatch(const std::vector<std::string>& keys,
+    const std::vector<std::size_t>& order, std::size_t& done, std::vector<long>& offsets,
+    std::vector<std::string>* payloads)
+{
+    const std::string& key = keys[order[done]];
+    Node node;
+    uint64_t version, headerVersion;
+    if (!enterRoot(node, version, headerVersion)) return false;
+    NodeLatch* latch = &state->latch(node.selfPage);
+
+    std::string fence;
+    bool fenced = false;
+    while (!node.isLeaf) {
+        int slot = childIndex(node, key);
+        if (slot < node.keyCount()) {
+            fence = node.keys[slot];
+            fenced = true;
+        }
+        long childPage = node.children[slot];
+        NodeLatch* childLatch = &state->latch(childPage);
+        uint64_t childVersion = readLock(*childLatch);
+        if (!validate(*latch, version)) return false;
+
+        Node child = fetchNode(childPage, childVersion);
+        if (!validate(*childLatch, childVersion)) return false;
+        node = std::move(child);
+        latch = childLatch;
+        version = childVersion;
+    }
 
-    // 5) Promote the first key of right to parent
-    std::string promoteKey(right.keys[0]);
+    // 'node' is a validated copy of the leaf; answer every key it covers.
+    do {
+        const std::string& k = keys[order[done]];
+        int pos = lowerBound(node, k);
+        if (pos < node.keyCount() && node.keys[pos] == k) {
+            offsets[order[done]] = node.children[pos];
+            if (payloads && !node.payloads.empty()) (*payloads)[order[done]] = node.payloads[pos];
+        }
+        ++done;
+    } while (done < order.size() && (!fenced || keys[order[done]] < fence));
+    return true;
+}
 
-    if (node.selfPage == 0) {
-        // Node was root ? create a new root
-        Node newRoot(false);
-        newRoot.selfPage = allocateNode();
-        newRoot.children[0] = node.selfPage;
-        newRoot.children[1] = right.selfPage;
+// 
+// splitNode helpers: move the upper half of a full node into a sibling
+// 
 
-        size_t len = std::min(promoteKey.size(), static_cast<size_t>(KEY_SIZE - 1));
-        std::memcpy(newRoot.keys[0], promoteKey.data(), len);
-        newRoot.keys[0][len] = '\0';
-        newRoot.keyCount = 1;
+namespace {
 
-        node.parentPage = newRoot.selfPage;
-        right.parentPage = newRoot.selfPage;
+    /// Moves the upper half (by bytes) of 'node' into the empty 'right' and
+    /// returns the separator that belongs in the parent between them.
+    std::string moveUpperHalf(BPlusTree::Node& node, BPlusTree::Node& right) {
+        const int mid = balancedSplit(node.keys, node.payloads, node.isLeaf);
+        std::string separator;
 
-        writeNode(node);
-        writeNode(right);
-        writeNode(newRoot);
-    }
-    else {
-        // Insert promoteKey into parent
-        insertInParent(node, promoteKey, right);
+        if (node.isLeaf) {
+            // Leaves keep every key; the separator is the shortest string
+            // between the halves (suffix truncation).
+            separator = shortestSeparator(node.keys[mid - 1], node.keys[mid]);
+            right.keys.assign(node.keys.begin() + mid, node.keys.end());
+            right.children.assign(node.children.begin() + mid, node.children.end());
+            node.children.resize(mid);
+            if (!node.payloads.empty()) {
+                right.payloads.assign(node.payloads.begin() + mid, node.payloads.end());
+                node.payloads.resize(mid);
+            }
+        }
+        else {
+            // Inner nodes push keys[mid] up; children mid+1..n move right.
+            separator = node.keys[mid];
+            right.keys.assign(node.keys.begin() + mid + 1, node.keys.end());
+            right.children.assign(node.children.begin() + mid + 1, node.children.end());
+            node.children.resize(mid + 1);
+        }
+        node.keys.resize(mid);
+        return separator;
     }
 }
 
 // 
-// insertInParent: after splitting child into (left=node, right), push key into parent
+// splitRoot: the old root keeps its page as the left half; a new root goes on
+// top and the header's root pointer moves to it
 // 
 
-void BPlusTree::insertInParent(Node& left,
-    const std::string& key,
-    Node& right)
-{
-    // 1) Read parent
-    Node parent = readNode(left.parentPage);
+void BPlusTree::splitRoot(Node& root) {
+    Node right(root.isLeaf);
+    right.selfPage = allocateNode();
 
-    // 2) Find position in parent to insert key
-    int pos = 0;
-    while (pos <= parent.keyCount && parent.children[pos] != left.selfPage) {
-        ++pos;
+    std::string separator = moveUpperHalf(root, right);
+    if (root.isLeaf) {
+        right.nextLeafPage = root.nextLeafPage;
+        right.prevLeafPage = root.selfPage;
+        root.nextLeafPage = right.selfPage;
     }
+    writeNode(right);
+    writeNode(root);
+
+    // New root: an inner node with exactly two children.
+    Node newRoot(false);
+    newRoot.selfPage = allocateNode();
+    newRoot.keys = { separator };
+    newRoot.children = { root.selfPage, right.selfPage };
+    writeNode(newRoot);
+
+    std::lock_guard<std::mutex> guard(state->allocMtx);
+    state->rootPage.store(newRoot.selfPage);
+    state->height.fetch_add(1);
+    writeHeader();
+}
 
-    // 3) Shift keys/children right
-    for (int i = parent.keyCount; i > pos; --i) {
-        std::memcpy(parent.keys[i], parent.keys[i - 1], KEY_SIZE);
-        parent.children[i + 1] = parent.children[i];
-    }
+// 
+// splitChild: split 'node' and hook the new right sibling into 'parent'
+// 
+
+void BPlusTree::splitChild(Node& parent, Node& node, Node* next) {
+    Node right(node.isLeaf);
+    right.selfPage = allocateNode();
 
-    // 4) Copy the new key
-    size_t len = std::min(key.size(), static_cast<size_t>(KEY_SIZE - 1));
-    std::memcpy(parent.keys[pos], key.data(), len);
-    parent.keys[pos][len] = '\0';
-    parent.children[pos + 1] = right.selfPage;
-    parent.keyCount++;
+    std::string separator = moveUpperHalf(node, right);
 
-    // 5) Update right's parent pointer
-    right.parentPage = parent.selfPage;
+    // If leaf, fix the chain links on both sides of the new sibling
+    if (node.isLeaf) {
+        right.nextLeafPage = node.nextLeafPage;
+        right.prevLeafPage = node.selfPage;
+        node.nextLeafPage = right.selfPage;
+        if (next) next->prevLeafPage = right.selfPage;
+    }
 
-    writeNode(parent);
+    // Right first: it is unreachable until the parent points at it.
     writeNode(right);
+    writeNode(node);
+    if (next) writeNode(*next);
 
-    if (parent.keyCount > ORDER) {
-        splitNode(parent);
+    // Find node's slot in the parent and open a gap after it.
+    int pos = 0;
+    while (pos <= parent.keyCount() && parent.children[pos] != node.selfPage) {
+        ++pos;
     }
+    parent.keys.insert(parent.keys.begin() + pos, separator);
+    parent.children.insert(parent.children.begin() + pos + 1, right.selfPage);
+    writeNode(parent);
 }
 
 // 
@@ -354,85 +1258,415 @@ void BPlusTree::insertInParent(Node& left,
 // 
 
 bool BPlusTree::remove(const std::string& key) {
-    if (pageCount == 0) return false;
-    Node root = readNode(0);
-    deleteRecursive(root, key);
-    return true;
+    if (isEmpty()) return false;
+    bool removed = false;
+    SharedState::Section section(*state);
+    while (!tryRemove(key, removed)) {
+        // leaf changed between the read and the upgrade; retry
+    }
+    if (removed) {
+        noteModified();
+        std::shared_ptr<BloomFilter> n = state->newest.load();
+        if (n) {
+            n->noteRemoved();
+            if (n->needsRebuild()) rebuildFilter();
+        }
+    }
+    return removed;
 }
 
-// 
-// deleteRecursive: delete key from subtree under 'node'
-// 
+bool BPlusTree::tryRemove(const std::string& key, bool& removed) {
+    Node node;
+    uint64_t version, headerVersion;
+    if (!enterRoot(node, version, headerVersion)) return false;
+    NodeLatch* latch = &state->latch(node.selfPage);
 
-void BPlusTree::deleteRecursive(Node& node, const std::string& key) {
-    if (node.isLeaf) {
-        // 1) Find key in this leaf
-        int pos = 0;
-        while (pos < node.keyCount && key != std::string(node.keys[pos])) ++pos;
-        if (pos == node.keyCount) return;  // not found
+    uint64_t parentVersion = 0;
+    Node parent;
+    int slot = -1;  // node's index in parent.children; -1 while at the root
 
-        // 2) Shift keys/children left
-        for (int i = pos; i < node.keyCount - 1; ++i) {
-            std::memcpy(node.keys[i], node.keys[i + 1], KEY_SIZE);
-            node.children[i] = node.children[i + 1];
+    while (true) {
+        if (slot >= 0 && nodeBytes(node) < MIN_NODE_BYTES &&
+            rebalanceChild(parent, parentVersion, node, version, slot)) {
+            // Underfull: fixed now so the removal below can't make it worse.
+            return false;  // restart: keys may have moved between siblings
         }
-        node.keyCount--;
 
-        writeNode(node);
-    }
-    else {
-        // 1) Find child to recurse
-        int pos = 0;
-        while (pos < node.keyCount && key > std::string(node.keys[pos])) ++pos;
-        Node child = readNode(node.children[pos]);
-        deleteRecursive(child, key);
+        if (node.isLeaf) {
+            // 1) Find key in this leaf
+            int pos = lowerBound(node, key);
+            if (pos == node.keyCount() || node.keys[pos] != key) {
+                removed = false;  // not found
+                return true;
+            }
+            if (!upgrade(*latch, version)) return false;
+
+            // 2) Drop the key, its record offset and payload
+            eraseLeafEntry(node, pos);
 
-        // 2) After recursion, check if child is underfull
-        child = readNode(node.children[pos]);
-        if (child.keyCount < (ORDER + 1) / 2) {
-            mergeNodes(node, pos);
+            writeNode(node);
+            writeUnlock(*latch);
+            state->keyCount.fetch_sub(1);
+            removed = true;
+            return true;
         }
+
+        // Not leaf: find child to recurse
+        int childSlot = childIndex(node, key);
+        long childPage = node.children[childSlot];
+        NodeLatch* childLatch = &state->latch(childPage);
+        uint64_t childVersion = readLock(*childLatch);
+        if (!validate(*latch, version)) return false;
+
+        Node child = fetchNode(childPage, childVersion);
+        if (!validate(*childLatch, childVersion)) return false;
+
+        parent = node;
+        parentVersion = version;
+        slot = childSlot;
+        node = child;
+        latch = childLatch;
+        version = childVersion;
     }
 }
 
 // 
-// mergeNodes: merge child at index `index` with its right sibling under `parent`
+// Underflow handling: borrow from or merge with a sibling
 // 
 
-void BPlusTree::mergeNodes(Node& parent, int index) {
-    Node left = readNode(parent.children[index]);
-    Node right = readNode(parent.children[index + 1]);
+namespace {
+
+    /// Keys and pointers of two adjacent siblings laid end to end.  For inner
+    /// nodes the parent's separator sits between them, as if they were one node.
+    /// Leaf payloads follow the keys, or stay empty if neither side has any.
+    struct Entries {
+        std::vector<std::string> keys;
+        std::vector<long>        ptrs;
+        std::vector<std::string> payloads;
+    };
+
+    Entries gather(const BPlusTree::Node& left, const std::string& separator,
+        const BPlusTree::Node& right)
+    {
+        Entries e;
+        e.keys = left.keys;
+        if (!left.isLeaf) e.keys.push_back(separator);
+        e.keys.insert(e.keys.end(), right.keys.begin(), right.keys.end());
+        e.ptrs = left.children;
+        e.ptrs.insert(e.ptrs.end(), right.children.begin(), right.children.end());
+        if (!left.payloads.empty() || !right.payloads.empty()) {
+            e.payloads = left.payloads;
+            e.payloads.resize(left.keys.size());
+            e.payloads.insert(e.payloads.end(), right.payloads.begin(), right.payloads.end());
+            e.payloads.resize(e.keys.size());
+        }
+        return e;
+    }
+
+    /// Rewrite 'node' with keys[kb, ke) and the matching pointers from pb on.
+    void fill(BPlusTree::Node& node, const Entries& e, int kb, int ke, int pb) {
+        node.keys.assign(e.keys.begin() + kb, e.keys.begin() + ke);
+        int ptrCount = (ke - kb) + (node.isLeaf ? 0 : 1);
+        node.children.assign(e.ptrs.begin() + pb, e.ptrs.begin() + pb + ptrCount);
+        if (e.payloads.empty()) node.payloads.clear();
+        else node.payloads.assign(e.payloads.begin() + kb, e.payloads.begin() + ke);
+    }
+
+    /// Drop parent.keys[index] and parent.children[index + 1].
+    void removeFromParent(BPlusTree::Node& parent, int index) {
+        parent.keys.erase(parent.keys.begin() + index);
+        parent.children.erase(parent.children.begin() + index + 1);
+    }
+}
 
-    int start = left.keyCount;
-    for (int i = 0; i < right.keyCount; ++i) {
-        std::memcpy(left.keys[start + i], right.keys[i], KEY_SIZE);
-        left.children[start + i + (left.isLeaf ? 0 : 1)] =
-            right.children[i + (left.isLeaf ? 0 : 1)];
+bool BPlusTree::rebalanceChild(Node& parent, uint64_t parentVersion,
+    Node& node, uint64_t nodeVersion, int slot)
+{
+    // Prefer the right sibling; the last child only has a left one.
+    int sibSlot = slot < parent.keyCount() ? slot + 1 : slot - 1;
+    long sibPage = parent.children[sibSlot];
+    NodeLatch& sibLatch = state->latch(sibPage);
+    uint64_t sibVersion = readLock(sibLatch);
+    Node sibling = fetchNode(sibPage, sibVersion);
+    if (!validate(sibLatch, sibVersion)) return true;
+
+    int index = std::min(slot, sibSlot);
+    Node& left = sibSlot < slot ? sibling : node;
+    Node& right = sibSlot < slot ? node : sibling;
+
+    // Merge if the pair fits comfortably in one page, otherwise even out the
+    // bytes.  Both are decided on our copies before anything is latched.
+    Node merged(left.isLeaf);
+    Entries e = gather(left, parent.keys[index], right);
+    fill(merged, e, 0, static_cast<int>(e.keys.size()), 0);
+    bool merge = nodeBytes(merged) <= PAGE_SIZE * 3 / 4;
+    if (!merge && !redistribute(parent, left, right, index)) {
+        return false;
     }
-    left.keyCount += right.keyCount;
 
+    // Merging leaves gives the leaf after them a new left neighbour.
+    Node next;
+    NodeLatch* nextLatch = nullptr;
+    uint64_t nextVersion = 0;
+    if (merge && right.isLeaf && right.nextLeafPage != -1) {
+        if (!readNeighbour(right.nextLeafPage, next, nextVersion)) return true;
+        nextLatch = &state->latch(next.selfPage);
+    }
+
+    NodeLatch& parentLatch = state->latch(parent.selfPage);
+    NodeLatch& nodeLatch = state->latch(node.selfPage);
+    if (!upgrade(parentLatch, parentVersion)) return true;
+    if (!upgrade(nodeLatch, nodeVersion)) {
+        writeUnlock(parentLatch);
+        return true;
+    }
+    if (!upgrade(sibLatch, sibVersion)) {
+        writeUnlock(nodeLatch);
+        writeUnlock(parentLatch);
+        return true;
+    }
+    if (nextLatch && !upgrade(*nextLatch, nextVersion)) {
+        writeUnlock(sibLatch);
+        writeUnlock(nodeLatch);
+        writeUnlock(parentLatch);
+        return true;
+    }
+
+    if (merge) {
+        mergeNodes(parent, left, right, index, nextLatch ? &next : nullptr);
+    }
+    else {
+        writeNode(left);
+        writeNode(right);
+        writeNode(parent);
+    }
+
+    if (nextLatch) writeUnlock(*nextLatch);
+    writeUnlock(sibLatch);
+    writeUnlock(nodeLatch);
+    writeUnlock(parentLatch);
+    return true;
+}
+
+void BPlusTree::mergeNodes(Node& parent, Node& left, Node& right, int index, Node* next) {
+    Entries e = gather(left, parent.keys[index], right);
+    fill(left, e, 0, static_cast<int>(e.keys.size()), 0);
     if (left.isLeaf) {
         left.nextLeafPage = right.nextLeafPage;
+        if (next) {
+            next->prevLeafPage = left.selfPage;
+            writeNode(*next);
+        }
     }
-    writeNode(left);
 
-    // Remove key+pointer from parent
-    for (int i = index; i < parent.keyCount - 1; ++i) {
-        std::memcpy(parent.keys[i], parent.keys[i + 1], KEY_SIZE);
-        parent.children[i + 1] = parent.children[i + 2];
+    // Remove key+pointer from parent and release the right page.
+    removeFromParent(parent, index);
+    freeNode(right.selfPage);
+
+    if (parent.selfPage == state->rootPage.load() && parent.keyCount() == 0) {
+        // Root has a single child left: pull it up into the root page, which
+        // stays put so the header's root pointer need not change.
+        long childPage = left.selfPage;
+        left.selfPage = parent.selfPage;
+        writeNode(left);
+        state->height.fetch_sub(1);
+        freeNode(childPage);   // also rewrites the header
+        return;
     }
-    parent.keyCount--;
+    writeNode(left);
     writeNode(parent);
+}
+
+bool BPlusTree::redistribute(Node& parent, Node& left, Node& right, int index) {
+    Entries e = gather(left, parent.keys[index], right);
+    int total = static_cast<int>(e.keys.size());
+    int half = balancedSplit(e.keys, e.payloads, left.isLeaf);
 
-    // (Optional) You might free the `right` page on disk; omitted here for simplicity.
+    Node newLeft = left, newRight = right, newParent = parent;
+    if (left.isLeaf) {
+        // Leaves keep every key; the new separator splits the two halves.
+        fill(newLeft, e, 0, half, 0);
+        fill(newRight, e, half, total, half);
+        newParent.keys[index] = shortestSeparator(e.keys[half - 1], e.keys[half]);
+    }
+    else {
+        // Inner nodes: keys[half] moves up, its neighbours split left/right.
+        fill(newLeft, e, 0, half, 0);
+        fill(newRight, e, half + 1, total, half + 1);
+        newParent.keys[index] = e.keys[half];
+    }
+
+    // With variable-length keys an even split is not always an improvement;
+    // requiring the smaller side to grow keeps repeated attempts from looping.
+    int before = std::min(nodeBytes(left), nodeBytes(right));
+    int after = std::min(nodeBytes(newLeft), nodeBytes(newRight));
+    if (after <= before || nodeBytes(newParent) > PAGE_SIZE
+        || std::max(nodeBytes(newLeft), nodeBytes(newRight)) > PAGE_SIZE) return false;
+
+    left = newLeft;
+    right = newRight;
+    parent = newParent;
+    return true;
 }
 
 // 
-// redistribute: (left as optional; not used in this code) 
+// compact / bulkLoad: rebuild the tree densely at the front of the file
 // 
 
-void BPlusTree::redistribute(Node& parent, int index) {
-    // Left empty. Redistribution (borrowing) logic can be added here if desired.
+std::vector<BPlusTree::Entry> BPlusTree::collectEntries(long rootPage, bool fixedSlots) {
+    std::vector<Entry> entries;
+    const long pages = state->pageCount.load();
+    auto read = [&](long page) { return fixedSlots ? readFixedSlotNode(page) : readNode(page); };
+
+    // Leftmost leaf, then follow the chain.  The step limits keep a damaged
+    // file from sending us round in circles.
+    Node node = read(rootPage);
+    for (long depth = 0; !node.isLeaf && depth < pages; ++depth) {
+        long child = node.children.empty() ? -1 : node.children[0];
+        if (child <= 0 || child >= pages) return entries;
+        node = read(child);
+    }
+    for (long steps = 0; steps < pages; ++steps) {
+        for (int i = 0; i < node.keyCount() && i < static_cast<int>(node.children.size()); ++i) {
+            std::string payload = i < static_cast<int>(node.payloads.size())
+                ? node.payloads[i] : std::string();
+            entries.push_back({ node.keys[i], node.children[i], std::move(payload) });
+        }
+        long next = node.nextLeafPage;
+        if (next <= 0 || next >= pages) break;
+        node = read(next);
+    }
+    return entries;
+}
+
+void BPlusTree::bulkLoad(const std::vector<Entry>& entries) {
+    // Pack nodes to 3/4 of a page so the first inserts after a rebuild don't
+    // all split.
+    const int target = PAGE_SIZE * 3 / 4;
+    const bool payloads = std::any_of(entries.begin(), entries.end(),
+        [](const Entry& e) { return !e.payload.empty(); });
+
+    // Pages are handed out from 1 in write order: leaves first, then each
+    // inner level, so the root is simply the last page written.
+    long nextPage = HEADER_PAGE + 1;
+
+    // Leaves: greedy runs of entries, chained left to right.  Each one is
+    // recorded with the separator that goes in front of it in its parent.
+    std::vector<std::pair<std::string, long>> level;  // (separator, page)
+    const std::size_t count = entries.size();
+    std::size_t k = 0;
+    do {
+        Node leaf(true);
+        leaf.selfPage = nextPage++;
+        std::size_t begin = k;
+        int total = 0;
+        for (; k < count; ++k) {
+            // bytes with entries[begin, k] in the leaf, prefix compressed
+            int n = static_cast<int>(k - begin) + 1;
+            int prefix = commonPrefix(entries[begin].key, entries[k].key);
+            int len = total + static_cast<int>(entries[k].key.size());
+            if (payloads) len += 1 + static_cast<int>(entries[k].payload.size());
+            if (n > 1 && NODE_HEADER_SIZE + prefix + n * SLOT_SIZE + len - n * prefix > target) break;
+            total = len;
+            leaf.keys.push_back(entries[k].key);
+            leaf.children.push_back(entries[k].offset);
+            if (payloads) leaf.payloads.push_back(entries[k].payload);
+        }
+        leaf.nextLeafPage = k < count ? leaf.selfPage + 1 : -1;
+        leaf.prevLeafPage = begin > 0 ? leaf.selfPage - 1 : -1;
+        writeNode(leaf);
+        std::string separator = begin == 0 || begin == count ? std::string()
+            : shortestSeparator(entries[begin - 1].key, entries[begin].key);
+        level.emplace_back(separator, leaf.selfPage);
+    } while (k < count);
+    int height = 1;
+
+    // Inner levels: each node takes a greedy run of children; the separator of
+    // every child but the first becomes one of its keys, and the first child's
+    // separator moves up with the node.
+    while (level.size() > 1) {
+        std::vector<std::pair<std::string, long>> upper;
+        std::size_t c = 0;
+        while (c < level.size()) {
+            Node inner(false);
+            inner.selfPage = nextPage++;
+            std::size_t begin = c;
+            int bytes = NODE_HEADER_SIZE;
+            inner.children.push_back(level[c++].second);
+            while (c < level.size()) {
+                int more = SLOT_SIZE + static_cast<int>(level[c].first.size());
+                // Never leave a lone child behind for the next node.
+                bool lastOne = c + 1 == level.size();
+                if (bytes + more > target && !lastOne) break;
+                bytes += more;
+                inner.keys.push_back(level[c].first);
+                inner.children.push_back(level[c++].second);
+            }
+            writeNode(inner);
+            upper.emplace_back(level[begin].first, inner.selfPage);
+        }
+        ++height;
+        level.swap(upper);
+    }
+
+    std::lock_guard<std::mutex> guard(state->allocMtx);
+    state->freeListHead = -1;
+    state->rootPage.store(level.front().second);
+    state->pageCount.store(nextPage);
+    state->keyCount.store(static_cast<long>(count));
+    state->height.store(height);
+    writeHeader();
+}
+
+void BPlusTree::compact() {
+    if (isEmpty()) return;
+
+    // 1) Write-latch every page.  Writers never wait while holding a latch, so
+    //    spinning here cannot deadlock; once we hold them all, in-flight
+    //    operations fail validation and restart behind us.
+    std::vector<NodeLatch*> held;
+    long locked = 0;
+    while (locked < state->pageCount.load()) {
+        NodeLatch& latch = state->latch(locked);
+        while (!upgrade(latch, readLock(latch))) {
+            std::this_thread::yield();
+        }
+        held.push_back(&latch);
+        ++locked;
+    }
+
+    // 2) Re-pack the live keys over pages 1.., then cut the file after them.
+    long before = state->pageCount.load();
+    bulkLoad(collectEntries(state->rootPage.load(), /*fixedSlots=*/false));
+    long after = state->pageCount.load();
+    for (long page = locked; page < after; ++page) {
+        // Pages the rebuild grew into were not latched; move them on too.
+        state->latch(page).version.fetch_add(2 * LOCKED_BIT, std::memory_order_acq_rel);
+    }
+    if (after < before) {
+        bufMgr.discardPages(filePath, static_cast<uint32_t>(after), PageType::INDEX);
+        // Pages never flushed are not in the file yet: a file missing or
+        // already that short has nothing to cut.
+        const std::uintmax_t bytes = static_cast<std::uintmax_t>(after) * PAGE_SIZE;
+        std::error_code ec;
+        const std::uintmax_t size = std::filesystem::file_size(filePath, ec);
+        if (ec) ec.clear();
+        else if (size > bytes) std::filesystem::resize_file(filePath, bytes, ec);
+        if (ec) {
+            std::cerr << "[BPlusTree] compact: cannot truncate " << filePath
+                << ": " << ec.message() << "\n";
+        }
+    }
+    std::cout << "[BPlusTree] compact " << filePath << ": " << before
+        << " -> " << after << " pages\n";
+
+    // 3) Release: every version moves on, so stale copies are rejected.
+    for (NodeLatch* latch : held) {
+        writeUnlock(*latch);
+    }
+
+    // Same keys, but the filter may still carry bits of deleted ones.
+    rebuildFilter();
 }
 
 // 
@@ -443,47 +1677,164 @@ void BPlusTree::rangeSearch(const std::string& startKey,
     const std::string& endKey,
     std::vector<long>& outOffsets)
 {
-    if (pageCount == 0) return;
-
-    long page = 0;
-    // 1) If startKey is non?empty, descend to leaf that should contain it
-    if (!startKey.empty()) {
-        while (true) {
-            Node node = readNode(page);
-            int i = 0;
-            while (i < node.keyCount && startKey > std::string(node.keys[i])) ++i;
-            if (node.isLeaf) {
-                page = node.selfPage;
+    scanRange(startKey, endKey,
+        [&](const std::string&, long offset, const std::string&) {
+            outOffsets.push_back(offset);
+            return true;
+        });
+}
+
+void BPlusTree::rangeSearchCovering(const std::string& startKey,
+    const std::string& endKey,
+    std::vector<Entry>& out,
+    std::size_t limit)
+{
+    std::size_t taken = 0;
+    scanRange(startKey, endKey,
+        [&](const std::string& key, long offset, const std::string& payload) {
+            out.push_back({ key, offset, payload });
+            return ++taken != limit;
+        });
+}
+
+void BPlusTree::rangeSearchDescending(const std::string& startKey,
+    const std::string& endKey,
+    std::vector<Entry>& out,
+    std::size_t limit)
+{
+    std::size_t taken = 0;
+    scanRangeReverse(startKey, endKey,
+        [&](const std::string& key, long offset, const std::string& payload) {
+            out.push_back({ key, offset, payload });
+            return ++taken != limit;
+        });
+}
+
+void BPlusTree::scanRange(const std::string& startKey, const std::string& endKey,
+    const std::function<bool(const std::string&, long, const std::string&)>& visit)
+{
+    if (isEmpty()) return;
+
+    // If a leaf changes while we walk the chain, we re-descend and continue
+    // strictly after the last key already emitted.
+    SharedState::Section section(*state);
+    const std::string noPayload;
+    bool haveLast = false;
+    std::string lastKey;
+
+    while (true) {
+        const std::string& probe = haveLast ? lastKey : startKey;
+        bool leftmost = !haveLast && startKey.empty();
+
+        // 1) Descend to the leaf that should contain the probe key
+        Node leaf;
+        uint64_t version;
+        if (!descendToLeaf(probe, leftmost, leaf, version)) continue;
+
+        // 2) Now scan leaf pages until key > endKey (or no more leaves)
+        bool restart = false;
+        while (!restart) {
+            for (int i = 0; i < leaf.keyCount(); ++i) {
+                if (haveLast) {
+                    if (leaf.keys[i] <= lastKey) continue;
+                }
+                else if (!startKey.empty() && leaf.keys[i] < startKey) {
+                    continue;
+                }
+                if (!endKey.empty() && endKey < leaf.keys[i]) {
+                    return;
+                }
+                lastKey = leaf.keys[i];
+                haveLast = true;
+                if (!visit(leaf.keys[i], leaf.children[i],
+                    leaf.payloads.empty() ? noPayload : leaf.payloads[i])) {
+                    return;
+                }
+            }
+
+            long next = leaf.nextLeafPage;
+            if (next == -1) return;
+
+            // Couple to the next leaf: our copy's next pointer must still be
+            // valid once we hold the neighbour's version.
+            NodeLatch& nextLatch = state->latch(next);
+            uint64_t nextVersion = readLock(nextLatch);
+            if (!validate(state->latch(leaf.selfPage), version)) {
+                restart = true;
                 break;
             }
-            page = node.children[i];
-        }
-    }
-    else {
-        // If no startKey, go to leftmost leaf
-        while (true) {
-            Node node = readNode(page);
-            if (node.isLeaf) {
+            Node nextLeaf = readNode(next);
+            if (!validate(nextLatch, nextVersion)) {
+                restart = true;
                 break;
             }
-            page = node.children[0];
+            leaf = nextLeaf;
+            version = nextVersion;
         }
     }
+}
 
-    // 2) Now scan leaf pages until key > endKey (or no more leaves)
-    while (page != -1) {
-        Node leaf = readNode(page);
-        int i = 0;
-        if (!startKey.empty()) {
-            while (i < leaf.keyCount && startKey > std::string(leaf.keys[i])) ++i;
-        }
-        for (; i < leaf.keyCount; ++i) {
-            std::string curKey(leaf.keys[i]);
-            if (!endKey.empty() && curKey > endKey) {
-                return;
+void BPlusTree::scanRangeReverse(const std::string& startKey, const std::string& endKey,
+    const std::function<bool(const std::string&, long, const std::string&)>& visit)
+{
+    if (isEmpty()) return;
+
+    // Mirror image of scanRange: walk the back links, and after a restart
+    // continue strictly below the last key emitted.
+    SharedState::Section section(*state);
+    const std::string noPayload;
+    // Stored keys are shorter than KEY_SIZE, so this sorts after every one of
+    // them and an open upper bound descends to the last leaf.
+    const std::string pastLast(KEY_SIZE, '\xff');
+    bool haveLast = false;
+    std::string lastKey;
+
+    while (true) {
+        const std::string& probe = haveLast ? lastKey : endKey.empty() ? pastLast : endKey;
+
+        // 1) Descend to the leaf that should contain the probe key
+        Node leaf;
+        uint64_t version;
+        if (!descendToLeaf(probe, false, leaf, version)) continue;
+
+        // 2) Scan leaf pages backwards until key < startKey (or no more leaves)
+        bool restart = false;
+        while (!restart) {
+            for (int i = leaf.keyCount() - 1; i >= 0; --i) {
+                if (haveLast) {
+                    if (!(leaf.keys[i] < lastKey)) continue;
+                }
+                else if (!endKey.empty() && endKey < leaf.keys[i]) {
+                    continue;
+                }
+                if (!startKey.empty() && leaf.keys[i] < startKey) {
+                    return;
+                }
+                lastKey = leaf.keys[i];
+                haveLast = true;
+                if (!visit(leaf.keys[i], leaf.children[i],
+                    leaf.payloads.empty() ? noPayload : leaf.payloads[i])) {
+                    return;
+                }
+            }
+
+            long prev = leaf.prevLeafPage;
+            if (prev == -1) return;
+
+            // Couple to the previous leaf exactly as scanRange does to the next.
+            NodeLatch& prevLatch = state->latch(prev);
+            uint64_t prevVersion = readLock(prevLatch);
+            if (!validate(state->latch(leaf.selfPage), version)) {
+                restart = true;
+                break;
+            }
+            Node prevLeaf = readNode(prev);
+            if (!validate(prevLatch, prevVersion)) {
+                restart = true;
+                break;
             }
-            outOffsets.push_back(leaf.children[i]);
+            leaf = prevLeaf;
+            version = prevVersion;
         }
-        page = leaf.nextLeafPage;
     }
 }
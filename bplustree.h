@@ -2,42 +2,114 @@
 
 #include <string>
 #include <vector>
+#include <functional>
+#include <memory>
+#include <cstring>
+#include <algorithm>
 #include "BufferManager.h"
 
-/// Disk‐based B+ Tree with fixed 4 KB pages.  Keys are std::string up to 39 bytes,
-/// pointers (children or record offsets) are 8‐byte longs.  Header is 1+4+8+8 bytes.
+/// Disk‐based B+ Tree with 4 KB pages.  Keys are std::string up to 39 bytes,
+/// pointers (children or record offsets) are 8‐byte longs.
+///
+/// Node pages are slotted and variable-length: a 24-byte header, the key
+/// prefix shared by every key in the node, a slot array of (offset, length,
+/// pointer) entries, and the key suffixes packed from the end of the page
+/// towards the slots.  Leaf splits push up the shortest separator that still
+/// divides the two halves, so inner nodes hold short keys.  Short or
+/// similar keys therefore fit many more entries per page than a fixed slot
+/// would allow, and nodes split and merge on bytes used rather than on key count.
+///
+/// Concurrency: optimistic lock coupling.  Every page has an in-memory version
+/// latch shared by all BPlusTree objects opened on the same file.  Readers never
+/// block: they copy a node, then re-check its version and restart the operation
+/// if a writer got in between.  Writers upgrade the version to a write lock only
+/// on the node(s) they modify, and full nodes are split eagerly on the way down,
+/// so a split never has to propagate back up the tree.  Deletes do the same in
+/// reverse: an underfull child borrows from or merges with a sibling before the
+/// descent enters it.
+///
+/// Leaves are chained both ways (nextLeafPage / prevLeafPage), so range scans
+/// can run in either direction; a descending scan starts at its upper bound
+/// and can stop after the first few keys.
+///
+/// Inner nodes are cached decoded in memory next to their page latch, with
+/// child pointers resolved to the children's latch entries (swizzled), so a
+/// lookup reaches the leaf level without going through the buffer pool; only
+/// the leaf itself is read from a buffer frame.
+///
+/// File layout: page 0 is the index header (magic, format version, root page,
+/// page count, key count, height and head of the free-page list); every other
+/// page is a node.  Opening a file reads only the header.  Pages released by
+/// merges are chained through the free list and handed out again before the
+/// file grows.
+///
+/// A leaf entry may carry a payload of up to MAX_PAYLOAD_SIZE bytes stored
+/// after its key (the INCLUDE columns of a covering index), so a lookup can
+/// be answered from the leaf without reading the record.  Leaves holding
+/// payloads are flagged in their header; other pages are unchanged.
+///
+/// Each index also keeps a Bloom filter over its keys (saved as a ".bloom"
+/// file next to the index), so mayContain can rule out most absent keys
+/// without a descent.
 class BPlusTree {
 public:
     static constexpr int PAGE_SIZE = 4096;
-    static constexpr int KEY_SIZE = 40;  // store up to 39 chars + '\0'
-    static constexpr int PTR_SIZE = sizeof(long);
-    static constexpr int HEADER_SIZE = sizeof(bool)    // isLeaf
-        + sizeof(int)     // keyCount
-        + sizeof(long)    // parentPage
-        + sizeof(long);   // nextLeafPage
-    // ORDER = how many keys fit in a 4 KB page:
-    static constexpr int ORDER = (PAGE_SIZE - HEADER_SIZE) / (KEY_SIZE + PTR_SIZE);
-
-    /// One node on disk (always exactly 4096 bytes):
+    static constexpr int KEY_SIZE = 40;  // keys of KEY_SIZE bytes or more are not stored
+    static constexpr int NODE_HEADER_SIZE = 1   // isLeaf
+        + 1               // prefix length
+        + 2               // key count
+        + 2               // start of the key heap
+        + 1               // flags
+        + 1               // unused
+        + sizeof(long)    // nextLeafPage
+        + sizeof(long);   // leftmost child (inner nodes) or prevLeafPage (leaves)
+    static constexpr int SLOT_SIZE = 2 + 1 + sizeof(long);  // offset, length, pointer
+    // Room one more entry may need, whatever its key:
+    static constexpr int MAX_ENTRY_SIZE = SLOT_SIZE + KEY_SIZE - 1;
+    static constexpr int MAX_PAYLOAD_SIZE = 255;  // stored after a length byte
+    // Non-root nodes using fewer bytes than this are rebalanced:
+    static constexpr int MIN_NODE_BYTES = PAGE_SIZE / 4;
+    static constexpr long HEADER_PAGE = 0;
+    static constexpr uint32_t MAGIC = 0x58495042;  // "BPIX"
+    static constexpr uint32_t FORMAT_VERSION = 4;  // 3 = no prevLeafPage, 2 = fixed 40-byte key
+                                                   // slots, 0 = magic + free list only
+
+    /// Cheap cardinality figures kept in the header page.
+    struct Stats {
+        long keyCount;   // entries in the leaves
+        int  height;     // levels, leaves included; 0 for an empty tree
+        long pageCount;  // pages in the file, header and free pages included
+    };
+
+    /// One leaf entry as handed to insertBatch and bulkLoad.
+    struct Entry {
+        std::string key;
+        long        offset;
+        std::string payload;  // INCLUDE bytes; empty if the index has none
+    };
+
+    /// One node, decoded from its page.  Keys are held in full here; only the
+    /// page image is prefix-compressed.
     struct Node {
-        bool    isLeaf;
-        int     keyCount;
-        long    parentPage;
-        long    nextLeafPage;
-        char    keys[ORDER][KEY_SIZE];
-        long    children[ORDER + 1];
-        long    selfPage;  // which page number this node occupies
+        bool                     isLeaf;
+        long                     nextLeafPage;  // for a page on the free list: next free page
+        long                     prevLeafPage;  // leaves: left neighbour, -1 for the first
+        std::vector<std::string> keys;          // sorted
+        std::vector<long>        children;      // leaves: one record offset per key;
+                                                // inner: keys.size() + 1 child pages
+        std::vector<std::string> payloads;      // leaves: one payload per key, or empty
+                                                // if no key in the leaf has one
+        long                     selfPage;      // which page number this node occupies
 
         Node(bool leaf = true)
             : isLeaf(leaf),
-            keyCount(0),
-            parentPage(-1),
             nextLeafPage(-1),
+            prevLeafPage(-1),
             selfPage(-1)
         {
-            std::memset(keys, 0, sizeof(keys));
-            std::fill(children, children + ORDER + 1, -1L);
         }
+
+        int keyCount() const { return static_cast<int>(keys.size()); }
     };
 
     /// filename: path to the index file (e.g. "Tables/myTable/id.idx")
@@ -45,12 +117,31 @@ public:
     explicit BPlusTree(const std::string& filename, BufferManager& bm);
     ~BPlusTree();
 
-    /// Insert a (key → recordOffset) pair into the B+ Tree.
-    void insert(const std::string& key, long recordOffset);
+    /// Insert a (key → recordOffset) pair into the B+ Tree, with an optional
+    /// payload (cut to MAX_PAYLOAD_SIZE bytes).  A key of KEY_SIZE bytes or
+    /// more is not stored; no lookup finds one either.
+    void insert(const std::string& key, long recordOffset,
+        const std::string& payload = std::string());
+
+    /// Insert many entries at once.  They are sorted first, and each run of keys
+    /// that lands in the same leaf shares one descent and one page write.  Into
+    /// an empty tree the sorted entries are bulk-loaded: packed leaves and
+    /// inner levels written bottom-up, as compact() does.
+    void insertBatch(std::vector<Entry> entries);
 
     /// Search for an exact key; if found, recordOffset is set and returns true.
     bool search(const std::string& key, long& recordOffset);
 
+    /// search() that also returns the key's payload ("" if it has none).
+    bool searchCovering(const std::string& key, long& recordOffset, std::string& payload);
+
+    /// Look up many keys at once: offsets[i] is the record offset of keys[i],
+    /// or -1 if absent.  Keys sharing a leaf share its descent and read.
+    /// If `payloads` is given it receives each found key's payload.
+    /// Returns how many were found.
+    int searchBatch(const std::vector<std::string>& keys, std::vector<long>& offsets,
+        std::vector<std::string>* payloads = nullptr);
+
     /// Remove an exact key from the B+ Tree. Returns true if found & removed.
     bool remove(const std::string& key);
 
@@ -59,35 +150,182 @@ public:
         const std::string& endKey,
         std::vector<long>& outOffsets);
 
+    /// rangeSearch() returning whole entries: key, offset and payload.  Stops
+    /// after `limit` entries if it is not 0.
+    void rangeSearchCovering(const std::string& startKey,
+        const std::string& endKey,
+        std::vector<Entry>& out,
+        std::size_t limit = 0);
+
+    /// The same entries, highest key first: the walk starts at the leaf
+    /// holding endKey (the last leaf for an open bound) and follows the
+    /// prevLeafPage links, so a small `limit` reads only a leaf or two.
+    void rangeSearchDescending(const std::string& startKey,
+        const std::string& endKey,
+        std::vector<Entry>& out,
+        std::size_t limit = 0);
+
+    /// Rebuild the tree densely packed at the front of the file, drop the free
+    /// list and truncate the file.  Safe to run while other threads use the
+    /// index: every page is write-latched for the duration of the rebuild.
+    void compact();
+
+    /// Current statistics; no I/O.
+    Stats stats() const;
+
+    /// False only if `key` is certainly not in the index (Bloom filter check;
+    /// no I/O).  True means "maybe": search() has the final word.
+    bool mayContain(const std::string& key) const;
+
+    /// Drop the shared state of every index file under `tablePath` (root,
+    /// counters, cached inner nodes, Bloom filter), e.g. when the table is
+    /// deleted, so a table created again under the same name starts from its
+    /// own files.  Trees still open on the old files write nothing back,
+    /// neither header nor filter.
+    static void forget(const std::string& tablePath);
+
 private:
+    struct SharedState;         // per-file latches + page counter (defined in .cpp)
+    struct Registry;            // file -> SharedState for the process (defined in .cpp)
+
+    static Registry& registry();
+
     std::string  filePath;      // e.g. "Tables/myTable/id.idx"
-    long         pageCount;     // how many 4 KB pages currently in the file
     BufferManager& bufMgr;      // reference to the buffer manager
+    std::shared_ptr<SharedState> state;
 
-    /// Allocate a brand‐new empty node page at the next pageCount index.
+    /// Allocate an empty node page, reusing the free list before growing the file.
     long allocateNode();
 
-    /// Write a Node object into its page in the index file (via buffer).
+    /// Put 'page' on the free list (caller holds its write latch).
+    void freeNode(long page);
+
+    /// Persist the in-memory header to page 0 (caller holds allocMtx).
+    void writeHeader();
+
+    /// First open in this process: read the header, or convert an older file
+    /// (fixed-slot nodes, root on page 0 or 1) into the current layout.
+    void openFile();
+
+    /// Load the saved Bloom filter if it matches the header's key count,
+    /// otherwise build one by scanning the leaves.
+    void openFilter();
+
+    /// Build a right-sized filter from the leaves and swap it in.  Inserts
+    /// made meanwhile are added to both filters.  No-op if a rebuild is
+    /// already running.
+    void rebuildFilter();
+
+    /// Called before the first change to the keys: the saved filter file no
+    /// longer matches, so delete it.
+    void noteModified();
+
+    /// Write sorted entries as a fresh, densely packed tree over pages 1..
+    /// and reset the header.  Caller has exclusive access.
+    void bulkLoad(const std::vector<Entry>& entries);
+
+    /// Every entry in key order, read by walking the leaf chain of the tree
+    /// whose root is 'rootPage'.  'fixedSlots' reads pages written before
+    /// format 3.  Caller has exclusive access.
+    std::vector<Entry> collectEntries(long rootPage, bool fixedSlots);
+
+    /// Call visit(key, offset, payload) for every entry with key in
+    /// [startKey, endKey] (an empty bound is open), in key order, until it
+    /// returns false.
+    void scanRange(const std::string& startKey, const std::string& endKey,
+        const std::function<bool(const std::string&, long, const std::string&)>& visit);
+
+    /// scanRange backwards: from endKey down to startKey.
+    void scanRangeReverse(const std::string& startKey, const std::string& endKey,
+        const std::function<bool(const std::string&, long, const std::string&)>& visit);
+
+    /// Encode a Node object into its page in the index file (via buffer).
     void writeNode(const Node& node);
 
     /// Read the Node at page number 'page' from disk into a Node struct.
     Node readNode(long page);
 
-    /// Recursively insert (key, recordOffset) under 'node'.
-    void insertRecursive(Node& node, const std::string& key, long recordOffset);
+    /// The node at 'page' as of latch version 'version': from the inner-node
+    /// cache when it holds that version, otherwise via readNode, caching the
+    /// result if it is an inner node.  Caller validates the latch afterwards.
+    Node fetchNode(long page, uint64_t version);
+
+    /// Read a page in the pre-format-3 layout (40-byte key slots).
+    Node readFixedSlotNode(long page);
+
+    /// One optimistic attempt of each operation; false means "restart".
+    /// The batch forms handle entries[done] and every following entry in the
+    /// same leaf, advancing `done` past them.
+    bool tryInsert(const Entry* entries, std::size_t count, std::size_t& done);
+    bool trySearch(const std::string& key, bool& found, long& recordOffset);
+    bool trySearchBatch(const std::vector<std::string>& keys,
+        const std::vector<std::size_t>& order, std::size_t& done, std::vector<long>& offsets,
+        std::vector<std::string>* payloads);
+    bool tryRemove(const std::string& key, bool& removed);
+
+    /// Read the root pointer and a validated copy of the root.  `headerVersion`
+    /// is the header latch version, which a root split must upgrade.
+    bool enterRoot(Node& root, uint64_t& version, uint64_t& headerVersion);
+
+    /// Look `key` up in the page image itself, without decoding the node.
+    /// Inner page: `result` is the child to follow (the first one if
+    /// `leftmost`).  Leaf: the record offset of an exact match, or -1.  The
+    /// page may be mid-write; the caller validates its latch before trusting this.
+    bool probePage(long page, const std::string& key, bool leftmost,
+        bool& isLeaf, long& result);
+
+    /// Descend optimistically to the leaf responsible for `key`.  On success
+    /// `leafPage` is validated at latch version `version`, and `match` holds
+    /// the probe result for `key` in that leaf.
+    bool descendToLeafPage(const std::string& key, bool leftmost,
+        long& leafPage, uint64_t& version, long& match);
+
+    /// descendToLeafPage, then a decoded copy of the leaf.
+    bool descendToLeaf(const std::string& key, bool leftmost,
+        Node& leaf, uint64_t& version);
+
+    /// Read the leaf at `page` at latch version `version` (readLock'ed here)
+    /// for a split or merge that must update its prevLeafPage.  False if it
+    /// changed while being read.
+    bool readNeighbour(long page, Node& leaf, uint64_t& version);
+
+    /// Split a full root: it keeps the left half and a new root goes on top.
+    void splitRoot(Node& root);
+
+    /// Split the full child `node` of `parent` (both write-locked by caller).
+    /// `next` is the leaf after a leaf `node`, also write-locked, whose back
+    /// link moves to the new sibling; null for inner nodes and the last leaf.
+    void splitChild(Node& parent, Node& node, Node* next);
+
+    /// `node` (child `slot` of `parent`) is underfull: latch a sibling and
+    /// merge with it or borrow from it.  Releases all latches.  Returns false
+    /// only if neither would help, in which case nothing was changed and the
+    /// caller may go on with its copy of `node`.
+    bool rebalanceChild(Node& parent, uint64_t parentVersion,
+        Node& node, uint64_t nodeVersion, int slot);
+
+    /// Merge children `index` and `index + 1` of `parent` into the left one,
+    /// free the right page, and collapse the root if it is left with one child.
+    /// `next` is the (write-locked) leaf after a leaf `right`, if any; its back
+    /// link moves to `left`.
+    void mergeNodes(Node& parent, Node& left, Node& right, int index, Node* next);
 
-    /// Split a node that has overflowed (keyCount > ORDER).
-    void splitNode(Node& node);
+    /// Even out the bytes of children `index` and `index + 1` of `parent`
+    /// (copies only; nothing is written).  False, with the copies untouched,
+    /// if that would not make the smaller side bigger or the new separator
+    /// would not fit in the parent.
+    static bool redistribute(Node& parent, Node& left, Node& right, int index);
 
-    /// After splitting, insert the middle key into the parent.
-    void insertInParent(Node& left, const std::string& key, Node& right);
+    bool isEmpty() const;
 
-    /// Recursively delete a key from subtree rooted at 'node'.
-    void deleteRecursive(Node& node, const std::string& key);
+    /// Index of the child subtree that may hold `key` (inner nodes).
+    static int childIndex(const Node& node, const std::string& key);
 
-    /// Merge two siblings at index 'index' under 'parent'.
-    void mergeNodes(Node& parent, int index);
+    /// First slot whose key is >= `key` (leaves).
+    static int lowerBound(const Node& node, const std::string& key);
 
-    /// Redistribute keys/children between siblings if one is underfull.
-    void redistribute(Node& parent, int index);
+    /// Page bytes `node` needs, plus `extra` as one more leaf entry if given.
+    /// Inner nodes are charged without prefix compression: the separator a
+    /// child split pushes up may not share their prefix.
+    static int nodeBytes(const Node& node, const Entry* extra = nullptr);
 };
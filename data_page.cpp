@@ -0,0 +1,85 @@
+#include "data_page.h"
+#include "heap_page.h"
+#include "pax_page.h"
+
+#include <algorithm>
+#include <cstring>
+
+DataPage::DataPage(char* page, const std::vector<Schema::Field>* pax)
+    : page(page),
+    pax(pax)
+{
+}
+
+int DataPage::slotCount() const {
+    return pax ? PaxPage(page, *pax).slotCount() : HeapPage(page).slotCount();
+}
+
+bool DataPage::live(int slot) const {
+    return pax ? PaxPage(page, *pax).live(slot) : !HeapPage(page).record(slot).empty();
+}
+
+std::string_view DataPage::record(int slot, std::string& buf) const {
+    return pax ? PaxPage(page, *pax).record(slot, buf) : HeapPage(page).record(slot);
+}
+
+std::string_view DataPage::value(const Schema::Field& f, int slot) const {
+    return pax ? PaxPage(page, *pax).value(f, slot) : Schema::valueOf(f, HeapPage(page).record(slot));
+}
+
+bool DataPage::isExternal(const Schema::Field& f, int slot) const {
+    return pax ? PaxPage(page, *pax).isExternal(f, slot) : Schema::isExternal(f, HeapPage(page).record(slot));
+}
+
+Schema::ExternalRef DataPage::externalRef(const Schema::Field& f, int slot) const {
+    Schema::ExternalRef ref;
+    std::memcpy(&ref, value(f, slot).data(), sizeof(ref));
+    return ref;
+}
+
+void DataPage::select(const Schema::Field& f, FilterKernel::Op op, std::string_view operand,
+    std::vector<uint16_t>& sel) const
+{
+    if (pax) {
+        PaxPage p(page, *pax);
+        sel.resize(p.slotCount());
+        sel.resize(FilterKernel::select(f.kind, p.column(f), sel.size(), op, operand, sel.data()));
+        // the minipage has entries for free slots too
+        sel.erase(std::remove_if(sel.begin(), sel.end(), [&](uint16_t s) { return !p.live(s); }), sel.end());
+        return;
+    }
+
+    // A record keeps f at f.offset: copy the live records' values together
+    // for the kernel, then map its positions back to slots.
+    constexpr int MAX_SLOTS = (HeapPage::PAGE_SIZE - HeapPage::HEADER_SIZE) / HeapPage::SLOT_SIZE;
+    char values[MAX_SLOTS * sizeof(int64_t)];
+    uint16_t slots[MAX_SLOTS];
+    HeapPage heap(page);
+    const int width = Schema::fixedWidth(f);
+    std::size_t n = 0;
+    for (int s = 0; s < heap.slotCount(); ++s) {
+        std::string_view rec = heap.record(s);
+        if (rec.empty()) continue;
+        std::memcpy(values + n * width, rec.data() + f.offset, width);
+        slots[n++] = static_cast<uint16_t>(s);
+    }
+    sel.resize(n);
+    sel.resize(FilterKernel::select(f.kind, values, n, op, operand, sel.data()));
+    for (auto& s : sel) s = slots[s];
+}
+
+int DataPage::freeSpace() const {
+    return pax ? PaxPage(page, *pax).freeSpace() : HeapPage(page).freeSpace();
+}
+
+int DataPage::insert(std::string_view rec) {
+    return pax ? PaxPage(page, *pax).insert(rec) : HeapPage(page).insert(rec);
+}
+
+bool DataPage::update(int slot, std::string_view rec) {
+    return pax ? PaxPage(page, *pax).update(slot, rec) : HeapPage(page).update(slot, rec);
+}
+
+bool DataPage::erase(int slot) {
+    return pax ? PaxPage(page, *pax).erase(slot) : HeapPage(page).erase(slot);
+}
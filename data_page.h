@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include "schema.h"
+#include "filter_kernel.h"
+
+/// A data.tbl page in its table's layout: a HeapPage for a Row table, a
+/// PaxPage for a Pax one (see Schema::Storage).  Code that reads or changes
+/// rows goes through this, so it works on both; TableHandle::page makes one.
+///
+/// DataPage is a view over a pinned buffer; it owns nothing.
+class DataPage {
+public:
+    /// pax: the table's fields if it is a Pax table, nullptr for a Row table.
+    DataPage(char* page, const std::vector<Schema::Field>* pax);
+
+    int slotCount() const;
+
+    /// True if `slot` holds a row.
+    bool live(int slot) const;
+
+    /// The record in `slot`, empty if the slot is free.  A Pax page assembles
+    /// it in `buf`; a Row page returns it in place and leaves `buf` alone.
+    std::string_view record(int slot, std::string& buf) const;
+
+    /// f's stored bytes in the live `slot` (see Schema::valueOf).
+    std::string_view value(const Schema::Field& f, int slot) const;
+
+    /// True if f's value in the live `slot` is kept out of line.
+    bool isExternal(const Schema::Field& f, int slot) const;
+
+    /// The overflow chain of an out-of-line value.
+    Schema::ExternalRef externalRef(const Schema::Field& f, int slot) const;
+
+    /// The live slots whose f value compares `op` to `operand` (stored
+    /// bytes), in slot order, computed by FilterKernel over the whole page:
+    /// straight over f's minipage on a Pax page, over the values gathered
+    /// from the records on a Row page.  f must be a kind FilterKernel supports.
+    void select(const Schema::Field& f, FilterKernel::Op op, std::string_view operand,
+        std::vector<uint16_t>& sel) const;
+
+    /// See HeapPage and PaxPage for these.
+    int  freeSpace() const;
+    int  insert(std::string_view rec);
+    bool update(int slot, std::string_view rec);
+    bool erase(int slot);
+
+private:
+    char*                              page;
+    const std::vector<Schema::Field>*  pax;
+};
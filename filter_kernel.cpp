@@ -0,0 +1,199 @@
+#include "filter_kernel.h"
+
+#include <bit>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define FILTER_KERNEL_AVX2 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define AVX2_TARGET
+#else
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace {
+
+    using Op = FilterKernel::Op;
+
+    template <typename T>
+    T load(const char* src) {
+        T v;
+        std::memcpy(&v, src, sizeof(T));
+        return v;
+    }
+
+    /// Positions first .. n-1 that pass, appended to sel[k..]; returns the new k.
+    /// Branch-free: every position is written, and kept only if it passes.
+    template <typename T, Op O>
+    std::size_t scalarFrom(const char* values, std::size_t first, std::size_t n, T x,
+        uint16_t* sel, std::size_t k)
+    {
+        for (std::size_t i = first; i < n; ++i) {
+            const T v = load<T>(values + i * sizeof(T));
+            bool pass;
+            if constexpr (O == Op::Eq) pass = v == x;
+            else if constexpr (O == Op::Ne) pass = v != x;
+            else if constexpr (O == Op::Lt) pass = v < x;
+            else if constexpr (O == Op::Le) pass = v <= x;
+            else if constexpr (O == Op::Gt) pass = v > x;
+            else pass = v >= x;
+            sel[k] = static_cast<uint16_t>(i);
+            k += pass;
+        }
+        return k;
+    }
+
+#ifdef FILTER_KERNEL_AVX2
+
+    /// The positions of the set bits of a lane mask, from `base`.
+    inline std::size_t emit(unsigned mask, std::size_t base, uint16_t* sel, std::size_t k) {
+        while (mask) {
+            sel[k++] = static_cast<uint16_t>(base + std::countr_zero(mask));
+            mask &= mask - 1;
+        }
+        return k;
+    }
+
+    template <Op O>
+    AVX2_TARGET std::size_t avx2Int32(const char* values, std::size_t n, int32_t x, uint16_t* sel) {
+        const __m256i xv = _mm256_set1_epi32(x);
+        std::size_t i = 0, k = 0;
+        for (; i + 8 <= n; i += 8) {
+            const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i * 4));
+            __m256i m;
+            if constexpr (O == Op::Eq || O == Op::Ne) m = _mm256_cmpeq_epi32(v, xv);
+            else if constexpr (O == Op::Lt || O == Op::Ge) m = _mm256_cmpgt_epi32(xv, v);
+            else m = _mm256_cmpgt_epi32(v, xv);
+            unsigned mask = static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(m)));
+            if constexpr (O == Op::Ne || O == Op::Ge || O == Op::Le) mask ^= 0xFFu;
+            k = emit(mask, i, sel, k);
+        }
+        return scalarFrom<int32_t, O>(values, i, n, x, sel, k);
+    }
+
+    template <Op O>
+    AVX2_TARGET std::size_t avx2Int64(const char* values, std::size_t n, int64_t x, uint16_t* sel) {
+        const __m256i xv = _mm256_set1_epi64x(x);
+        std::size_t i = 0, k = 0;
+        for (; i + 4 <= n; i += 4) {
+            const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i * 8));
+            __m256i m;
+            if constexpr (O == Op::Eq || O == Op::Ne) m = _mm256_cmpeq_epi64(v, xv);
+            else if constexpr (O == Op::Lt || O == Op::Ge) m = _mm256_cmpgt_epi64(xv, v);
+            else m = _mm256_cmpgt_epi64(v, xv);
+            unsigned mask = static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(m)));
+            if constexpr (O == Op::Ne || O == Op::Ge || O == Op::Le) mask ^= 0xFu;
+            k = emit(mask, i, sel, k);
+        }
+        return scalarFrom<int64_t, O>(values, i, n, x, sel, k);
+    }
+
+    template <Op O>
+    AVX2_TARGET std::size_t avx2Double(const char* values, std::size_t n, double x, uint16_t* sel) {
+        // stored doubles are finite (Schema::encodeValue), so ordered compares do
+        constexpr int PRED = O == Op::Eq ? _CMP_EQ_OQ : O == Op::Ne ? _CMP_NEQ_OQ
+            : O == Op::Lt ? _CMP_LT_OQ : O == Op::Le ? _CMP_LE_OQ
+            : O == Op::Gt ? _CMP_GT_OQ : _CMP_GE_OQ;
+        const __m256d xv = _mm256_set1_pd(x);
+        std::size_t i = 0, k = 0;
+        for (; i + 4 <= n; i += 4) {
+            const __m256d v = _mm256_loadu_pd(reinterpret_cast<const double*>(values + i * 8));
+            const unsigned mask = static_cast<unsigned>(_mm256_movemask_pd(_mm256_cmp_pd(v, xv, PRED)));
+            k = emit(mask, i, sel, k);
+        }
+        return scalarFrom<double, O>(values, i, n, x, sel, k);
+    }
+
+    bool detectAvx2() {
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7) return false;
+        __cpuid(info, 1);
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        const bool avx = (info[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) return false;   // YMM state saved by the OS
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+
+#endif // FILTER_KERNEL_AVX2
+
+    const bool haveAvx2 =
+#ifdef FILTER_KERNEL_AVX2
+        detectAvx2();
+#else
+        false;
+#endif
+
+    template <Op O>
+    std::size_t selectOp(Schema::Kind kind, const char* values, std::size_t n,
+        std::string_view operand, uint16_t* sel)
+    {
+        switch (kind) {
+        case Schema::Kind::Int32: {
+            const int32_t x = load<int32_t>(operand.data());
+#ifdef FILTER_KERNEL_AVX2
+            if (haveAvx2) return avx2Int32<O>(values, n, x, sel);
+#endif
+            return scalarFrom<int32_t, O>(values, 0, n, x, sel, 0);
+        }
+        case Schema::Kind::Int64: {
+            const int64_t x = load<int64_t>(operand.data());
+#ifdef FILTER_KERNEL_AVX2
+            if (haveAvx2) return avx2Int64<O>(values, n, x, sel);
+#endif
+            return scalarFrom<int64_t, O>(values, 0, n, x, sel, 0);
+        }
+        case Schema::Kind::Double: {
+            const double x = load<double>(operand.data());
+#ifdef FILTER_KERNEL_AVX2
+            if (haveAvx2) return avx2Double<O>(values, n, x, sel);
+#endif
+            return scalarFrom<double, O>(values, 0, n, x, sel, 0);
+        }
+        case Schema::Kind::Char:
+            break;
+        }
+        return 0;
+    }
+}
+
+bool FilterKernel::parseOp(const std::string& text, Op& op) {
+    if (text == "=")       op = Op::Eq;
+    else if (text == "!=") op = Op::Ne;
+    else if (text == "<")  op = Op::Lt;
+    else if (text == "<=") op = Op::Le;
+    else if (text == ">")  op = Op::Gt;
+    else if (text == ">=") op = Op::Ge;
+    else return false;
+    return true;
+}
+
+bool FilterKernel::supports(Schema::Kind kind) {
+    return kind != Schema::Kind::Char;
+}
+
+std::size_t FilterKernel::select(Schema::Kind kind, const char* values, std::size_t n,
+    Op op, std::string_view operand, uint16_t* sel)
+{
+    switch (op) {
+    case Op::Eq: return selectOp<Op::Eq>(kind, values, n, operand, sel);
+    case Op::Ne: return selectOp<Op::Ne>(kind, values, n, operand, sel);
+    case Op::Lt: return selectOp<Op::Lt>(kind, values, n, operand, sel);
+    case Op::Le: return selectOp<Op::Le>(kind, values, n, operand, sel);
+    case Op::Gt: return selectOp<Op::Gt>(kind, values, n, operand, sel);
+    case Op::Ge: return selectOp<Op::Ge>(kind, values, n, operand, sel);
+    }
+    return 0;
+}
+
+bool FilterKernel::usesAvx2() {
+    return haveAvx2;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "schema.h"
+
+/// Comparisons of a batch of stored column values against one operand, as
+/// a full-table scan applies its WHERE: the result is a selection vector,
+/// the positions in the batch whose value passes, in increasing order.
+///
+/// Only fixed-width values have kernels: int, bigint and double, read in
+/// their stored encoding from an array (a PaxPage minipage, or values
+/// gathered from HeapPage records).  Text is variable-length in this engine
+/// and is compared a row at a time by the caller.
+///
+/// Each kernel has an AVX2 version, chosen at run time when the CPU has it,
+/// and a scalar one; both give the same selection.
+class FilterKernel {
+public:
+    enum class Op { Eq, Ne, Lt, Le, Gt, Ge };
+
+    /// The Op of a SQL comparison ("=", "!=", "<", "<=", ">", ">="); false
+    /// for anything else, e.g. "IN".
+    static bool parseOp(const std::string& text, Op& op);
+
+    /// True if kind's values have a kernel.
+    static bool supports(Schema::Kind kind);
+
+    /// Write to `sel` the positions i < n whose value, at values + i * the
+    /// kind's width, compares `op` to `operand` (stored bytes, see
+    /// Schema::encodeValue), and return how many there are.  `sel` has room
+    /// for n entries; n is at most 65536.
+    static std::size_t select(Schema::Kind kind, const char* values, std::size_t n,
+        Op op, std::string_view operand, uint16_t* sel);
+
+    /// True if select() runs the AVX2 kernels on this machine.
+    static bool usesAvx2();
+};
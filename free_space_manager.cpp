@@ -1,5 +1,7 @@
 ﻿#include "free_space_manager.h"
+#include "heap_page.h"
 
+#include <algorithm>  // for std::clamp, std::min, std::max
 #include <cstring>    // for std::memset
 #include <iostream>   // for std::cerr, std::cout
 
@@ -7,76 +9,56 @@ using std::uint32_t;
 using std::uint16_t;
 
 FreeSpaceManager::FreeSpaceManager(const std::string& tablePath,
-    int                recordSize,
     BufferManager& bm)
     : metaPath(tablePath + "/free_space.meta"),
-    recordsPerPage(computeRecordsPerPage(recordSize)),
     bufferManager(bm)
 {
     std::cout << "initilized freespace manager" << std :: endl;
+    rebuildTree();
 
 }
 
-/// Compute how many (recordSize + 1)‐byte slots fit in 4096 bytes
-int FreeSpaceManager::computeRecordsPerPage(int recordSize) {
-    // +1 for the isValid flag per record; we store one PageMeta (6 bytes) per record slot
-    return PAGE_SIZE / (recordSize + 1);
-}
-
-
 void FreeSpaceManager::initialize() {
     pages.clear();
-    pages.push_back({ 0, static_cast<uint16_t>(recordsPerPage) });
-    std::cout << "FreeSpaceManager: Initialized with page 0, freeSlots="
-        << recordsPerPage << "\n";
+    pages.push_back({ 0, static_cast<uint16_t>(HeapPage::MAX_RECORD_SIZE) });
+    rebuildTree();
+    std::cout << "FreeSpaceManager: Initialized with page 0, freeBytes="
+        << HeapPage::MAX_RECORD_SIZE << "\n";
     save();
 }
 
-/// Load all PageMeta entries from “free_space.meta” via the buffer. Stops once
-/// it encounters a page of all-zero entries (meaning “no more saved metadata”).
+/// Load all PageMeta entries from “free_space.meta” via the buffer.  Entry i
+/// describes data page i, so the list ends at the first entry that does not
+/// (a never-written, all-zero entry).
 void FreeSpaceManager::load() {
     std::cout << "entered load fsm" << std::endl;
     pages.clear();
     std::cout << "cleared page" << std::endl;
     int entriesPerPage = PAGE_SIZE / static_cast<int>(sizeof(PageMeta));
 
-    // Read pages one by one, until we find an entirely‐zero page or no data at all.
-    for (uint32_t pageNum = 0; ; ++pageNum) {
+    bool more = true;
+    for (uint32_t pageNum = 0; more; ++pageNum) {
         BMKey key{ metaPath, pageNum };
         std::cout << "created bm keys" << std::endl;
         char* pageBuf = bufferManager.getPage(key.filePath, key.pageNum, PageType::META);
         
         if (!pageBuf) {
             std::cerr << "FreeSpaceManager::load: Cannot pin meta page " << pageNum << "\n";
-            return;
+            break;
         }
         std::cout << "done with page creation" << std::endl;
         PageMeta* metaArr = reinterpret_cast<PageMeta*>(pageBuf);
-        bool anyNonZero = false;
-        for (int i = 0; i < entriesPerPage; ++i) {
-            if (metaArr[i].pageId != 0 || metaArr[i].freeSlots != 0) {
-                anyNonZero = true;
-                pages.push_back(metaArr[i]);
-            }
-            else {
-   
-                if (pageNum == 0 && pages.empty()) {
-                    // No metadata saved yet; just return with pages empty.
-                    bufferManager.unpinPage(key.filePath, key.pageNum, PageType::META, false);
-                    return;
-                }
-                // Otherwise, we hit a zero entry after having loaded some metadata: end.
-                break;
-            }
+        for (int i = 0; i < entriesPerPage && more; ++i) {
+            const PageMeta& pm = metaArr[i];
+            // a full page 0 is all zeroes too; page 1 after it tells it apart
+            more = pm.pageId == pages.size()
+                && (pm.pageId != 0 || pm.freeBytes != 0 || metaArr[1].pageId == 1);
+            if (more) pages.push_back(pm);
         }
 
         bufferManager.unpinPage(key.filePath, key.pageNum, PageType::META, false);
-
-        if (!anyNonZero) {
-            // Entire page was empty => no more metadata to load
-            break;
-        }
     }
+    rebuildTree();
     std::cout << "loaded page without any issues" << std::endl;
 }
 
@@ -117,56 +99,124 @@ void FreeSpaceManager::save() const {
     // (Omitted for simplicity—those extra pages will simply be overwritten next time.)
 }
 
-/// Return a pageId that has at least one free slot. If none exist in current `pages`,
-/// add a new PageMeta {newId, recordsPerPage} and save. Then return newId.
-uint32_t FreeSpaceManager::getPageWithFreeSlot() {
-    for (auto const& pm : pages) {
-        if (pm.freeSlots > 0) {
-            return pm.pageId;
-        }
+/// Write pages[pageId] into its slot of free_space.meta: one entry copied,
+/// one meta page dirtied.
+void FreeSpaceManager::writeEntry(uint32_t pageId) const {
+    int entriesPerPage = PAGE_SIZE / static_cast<int>(sizeof(PageMeta));
+    BMKey key{ metaPath, pageId / entriesPerPage };
+    char* pageBuf = bufferManager.getPage(key.filePath, key.pageNum, PageType::META);
+    if (!pageBuf) {
+        std::cerr << "FreeSpaceManager::writeEntry: Cannot pin meta page " << key.pageNum << "\n";
+        return;
     }
-    // No existing page has free slots: allocate new pageId
-    uint32_t newId = pages.empty() ? 0 : (pages.back().pageId + 1);
-    pages.push_back({ newId, static_cast<uint16_t>(recordsPerPage) });
-    save();
-    std::cout << "giving page with new slot" << std::endl;
-    return newId;
+    reinterpret_cast<PageMeta*>(pageBuf)[pageId % entriesPerPage] = pages[pageId];
+    bufferManager.unpinPage(key.filePath, key.pageNum, PageType::META, true);
 }
 
-/// Decrement freeSlots on pageId, then save() via buffer
-void FreeSpaceManager::markSlotUsed(uint32_t pageId) {
+void FreeSpaceManager::rebuildTree() {
+    leaves = 1;
+    while (leaves < pages.size()) leaves *= 2;
+    tree.assign(2 * leaves, 0);
     for (auto& pm : pages) {
-        if (pm.pageId == pageId) {
-            if (pm.freeSlots > 0) {
-                pm.freeSlots--;
-            }
-            else {
-                std::cerr << "Warning: FreeSpaceManager::markSlotUsed: page " << pageId
-                    << " has no free slots\n";
+        pm.freeBytes = std::min<uint16_t>(pm.freeBytes, HeapPage::MAX_RECORD_SIZE);
+        tree[leaves + pm.pageId] = pm.freeBytes;
+    }
+    for (std::size_t n = leaves - 1; n >= 1; --n) tree[n] = std::max(tree[2 * n], tree[2 * n + 1]);
+}
+
+void FreeSpaceManager::setLeaf(uint32_t pageId) {
+    std::size_t n = leaves + pageId;
+    tree[n] = pages[pageId].freeBytes;
+    for (n /= 2; n >= 1; n /= 2) {
+        uint16_t most = std::max(tree[2 * n], tree[2 * n + 1]);
+        if (tree[n] == most) break;  // nothing above changes either
+        tree[n] = most;
+    }
+}
+
+long FreeSpaceManager::findFrom(uint32_t start, int bytes) const {
+    if (start >= pages.size() || tree[1] < bytes) return -1;
+    std::size_t n = leaves + start;
+    if (tree[n] < bytes) {
+        // climb until a right sibling has room, then take its leftmost such leaf
+        for (;;) {
+            if (n == 1) return -1;
+            if (n % 2 == 0 && tree[n + 1] >= bytes) {
+                ++n;
+                break;
             }
-            save();
-            return;
+            n /= 2;
         }
+        while (n < leaves) n = tree[2 * n] >= bytes ? 2 * n : 2 * n + 1;
     }
-    std::cerr << "Warning: FreeSpaceManager::markSlotUsed: page " << pageId
-        << " not tracked in free_space.meta\n";
+    const std::size_t page = n - leaves;
+    return page < pages.size() ? static_cast<long>(page) : -1;
 }
 
-/// Increment freeSlots on pageId, then save() via buffer
-void FreeSpaceManager::markSlotFree(uint32_t pageId) {
-    for (auto& pm : pages) {
-        if (pm.pageId == pageId) {
-            if (pm.freeSlots < recordsPerPage) {
-                pm.freeSlots++;
-            }
-            else {
-                std::cerr << "Warning: FreeSpaceManager::markSlotFree: page " << pageId
-                    << " already fully free\n";
-            }
-            save();
+/// Search the tree from the hint or from where the last search ended, then
+/// from page 0.  If no page has room, add a new PageMeta
+/// {newId, MAX_RECORD_SIZE}, write its entry and return newId.
+uint32_t FreeSpaceManager::getPageWithFreeSpace(int bytes, uint32_t hint) {
+    bytes = std::max(bytes, 1);  // empty padding leaves must never match
+    const bool hinted = hint != NO_HINT && !pages.empty();
+    const uint32_t start = hinted ? hint % static_cast<uint32_t>(pages.size()) : nextPage;
+    long found = findFrom(start, bytes);
+    if (found < 0 && start > 0) found = findFrom(0, bytes);
+    if (found >= 0) {
+        if (!hinted) nextPage = static_cast<uint32_t>(found);
+        return static_cast<uint32_t>(found);
+    }
+
+    // No existing page has room: allocate new pageId
+    uint32_t newId = static_cast<uint32_t>(pages.size());
+    pages.push_back({ newId, static_cast<uint16_t>(HeapPage::MAX_RECORD_SIZE) });
+    if (pages.size() > leaves) rebuildTree();
+    else setLeaf(newId);
+    writeEntry(newId);
+    if (!hinted) nextPage = newId;
+    std::cout << "giving page with new slot" << std::endl;
+    return newId;
+}
+
+long FreeSpaceManager::firstPageWithFreeSpace(int bytes) const {
+    return findFrom(0, std::max(bytes, 1));
+}
+
+uint32_t FreeSpaceManager::pageCount() const {
+    return static_cast<uint32_t>(pages.size());
+}
+
+/// Zero the dropped entries on disk (load() stops at the first of them),
+/// one meta page pinned at a time, then shrink the tree to the pages left.
+void FreeSpaceManager::truncate(uint32_t count) {
+    if (count >= pages.size()) return;
+    const uint32_t entriesPerPage = PAGE_SIZE / static_cast<uint32_t>(sizeof(PageMeta));
+    for (uint32_t i = count; i < pages.size();) {
+        BMKey key{ metaPath, i / entriesPerPage };
+        char* pageBuf = bufferManager.getPage(key.filePath, key.pageNum, PageType::META);
+        if (!pageBuf) {
+            std::cerr << "FreeSpaceManager::truncate: Cannot pin meta page " << key.pageNum << "\n";
             return;
         }
+        const uint32_t end = std::min<uint32_t>((key.pageNum + 1) * entriesPerPage,
+            static_cast<uint32_t>(pages.size()));
+        std::memset(pageBuf + (i % entriesPerPage) * sizeof(PageMeta), 0, (end - i) * sizeof(PageMeta));
+        bufferManager.unpinPage(key.filePath, key.pageNum, PageType::META, true);
+        i = end;
+    }
+    pages.resize(count);
+    rebuildTree();
+    if (nextPage >= count) nextPage = 0;
+}
+
+/// Update pageId's leaf and the summaries above it, then write its entry
+void FreeSpaceManager::setFreeSpace(uint32_t pageId, int bytes) {
+    if (pageId >= pages.size()) {
+        std::cerr << "Warning: FreeSpaceManager::setFreeSpace: page " << pageId
+            << " not tracked in free_space.meta\n";
+        return;
     }
-    std::cerr << "Warning: FreeSpaceManager::markSlotFree: page " << pageId
-        << " not tracked in free_space.meta\n";
+    pages[pageId].freeBytes = static_cast<uint16_t>(std::clamp(bytes, 0, HeapPage::MAX_RECORD_SIZE));
+    setLeaf(pageId);
+    writeEntry(pageId);
 }
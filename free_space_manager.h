@@ -3,28 +3,25 @@
 #include <string>
 #include <vector>
 #include <cstdint>
+#include <cstddef>
 #include "BufferManager.h"
 
-/// Each PageMeta occupies 6 bytes: 4 for pageId, 2 for freeSlots.
+/// Each PageMeta occupies 6 bytes: 4 for pageId, 2 for freeBytes, the
+/// longest record the data page still takes (HeapPage::freeSpace).
 /// Storing these sequentially in 4 KB pages (so PAGE_SIZE / sizeof(PageMeta) entries per page).
 struct PageMeta {
     uint32_t pageId;
-    uint16_t freeSlots;
+    uint16_t freeBytes;
 };
 
 class FreeSpaceManager {
 public:
     /// tablePath: path to the table directory (e.g. "Tables/myTable")
-    /// recordSize: total bytes per record (including the 1-byte isValid flag)
     /// bm: a reference to the global BufferManager instance
     FreeSpaceManager(const std::string& tablePath,
-        int                recordSize,
         BufferManager& bm);
 
-    /// Calculate how many records (plus 1-byte valid flag) fit in 4096 bytes
-    static int computeRecordsPerPage(int recordSize);
-
-    /// Start fresh: clear all pages and create page 0 with all slots free
+    /// Start fresh: clear all pages and create an empty page 0
     void initialize();
 
     /// Load all PageMeta entries from free_space.meta (via buffer). If not found, pages stays empty.
@@ -33,20 +30,49 @@ public:
     /// Persist all PageMeta entries into free_space.meta (via buffer)
     void save() const;
 
-    /// Return a pageId that has at least one free slot; allocate a new page if none exist.
-    uint32_t getPageWithFreeSlot();
+    static constexpr uint32_t NO_HINT = UINT32_MAX;
+
+    /// Return the first page, at or after where the last search ended (or
+    /// at or after `hint`, wrapping around), that takes a record of `bytes`
+    /// bytes; allocate a new page if none does.  O(log pages), and inserts
+    /// stay on one page until it is full instead of all piling onto the
+    /// first page with room.  Inserters working side by side pass different
+    /// hints (e.g. from their thread) to fill different pages.
+    uint32_t getPageWithFreeSpace(int bytes, uint32_t hint = NO_HINT);
+
+    /// Record pageId's free space after an insert or delete and write its
+    /// entry back, dirtying only the meta page that holds it.
+    void setFreeSpace(uint32_t pageId, int bytes);
 
-    /// Mark one slot used on pageId: decrement freeSlots, then save metadata via buffer.
-    void markSlotUsed(uint32_t pageId);
+    /// The lowest page that takes a record of `bytes` bytes, or -1 if none
+    /// does; unlike getPageWithFreeSpace it never allocates.
+    long firstPageWithFreeSpace(int bytes) const;
 
-    /// Mark one slot free on pageId: increment freeSlots, then save metadata via buffer.
-    void markSlotFree(uint32_t pageId);
+    /// Pages tracked, i.e. data.tbl's length in pages.
+    uint32_t pageCount() const;
+
+    /// Forget pages `count` and after, as data.tbl is cut to `count` pages,
+    /// clearing their entries in free_space.meta.
+    void truncate(uint32_t count);
 
 private:
     std::string          metaPath;        // e.g. "Tables/myTable/free_space.meta"
-    int                  recordsPerPage;  // how many PageMeta entries fit in one 4 KB page
-    std::vector<PageMeta> pages;          // in-memory list of metadata entries
+    std::vector<PageMeta> pages;          // in-memory list of metadata entries, pages[i].pageId == i
     BufferManager& bufferManager;   // reference to the global buffer manager
 
+    /// Free-space tree, as in PostgreSQL's FSM: a complete binary tree over
+    /// the pages, stored heap-style (children of node n at 2n and 2n + 1).
+    /// Leaf `leaves + i` is page i's free bytes and every inner node the
+    /// most free bytes below it, so a search descends only into subtrees
+    /// that hold a page with room.  Rebuilt from the entries on load.
+    std::vector<uint16_t> tree;
+    std::size_t           leaves = 0;       // a power of two >= pages.size()
+    uint32_t              nextPage = 0;     // where an unhinted search starts
+
     static constexpr int PAGE_SIZE = 4096;
+
+    void rebuildTree();                     // size it for pages, fill every node
+    void setLeaf(uint32_t pageId);          // pages[pageId] changed: update its path
+    long findFrom(uint32_t start, int bytes) const;  // first page >= start with room, or -1
+    void writeEntry(uint32_t pageId) const; // persist one entry via buffer
 };
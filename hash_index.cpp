@@ -0,0 +1,409 @@
+#include "hash_index.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace {
+
+    /// Byte offsets inside the header page.
+    constexpr std::size_t HDR_MAGIC = 0;
+    constexpr std::size_t HDR_VERSION = 4;
+    constexpr std::size_t HDR_DEPTH = 8;
+    constexpr std::size_t HDR_DIR_COUNT = 12;
+    constexpr std::size_t HDR_PAGES = 16;
+    constexpr std::size_t HDR_KEYS = 24;
+    constexpr std::size_t HDR_DIR = 32;   // directory page numbers follow
+
+    /// Byte offsets inside a bucket page.
+    constexpr std::size_t BKT_DEPTH = 0;
+    constexpr std::size_t BKT_COUNT = 4;
+    constexpr std::size_t BKT_USED = 6;
+    constexpr std::size_t BKT_OVERFLOW = 8;
+
+    template <typename T>
+    T loadField(const char* page, std::size_t offset) {
+        T value;
+        std::memcpy(&value, page + offset, sizeof(T));
+        return value;
+    }
+
+    template <typename T>
+    void storeField(char* page, std::size_t offset, T value) {
+        std::memcpy(page + offset, &value, sizeof(T));
+    }
+
+    /// Bytes one entry takes in a bucket: length byte, key, record offset.
+    int entrySize(const std::string& key) {
+        return 1 + static_cast<int>(key.size()) + static_cast<int>(sizeof(long));
+    }
+
+    uint64_t hashOf(const std::string& key) {
+        return Utils::mixHash(Utils::fnv1a(key));
+    }
+}
+
+// 
+// Shared per-file state
+// 
+
+struct HashIndex::SharedState {
+    std::shared_mutex  mtx;
+    uint32_t           globalDepth = 0;
+    std::vector<long>  directory;      // bucket page per slot; empty = no buckets yet
+    std::vector<long>  dirPages;       // pages holding 'directory'
+    long               pageCount = 0;
+    long               keyCount = 0;
+    long               savedKeyCount = 0;  // keyCount as of the last header write
+    bool               forgotten = false;  // file deleted (see forget): write nothing back
+};
+
+struct HashIndex::Registry {
+    std::mutex                                                    mtx;
+    std::unordered_map<std::string, std::shared_ptr<SharedState>> states;
+};
+
+HashIndex::Registry& HashIndex::registry() {
+    static Registry r;
+    return r;
+}
+
+HashIndex::HashIndex(const std::string& filename, BufferManager& bm)
+    : filePath(filename),
+    bufMgr(bm)
+{
+    // Only the first open of a file reads its header and directory.
+    Registry& r = registry();
+    std::lock_guard<std::mutex> guard(r.mtx);
+    std::shared_ptr<SharedState>& shared = r.states[filePath];
+    if (!shared) {
+        shared = std::make_shared<SharedState>();
+        state = shared;
+        openFile();
+        return;
+    }
+    state = shared;
+}
+
+HashIndex::~HashIndex() {
+    // As in BPlusTree, the key count reaches the header lazily.
+    std::unique_lock<std::shared_mutex> lock(state->mtx);
+    if (!state->forgotten && !state->directory.empty() && state->savedKeyCount != state->keyCount) {
+        writeHeader();
+    }
+}
+
+void HashIndex::forget(const std::string& tablePath) {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> guard(r.mtx);
+    const std::string dir = tablePath + "/";
+    for (auto it = r.states.begin(); it != r.states.end();) {
+        if (it->first.compare(0, dir.size(), dir) == 0) {
+            std::unique_lock<std::shared_mutex> lock(it->second->mtx);
+            it->second->forgotten = true;
+            lock.unlock();
+            it = r.states.erase(it);
+        }
+        else ++it;
+    }
+}
+
+HashIndex::Stats HashIndex::stats() const {
+    std::shared_lock<std::shared_mutex> lock(state->mtx);
+    Stats s;
+    s.keyCount = state->keyCount;
+    s.globalDepth = static_cast<int>(state->globalDepth);
+    s.pageCount = state->pageCount;
+    return s;
+}
+
+int HashIndex::Bucket::bytes() const {
+    int total = BUCKET_HEADER_SIZE;
+    for (const auto& e : entries) total += entrySize(e.first);
+    return total;
+}
+
+std::size_t HashIndex::slotOf(const std::string& key) const {
+    return static_cast<std::size_t>(hashOf(key) & ((1ULL << state->globalDepth) - 1));
+}
+
+// 
+// Header and directory pages
+// 
+
+void HashIndex::openFile() {
+    char* pageBuf = bufMgr.getPage(filePath, HEADER_PAGE, PageType::INDEX);
+    if (!pageBuf) {
+        std::cerr << "[HashIndex] openFile: cannot pin header of " << filePath << "\n";
+        return;
+    }
+    bool valid = loadField<uint32_t>(pageBuf, HDR_MAGIC) == MAGIC
+        && loadField<uint32_t>(pageBuf, HDR_VERSION) == FORMAT_VERSION;
+    if (valid) {
+        state->globalDepth = loadField<uint32_t>(pageBuf, HDR_DEPTH);
+        state->pageCount = loadField<long>(pageBuf, HDR_PAGES);
+        state->keyCount = loadField<long>(pageBuf, HDR_KEYS);
+        state->savedKeyCount = state->keyCount;
+        uint32_t dirCount = loadField<uint32_t>(pageBuf, HDR_DIR_COUNT);
+        for (uint32_t i = 0; i < dirCount; ++i) {
+            state->dirPages.push_back(loadField<long>(pageBuf, HDR_DIR + i * sizeof(long)));
+        }
+    }
+    bufMgr.unpinPage(filePath, HEADER_PAGE, PageType::INDEX, /*isDirty=*/false);
+    if (!valid) return;  // blank file: initialized by the first insert
+
+    std::size_t slots = std::size_t(1) << state->globalDepth;
+    state->directory.reserve(slots);
+    for (long dirPage : state->dirPages) {
+        char* buf = bufMgr.getPage(filePath, static_cast<uint32_t>(dirPage), PageType::INDEX);
+        if (!buf) {
+            std::cerr << "[HashIndex] openFile: cannot pin directory page " << dirPage << "\n";
+            state->directory.clear();
+            return;
+        }
+        for (int i = 0; i < DIR_SLOTS_PER_PAGE && state->directory.size() < slots; ++i) {
+            state->directory.push_back(loadField<long>(buf, i * sizeof(long)));
+        }
+        bufMgr.unpinPage(filePath, static_cast<uint32_t>(dirPage), PageType::INDEX, false);
+    }
+}
+
+void HashIndex::initialize() {
+    state->pageCount = HEADER_PAGE + 1;
+    state->globalDepth = 0;
+    Bucket first;
+    first.page = allocatePage();
+    writeBucket(first);
+    state->directory.assign(1, first.page);
+    state->dirPages.assign(1, allocatePage());
+    writeDirectoryPage(0);
+    writeHeader();
+}
+
+void HashIndex::writeHeader() {
+    char* pageBuf = bufMgr.getPage(filePath, HEADER_PAGE, PageType::INDEX);
+    if (!pageBuf) {
+        std::cerr << "[HashIndex] writeHeader: cannot pin page 0\n";
+        return;
+    }
+    std::memset(pageBuf, 0, PAGE_SIZE);
+    storeField(pageBuf, HDR_MAGIC, MAGIC);
+    storeField(pageBuf, HDR_VERSION, FORMAT_VERSION);
+    storeField(pageBuf, HDR_DEPTH, state->globalDepth);
+    storeField(pageBuf, HDR_DIR_COUNT, static_cast<uint32_t>(state->dirPages.size()));
+    storeField(pageBuf, HDR_PAGES, state->pageCount);
+    storeField(pageBuf, HDR_KEYS, state->keyCount);
+    for (std::size_t i = 0; i < state->dirPages.size(); ++i) {
+        storeField(pageBuf, HDR_DIR + i * sizeof(long), state->dirPages[i]);
+    }
+    bufMgr.unpinPage(filePath, HEADER_PAGE, PageType::INDEX, /*isDirty=*/true);
+    state->savedKeyCount = state->keyCount;
+}
+
+void HashIndex::writeDirectoryPage(std::size_t index) {
+    long page = state->dirPages[index];
+    char* buf = bufMgr.getPage(filePath, static_cast<uint32_t>(page), PageType::INDEX);
+    if (!buf) {
+        std::cerr << "[HashIndex] writeDirectoryPage: cannot pin page " << page << "\n";
+        return;
+    }
+    std::memset(buf, 0, PAGE_SIZE);
+    std::size_t first = index * DIR_SLOTS_PER_PAGE;
+    std::size_t last = std::min(first + DIR_SLOTS_PER_PAGE, state->directory.size());
+    for (std::size_t slot = first; slot < last; ++slot) {
+        storeField(buf, (slot - first) * sizeof(long), state->directory[slot]);
+    }
+    bufMgr.unpinPage(filePath, static_cast<uint32_t>(page), PageType::INDEX, true);
+}
+
+long HashIndex::allocatePage() {
+    return state->pageCount++;
+}
+
+// 
+// Buckets
+// 
+
+HashIndex::Bucket HashIndex::readBucket(long page) {
+    Bucket b;
+    b.page = page;
+    char* buf = bufMgr.getPage(filePath, static_cast<uint32_t>(page), PageType::INDEX);
+    if (!buf) {
+        std::cerr << "[HashIndex] readBucket: cannot pin page " << page << "\n";
+        return b;
+    }
+    b.localDepth = loadField<uint32_t>(buf, BKT_DEPTH);
+    b.overflow = loadField<long>(buf, BKT_OVERFLOW);
+    uint16_t count = loadField<uint16_t>(buf, BKT_COUNT);
+    std::size_t pos = BUCKET_HEADER_SIZE;
+    b.entries.reserve(count);
+    for (uint16_t i = 0; i < count; ++i) {
+        uint8_t len = static_cast<uint8_t>(buf[pos]);
+        std::string key(buf + pos + 1, len);
+        long offset = loadField<long>(buf, pos + 1 + len);
+        b.entries.emplace_back(std::move(key), offset);
+        pos += 1 + len + sizeof(long);
+    }
+    bufMgr.unpinPage(filePath, static_cast<uint32_t>(page), PageType::INDEX, false);
+    return b;
+}
+
+void HashIndex::writeBucket(const Bucket& b) {
+    char* buf = bufMgr.getPage(filePath, static_cast<uint32_t>(b.page), PageType::INDEX);
+    if (!buf) {
+        std::cerr << "[HashIndex] writeBucket: cannot pin page " << b.page << "\n";
+        return;
+    }
+    std::memset(buf, 0, PAGE_SIZE);
+    storeField(buf, BKT_DEPTH, b.localDepth);
+    storeField(buf, BKT_COUNT, static_cast<uint16_t>(b.entries.size()));
+    storeField(buf, BKT_USED, static_cast<uint16_t>(b.bytes()));
+    storeField(buf, BKT_OVERFLOW, b.overflow);
+    std::size_t pos = BUCKET_HEADER_SIZE;
+    for (const auto& [key, offset] : b.entries) {
+        buf[pos] = static_cast<char>(key.size());
+        std::memcpy(buf + pos + 1, key.data(), key.size());
+        storeField(buf, pos + 1 + key.size(), offset);
+        pos += 1 + key.size() + sizeof(long);
+    }
+    bufMgr.unpinPage(filePath, static_cast<uint32_t>(b.page), PageType::INDEX, true);
+}
+
+void HashIndex::splitBucket(Bucket& b) {
+    if (b.localDepth == state->globalDepth) {
+        // Double the directory: slot i + n starts out sharing slot i's bucket.
+        std::size_t n = state->directory.size();
+        state->directory.resize(2 * n);
+        std::copy_n(state->directory.begin(), n, state->directory.begin() + n);
+        ++state->globalDepth;
+        std::size_t pagesNeeded = (2 * n + DIR_SLOTS_PER_PAGE - 1) / DIR_SLOTS_PER_PAGE;
+        while (state->dirPages.size() < pagesNeeded) {
+            state->dirPages.push_back(allocatePage());
+        }
+    }
+
+    // Entries whose hash has the next bit set move to the new bucket.
+    const uint64_t bit = 1ULL << b.localDepth;
+    Bucket high;
+    high.page = allocatePage();
+    high.localDepth = ++b.localDepth;
+    std::vector<std::pair<std::string, long>> low;
+    for (auto& e : b.entries) {
+        if (hashOf(e.first) & bit) high.entries.push_back(std::move(e));
+        else                       low.push_back(std::move(e));
+    }
+    b.entries = std::move(low);
+    writeBucket(b);
+    writeBucket(high);
+
+    std::vector<bool> dirty(state->dirPages.size(), false);
+    for (std::size_t slot = 0; slot < state->directory.size(); ++slot) {
+        if (state->directory[slot] == b.page && (slot & bit)) {
+            state->directory[slot] = high.page;
+            dirty[slot / DIR_SLOTS_PER_PAGE] = true;
+        }
+    }
+    for (std::size_t i = 0; i < dirty.size(); ++i) {
+        if (dirty[i]) writeDirectoryPage(i);
+    }
+    writeHeader();
+}
+
+// 
+// Operations
+// 
+
+void HashIndex::insert(const std::string& key, long recordOffset) {
+    if (key.size() >= KEY_SIZE) {
+        std::cerr << "[HashIndex] insert: key longer than " << KEY_SIZE - 1
+            << " bytes not stored in " << filePath << "\n";
+        return;
+    }
+    std::unique_lock<std::shared_mutex> lock(state->mtx);
+    if (state->directory.empty()) initialize();
+
+    while (true) {
+        Bucket b = readBucket(state->directory[slotOf(key)]);
+        if (b.bytes() + entrySize(key) <= PAGE_SIZE) {
+            b.entries.emplace_back(key, recordOffset);
+            writeBucket(b);
+            ++state->keyCount;
+            return;
+        }
+        if (b.localDepth < MAX_DEPTH) {
+            splitBucket(b);
+            continue;  // the key's bucket may have changed
+        }
+
+        // Deepest the directory goes: chain an overflow page instead.
+        while (b.overflow != -1) {
+            b = readBucket(b.overflow);
+            if (b.bytes() + entrySize(key) <= PAGE_SIZE) break;
+        }
+        if (b.bytes() + entrySize(key) > PAGE_SIZE) {
+            Bucket next;
+            next.page = allocatePage();
+            next.localDepth = b.localDepth;
+            b.overflow = next.page;
+            writeBucket(b);
+            writeHeader();
+            b = next;
+        }
+        b.entries.emplace_back(key, recordOffset);
+        writeBucket(b);
+        ++state->keyCount;
+        return;
+    }
+}
+
+bool HashIndex::search(const std::string& key, long& recordOffset) {
+    std::shared_lock<std::shared_mutex> lock(state->mtx);
+    if (state->directory.empty() || key.size() >= KEY_SIZE) return false;
+
+    // Compare in the page itself; a lookup decodes nothing.
+    long page = state->directory[slotOf(key)];
+    while (page != -1) {
+        char* buf = bufMgr.getPage(filePath, static_cast<uint32_t>(page), PageType::INDEX);
+        if (!buf) return false;
+        uint16_t count = loadField<uint16_t>(buf, BKT_COUNT);
+        std::size_t pos = BUCKET_HEADER_SIZE;
+        bool found = false;
+        for (uint16_t i = 0; i < count && !found; ++i) {
+            uint8_t len = static_cast<uint8_t>(buf[pos]);
+            if (len == key.size() && std::memcmp(buf + pos + 1, key.data(), len) == 0) {
+                recordOffset = loadField<long>(buf, pos + 1 + len);
+                found = true;
+            }
+            pos += 1 + len + sizeof(long);
+        }
+        long next = loadField<long>(buf, BKT_OVERFLOW);
+        bufMgr.unpinPage(filePath, static_cast<uint32_t>(page), PageType::INDEX, false);
+        if (found) return true;
+        page = next;
+    }
+    return false;
+}
+
+bool HashIndex::remove(const std::string& key) {
+    std::unique_lock<std::shared_mutex> lock(state->mtx);
+    if (state->directory.empty() || key.size() >= KEY_SIZE) return false;
+
+    long page = state->directory[slotOf(key)];
+    while (page != -1) {
+        Bucket b = readBucket(page);
+        auto it = std::find_if(b.entries.begin(), b.entries.end(),
+            [&](const auto& e) { return e.first == key; });
+        if (it != b.entries.end()) {
+            b.entries.erase(it);
+            writeBucket(b);
+            --state->keyCount;
+            return true;
+        }
+        page = b.overflow;
+    }
+    return false;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include "BufferManager.h"
+
+/// Disk-based extendible hash index for unique keys.  Answers equality
+/// probes only; range predicates on a hash-indexed column fall back to a scan.
+///
+/// File layout: page 0 is the header (magic, format version, global depth,
+/// page and key counts, and the list of pages holding the bucket directory).
+/// Every other page is a directory page (512 bucket page numbers) or a
+/// bucket.  A bucket holds (length, key, record offset) entries packed after
+/// a 16-byte header of local depth, entry count, bytes used and overflow page.
+///
+/// The directory is read into memory the first time the file is opened in
+/// the process, so a lookup costs a single bucket page read.  A full bucket
+/// splits on its next hash bit, doubling the directory first when its local
+/// depth has caught up with the global depth.  Past MAX_DEPTH buckets grow
+/// an overflow chain instead.  Removes leave buckets in place; nothing merges.
+///
+/// Concurrency: one reader/writer lock per file, shared by every HashIndex
+/// object opened on it.  Lookups share it; inserts and removes take it
+/// exclusively.
+class HashIndex {
+public:
+    static constexpr int PAGE_SIZE = 4096;
+    static constexpr int KEY_SIZE = 40;  // longer keys are not stored, as in BPlusTree
+    static constexpr long HEADER_PAGE = 0;
+    static constexpr uint32_t MAGIC = 0x58495348;  // "HSIX"
+    static constexpr uint32_t FORMAT_VERSION = 1;
+    static constexpr int DIR_SLOTS_PER_PAGE = PAGE_SIZE / sizeof(long);
+    static constexpr int MAX_DIR_PAGES = (PAGE_SIZE - 32) / sizeof(long);
+    static constexpr int MAX_DEPTH = 17;  // 2^17 slots still fit in MAX_DIR_PAGES pages
+    static constexpr int BUCKET_HEADER_SIZE = 4    // local depth
+        + 2               // entry count
+        + 2               // bytes used, header included
+        + sizeof(long);   // next overflow page, -1 if none
+
+    struct Stats {
+        long keyCount;
+        int  globalDepth;  // the directory has 2^globalDepth slots
+        long pageCount;    // pages in the file, header and directory included
+    };
+
+    /// filename: path to the index file (e.g. "Tables/myTable/id.hidx")
+    /// bm: reference to the global BufferManager.
+    HashIndex(const std::string& filename, BufferManager& bm);
+    ~HashIndex();
+
+    /// Insert a (key -> recordOffset) pair.  A key of KEY_SIZE bytes or more
+    /// is not stored, and search/remove never find one.
+    void insert(const std::string& key, long recordOffset);
+
+    /// Exact lookup; if found, recordOffset is set and returns true.
+    bool search(const std::string& key, long& recordOffset);
+
+    /// Remove an exact key.  Returns true if found & removed.
+    bool remove(const std::string& key);
+
+    /// Current statistics; no I/O.
+    Stats stats() const;
+
+    /// Drop the shared state of every hash index under `tablePath`, as
+    /// BPlusTree::forget does, e.g. when the table is deleted.  Indexes still
+    /// open on the old files write no header back.
+    static void forget(const std::string& tablePath);
+
+private:
+    struct SharedState;         // per-file lock + directory (defined in .cpp)
+    struct Registry;            // file -> SharedState for the process (defined in .cpp)
+
+    static Registry& registry();
+
+    /// One bucket page, decoded.
+    struct Bucket {
+        long                                      page = -1;
+        uint32_t                                  localDepth = 0;
+        long                                      overflow = -1;
+        std::vector<std::pair<std::string, long>> entries;
+
+        int bytes() const;
+    };
+
+    std::string  filePath;
+    BufferManager& bufMgr;
+    std::shared_ptr<SharedState> state;
+
+    /// First open in this process: read the header and the directory.
+    void openFile();
+
+    /// Empty file: one bucket at depth 0 and its one-slot directory.
+    void initialize();
+
+    /// Persist the header to page 0.
+    void writeHeader();
+
+    /// Persist directory page 'index' (slots [index * 512, index * 512 + 512)).
+    void writeDirectoryPage(std::size_t index);
+
+    long allocatePage();
+    Bucket readBucket(long page);
+    void writeBucket(const Bucket& bucket);
+
+    /// Split the full bucket 'b' on its next hash bit, doubling the
+    /// directory first if needed.  Caller holds the lock exclusively.
+    void splitBucket(Bucket& b);
+
+    /// Slot of 'key' in the current directory.
+    std::size_t slotOf(const std::string& key) const;
+};
@@ -0,0 +1,151 @@
+#include "heap_page.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+    // Header layout (byte offsets)
+    constexpr int HDR_SLOTS = 0;
+    constexpr int HDR_START = 2;   // 0 on a fresh (zero-filled) page means PAGE_SIZE
+    constexpr int HDR_LIVE = 4;
+    constexpr int HDR_FREE_HINT = 6;   // no free slot below it; 0 is always true
+
+    uint16_t load16(const char* p) {
+        uint16_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    void store16(char* p, int v) {
+        uint16_t u = static_cast<uint16_t>(v);
+        std::memcpy(p, &u, sizeof(u));
+    }
+}
+
+int HeapPage::slotCount() const {
+    return load16(page + HDR_SLOTS);
+}
+
+int HeapPage::recordStart() const {
+    int start = load16(page + HDR_START);
+    return start == 0 ? PAGE_SIZE : start;
+}
+
+int HeapPage::liveBytes() const {
+    return load16(page + HDR_LIVE);
+}
+
+void HeapPage::setHeader(int slots, int start, int live) {
+    store16(page + HDR_SLOTS, slots);
+    store16(page + HDR_START, start);
+    store16(page + HDR_LIVE, live);
+}
+
+int HeapPage::firstFreeSlot() const {
+    const int slots = slotCount();
+    int slot = std::min<int>(load16(page + HDR_FREE_HINT), slots);
+    while (slot < slots && slotOffset(slot) != 0) ++slot;
+    return slot;
+}
+
+void HeapPage::setFreeHint(int slot) {
+    store16(page + HDR_FREE_HINT, slot);
+}
+
+int HeapPage::slotOffset(int slot) const {
+    return load16(page + HEADER_SIZE + slot * SLOT_SIZE);
+}
+
+int HeapPage::slotLength(int slot) const {
+    return load16(page + HEADER_SIZE + slot * SLOT_SIZE + 2);
+}
+
+void HeapPage::setSlot(int slot, int offset, int length) {
+    store16(page + HEADER_SIZE + slot * SLOT_SIZE, offset);
+    store16(page + HEADER_SIZE + slot * SLOT_SIZE + 2, length);
+}
+
+std::string_view HeapPage::record(int slot) const {
+    if (slot < 0 || slot >= slotCount() || slotOffset(slot) == 0) return {};
+    return { page + slotOffset(slot), static_cast<std::size_t>(slotLength(slot)) };
+}
+
+int HeapPage::freeSpace() const {
+    const int slots = slotCount();
+    const bool reuse = firstFreeSlot() < slots;
+    int free = PAGE_SIZE - HEADER_SIZE - slots * SLOT_SIZE - liveBytes()
+        - (reuse ? 0 : SLOT_SIZE);
+    return free > 0 ? free : 0;
+}
+
+int HeapPage::insert(std::string_view rec) {
+    const int size = static_cast<int>(rec.size());
+    if (size > freeSpace()) return -1;
+
+    int slots = slotCount();
+    const int slot = firstFreeSlot();
+    const int dirEnd = HEADER_SIZE + (slot == slots ? slots + 1 : slots) * SLOT_SIZE;
+    if (recordStart() - dirEnd < size) compact();
+
+    const int start = recordStart() - size;
+    std::memcpy(page + start, rec.data(), rec.size());
+    if (slot == slots) ++slots;
+    setHeader(slots, start, liveBytes() + size);
+    setSlot(slot, start, size);
+    setFreeHint(slot + 1);  // every slot up to this one is now in use
+    return slot;
+}
+
+bool HeapPage::update(int slot, std::string_view rec) {
+    if (record(slot).empty()) return false;
+    const int size = static_cast<int>(rec.size());
+    const int oldSize = slotLength(slot);
+    if (size <= oldSize) {
+        std::memmove(page + slotOffset(slot), rec.data(), rec.size());
+        setHeader(slotCount(), recordStart(), liveBytes() - oldSize + size);
+        setSlot(slot, slotOffset(slot), size);
+        return true;
+    }
+
+    const int free = PAGE_SIZE - HEADER_SIZE - slotCount() * SLOT_SIZE - liveBytes() + oldSize;
+    if (size > free) return false;
+
+    // Let the old bytes go, then place the record as insert() would, in the same slot.
+    setHeader(slotCount(), recordStart(), liveBytes() - oldSize);
+    setSlot(slot, 0, 0);
+    if (recordStart() - (HEADER_SIZE + slotCount() * SLOT_SIZE) < size) compact();
+    const int start = recordStart() - size;
+    std::memcpy(page + start, rec.data(), rec.size());
+    setHeader(slotCount(), start, liveBytes() + size);
+    setSlot(slot, start, size);
+    return true;
+}
+
+bool HeapPage::erase(int slot) {
+    if (record(slot).empty()) return false;
+    int slots = slotCount();
+    const int live = liveBytes() - slotLength(slot);
+    setSlot(slot, 0, 0);
+    // trailing free slots leave the directory
+    while (slots > 0 && slotOffset(slots - 1) == 0) --slots;
+    setHeader(slots, slots == 0 ? PAGE_SIZE : recordStart(), live);
+    setFreeHint(std::min<int>({ load16(page + HDR_FREE_HINT), slot, slots }));
+    return true;
+}
+
+void HeapPage::compact() {
+    std::vector<char> copy(page, page + PAGE_SIZE);
+    const int slots = slotCount();
+    int start = PAGE_SIZE;
+    for (int s = 0; s < slots; ++s) {
+        const int offset = slotOffset(s);
+        if (offset == 0) continue;
+        const int length = slotLength(s);
+        start -= length;
+        std::memcpy(page + start, copy.data() + offset, length);
+        setSlot(s, start, length);
+    }
+    setHeader(slots, start, PAGE_SIZE - start);
+}
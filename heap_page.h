@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+/// A data.tbl page in slotted layout:
+///
+///   [header][slot 0][slot 1] ...  free  ... [record 1][record 0]
+///
+/// The header holds the number of slots, where the record area starts, how
+/// many bytes live records take and a slot below which none is free, so
+/// insert() only looks for a free slot from there (normally it finds none
+/// and appends one at once).  Each slot is the (offset, length) of
+/// one record, offset 0 marking a free slot.  The slot directory grows up
+/// from the header and records grow down from the end of the page, so
+/// records can be any length and a zero-filled page is an empty one.
+///
+/// A record is addressed by its slot, which never changes while the record
+/// lives: compaction moves the bytes and rewrites the slot.  Its record ID
+/// is pageId * PAGE_SIZE + slot, which fits where the indexes keep a record
+/// offset and still gives the page as rid / PAGE_SIZE.
+///
+/// HeapPage is a view over a pinned buffer; it owns nothing.
+class HeapPage {
+public:
+    static constexpr int PAGE_SIZE = 4096;
+    static constexpr int HEADER_SIZE = 8;   // u16 slot count, record area start, live bytes, free-slot hint
+    static constexpr int SLOT_SIZE = 4;     // u16 offset, u16 length
+
+    /// The largest record a page holds: an empty page less one slot.
+    static constexpr int MAX_RECORD_SIZE = PAGE_SIZE - HEADER_SIZE - SLOT_SIZE;
+
+    explicit HeapPage(char* page) : page(page) {}
+
+    static long rid(uint32_t pageId, int slot) {
+        return static_cast<long>(pageId) * PAGE_SIZE + slot;
+    }
+    static uint32_t pageOf(long rid) { return static_cast<uint32_t>(rid / PAGE_SIZE); }
+    static int slotOf(long rid) { return static_cast<int>(rid % PAGE_SIZE); }
+
+    /// Slots in the directory, live or free.
+    int slotCount() const;
+
+    /// The record in `slot`; empty if the slot is free or not in the directory.
+    std::string_view record(int slot) const;
+
+    /// The longest record insert() would take, counting the slot it needs.
+    int freeSpace() const;
+
+    /// Store `rec` in the first free slot, or a new one, compacting the page
+    /// first if its free bytes are scattered.  Returns the slot, or -1 if the
+    /// record does not fit.
+    int insert(std::string_view rec);
+
+    /// Replace the record in `slot`, in place if it is no longer than before.
+    /// Returns false, leaving the page unchanged, if the slot is free or the
+    /// page cannot hold the new record.
+    bool update(int slot, std::string_view rec);
+
+    /// Free `slot`; its bytes come back at the next compaction.  Returns false
+    /// if the slot was already free.
+    bool erase(int slot);
+
+    /// Move the live records together at the end of the page.
+    void compact();
+
+private:
+    char* page;
+
+    int  recordStart() const;               // start of the record area
+    int  liveBytes() const;
+    void setHeader(int slots, int start, int live);
+    void setSlot(int slot, int offset, int length);
+    int  slotOffset(int slot) const;
+    int  slotLength(int slot) const;
+    int  firstFreeSlot() const;             // slotCount() if none is free
+    void setFreeHint(int slot);
+};
@@ -1,7 +1,13 @@
 ﻿#include "index_manager.h"
+#include "schema.h"
+#include "heap_page.h"
+#include "data_page.h"
+#include "overflow_file.h"
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <algorithm>
+#include <cstring>
 
 namespace fs = std::filesystem;
 
@@ -19,11 +25,28 @@ IndexManager::~IndexManager() {
         delete tree;
     }
     trees.clear();
+    for (auto& [_, hash] : hashes) {
+        delete hash;
+    }
+    hashes.clear();
+    for (auto& [_, art] : arts) {
+        delete art;
+    }
+    arts.clear();
 }
 
 void IndexManager::loadIndexes(const std::vector<std::string>& uniqueFields) {
+    // The index type of each key is part of the table metadata.
+    std::ifstream meta(tablePath + "/meta.txt");
+    std::string schemaStr, keysStr, storageStr;
+    std::getline(meta, schemaStr);
+    std::getline(meta, keysStr);
+    std::getline(meta, storageStr);
+    Schema schema(schemaStr, keysStr, storageStr);
+    fields = schema.getFields();
+    pax = schema.getStorage() == Schema::Storage::Pax;
+
     for (const auto& field : uniqueFields) {
-        std::string idxFile = tablePath + "/" + field + ".idx";
         // Ensure the table directory exists
         if (!fs::exists(tablePath)) {
             std::cerr << "[IndexManager] loadIndexes: missing table path "
@@ -31,88 +54,400 @@ void IndexManager::loadIndexes(const std::vector<std::string>& uniqueFields) {
             continue;
         }
 
-        if (!fs::exists(idxFile)) {
-            std::ofstream(idxFile, std::ios::binary).close();
+        // A missing file reads as an empty index; the buffer manager creates
+        // it on the first page write.
+        if (schema.getIndexType(field) == "hash") {
+            hashes[field] = new HashIndex(tablePath + "/" + field + ".hidx", bufMgr);
+        }
+        else if (schema.getIndexType(field) == "art") {
+            // Nothing on disk: only the first open in the process reads data.tbl.
+            ArtIndex* art = new ArtIndex(tablePath + "/" + field + ".art");
+            art->build([&] { return scanKeys(field); });
+            arts[field] = art;
+        }
+        else {
+            trees[field] = new BPlusTree(tablePath + "/" + field + ".idx", bufMgr);
+            loadIncludes(field, schema.getIncludedColumns(field));
+        }
+    }
+}
+
+void IndexManager::loadIncludes(const std::string& field,
+    const std::vector<std::string>& columns)
+{
+    if (columns.empty()) return;
+
+    // Payload = each value in its stored encoding; text ends at a '\0' or
+    // at its field width, so a payload is never wider than the fields.
+    std::vector<std::size_t> positions;
+    int width = 0;
+    for (const auto& col : columns) {
+        auto f = std::find_if(fields.begin(), fields.end(),
+            [&](const Schema::Field& sf) { return sf.name == col; });
+        if (f == fields.end()) {
+            std::cerr << "[IndexManager] loadIndexes: INCLUDE column '" << col
+                << "' of '" << field << "' is not in the table; index not covering\n";
+            return;
         }
-        
-        trees[field] = new BPlusTree(idxFile, bufMgr);
+        positions.push_back(static_cast<std::size_t>(f - fields.begin()));
+        width += f->length;
     }
+    if (width > BPlusTree::MAX_PAYLOAD_SIZE) {
+        std::cerr << "[IndexManager] loadIndexes: INCLUDE columns of '" << field
+            << "' need " << width << " bytes, more than "
+            << BPlusTree::MAX_PAYLOAD_SIZE << "; index not covering\n";
+        return;
+    }
+    included[field] = std::move(positions);
+}
+
+std::vector<ArtIndex::Entry> IndexManager::scanKeys(const std::string& field) {
+    std::vector<ArtIndex::Entry> entries;
+    const int PAGE_SIZE = HeapPage::PAGE_SIZE;
+    const Schema::Field* key = nullptr;
+    for (const auto& f : fields) {
+        if (f.name == field) key = &f;
+    }
+    const std::string dataPath = tablePath + "/data.tbl";
+    std::error_code ec;
+    auto fileSize = fs::file_size(dataPath, ec);
+    if (!key || ec) return entries;
+
+    // runs while the table is being opened, before its handle shares one
+    OverflowFile overflow(tablePath, bufMgr);
+
+    long totalPages = static_cast<long>((fileSize + PAGE_SIZE - 1) / PAGE_SIZE);
+    for (long pid = 0; pid < totalPages; ++pid) {
+        char* buf = bufMgr.getPage(dataPath, pid, PageType::DATA);
+        if (!buf) continue;
+        DataPage page(buf, pax ? &fields : nullptr);
+        for (int s = 0; s < page.slotCount(); ++s) {
+            if (!page.live(s)) continue;
+            std::string value;
+            if (page.isExternal(*key, s)) {
+                Schema::ExternalRef ref = page.externalRef(*key, s);
+                value = overflow.read(ref.firstPage, ref.length);
+            }
+            else {
+                value = Schema::decodeValue(*key, page.value(*key, s));
+            }
+            entries.emplace_back(indexKey(field, value), HeapPage::rid(static_cast<uint32_t>(pid), s));
+        }
+        bufMgr.unpinPage(dataPath, pid, PageType::DATA, false);
+    }
+    return entries;
 }
 
 void IndexManager::insertIntoIndex(const std::string& fieldName,
     const std::string& key,
-    long                offset)
+    long                offset,
+    const std::string& payload)
 {
+    const std::string k = indexKey(fieldName, key);
+    if (auto h = hashes.find(fieldName); h != hashes.end()) {
+        h->second->insert(k, offset);
+        return;
+    }
+    if (auto a = arts.find(fieldName); a != arts.end()) {
+        a->second->insert(k, offset);
+        return;
+    }
     auto it = trees.find(fieldName);
     if (it == trees.end()) {
         std::cerr << "[IndexManager] insertIntoIndex: no index for field '"
             << fieldName << "'\n";
         return;
     }
-    it->second->insert(key, offset);
+    it->second->insert(k, offset, payload);
+}
+
+void IndexManager::insertBatchIntoIndex(const std::string& fieldName,
+    std::vector<BPlusTree::Entry> entries)
+{
+    for (auto& e : entries) e.key = indexKey(fieldName, e.key);
+    if (auto h = hashes.find(fieldName); h != hashes.end()) {
+        for (const auto& e : entries) h->second->insert(e.key, e.offset);
+        return;
+    }
+    if (auto a = arts.find(fieldName); a != arts.end()) {
+        for (const auto& e : entries) a->second->insert(e.key, e.offset);
+        return;
+    }
+    auto it = trees.find(fieldName);
+    if (it == trees.end()) {
+        std::cerr << "[IndexManager] insertBatchIntoIndex: no index for field '"
+            << fieldName << "'\n";
+        return;
+    }
+    it->second->insertBatch(std::move(entries));
+}
+
+bool IndexManager::covers(const std::string& fieldName,
+    const std::vector<std::string>& columns) const
+{
+    if (!trees.count(fieldName)) return false;
+    auto inc = included.find(fieldName);
+    for (const auto& col : columns) {
+        if (col == fieldName) continue;
+        if (inc == included.end()) return false;
+        bool found = std::any_of(inc->second.begin(), inc->second.end(),
+            [&](std::size_t pos) { return fields[pos].name == col; });
+        if (!found) return false;
+    }
+    return true;
+}
+
+std::string IndexManager::makePayload(const std::string& fieldName,
+    const std::vector<std::string>& row) const
+{
+    std::string payload;
+    auto inc = included.find(fieldName);
+    if (inc == included.end()) return payload;
+    for (std::size_t pos : inc->second) {
+        const Schema::Field& f = fields[pos];
+        std::string bytes;
+        if (pos >= row.size() || !Schema::encodeValue(f, row[pos], bytes)) {
+            bytes.assign(f.kind == Schema::Kind::Char ? 0 : f.length, '\0');
+        }
+        if (f.kind == Schema::Kind::Char && bytes.size() < static_cast<std::size_t>(f.length)) {
+            bytes += '\0';  // the end of a text shorter than its column
+        }
+        payload += bytes;
+    }
+    return payload;
+}
+
+std::vector<std::string> IndexManager::rowFromIndex(const std::string& fieldName,
+    const std::string& key,
+    const std::string& payload) const
+{
+    std::vector<std::string> row(fields.size());
+    for (std::size_t i = 0; i < fields.size(); ++i) {
+        if (fields[i].name == fieldName) row[i] = key;
+    }
+    auto inc = included.find(fieldName);
+    if (inc == included.end()) return row;
+    std::size_t start = 0;
+    for (std::size_t pos : inc->second) {
+        const Schema::Field& f = fields[pos];
+        if (start >= payload.size()) break;
+        std::size_t room = payload.size() - start;
+        if (f.kind == Schema::Kind::Char) {
+            std::size_t len = strnlen(payload.data() + start, std::min<std::size_t>(room, f.length));
+            row[pos] = payload.substr(start, len);
+            start += len < static_cast<std::size_t>(f.length) ? len + 1 : len;
+        }
+        else {
+            if (room < static_cast<std::size_t>(f.length)) break;
+            row[pos] = Schema::decodeValue(f, std::string_view(payload).substr(start, f.length));
+            start += f.length;
+        }
+    }
+    return row;
+}
+
+bool IndexManager::keyFits(const std::string& fieldName,
+    const std::string& key) const
+{
+    return indexKey(fieldName, key).size() < BPlusTree::KEY_SIZE;
 }
 
 bool IndexManager::existsInIndex(const std::string& fieldName,
     const std::string& key)
 {
+    long dummy;
+    const std::string k = indexKey(fieldName, key);
+    if (auto h = hashes.find(fieldName); h != hashes.end()) {
+        return h->second->search(k, dummy);
+    }
+    if (auto a = arts.find(fieldName); a != arts.end()) {
+        return a->second->search(k, dummy);
+    }
     auto it = trees.find(fieldName);
     if (it == trees.end()) return false;
-    long dummy;
-    return it->second->search(key, dummy);
+    // Most uniqueness checks are for new keys; the filter settles those
+    // without touching the tree.
+    if (!it->second->mayContain(k)) return false;
+    return it->second->search(k, dummy);
 }
 
 void IndexManager::removeFromIndex(const std::string& fieldName,
     const std::string& key)
 {
+    const std::string k = indexKey(fieldName, key);
+    if (auto h = hashes.find(fieldName); h != hashes.end()) {
+        h->second->remove(k);
+        return;
+    }
+    if (auto a = arts.find(fieldName); a != arts.end()) {
+        a->second->remove(k);
+        return;
+    }
     auto it = trees.find(fieldName);
     if (it == trees.end()) return;
-    it->second->remove(key);
+    it->second->remove(k);
 }
 
 long IndexManager::searchIndex(const std::string& fieldName,
     const std::string& key)
 {
+    long offset;
+    const std::string k = indexKey(fieldName, key);
+    if (auto h = hashes.find(fieldName); h != hashes.end()) {
+        return h->second->search(k, offset) ? offset : -1;
+    }
+    if (auto a = arts.find(fieldName); a != arts.end()) {
+        return a->second->search(k, offset) ? offset : -1;
+    }
     auto it = trees.find(fieldName);
     if (it == trees.end()) {
         // Field not indexed
         return -1;
     }
-    long offset;
-    if (it->second->search(key, offset)) {
+    if (it->second->search(k, offset)) {
         return offset;
     }
     return -1;
 }
 
+std::vector<long> IndexManager::searchIndexBatch(const std::string& fieldName,
+    const std::vector<std::string>& keys,
+    std::vector<std::string>* payloads)
+{
+    std::vector<long> results(keys.size(), -1);
+    if (payloads) payloads->assign(keys.size(), std::string());
+    std::vector<std::string> k;
+    k.reserve(keys.size());
+    for (const auto& key : keys) k.push_back(indexKey(fieldName, key));
+    if (auto h = hashes.find(fieldName); h != hashes.end()) {
+        for (std::size_t i = 0; i < k.size(); ++i) {
+            long offset;
+            if (h->second->search(k[i], offset)) results[i] = offset;
+        }
+        return results;
+    }
+    if (auto a = arts.find(fieldName); a != arts.end()) {
+        for (std::size_t i = 0; i < k.size(); ++i) {
+            long offset;
+            if (a->second->search(k[i], offset)) results[i] = offset;
+        }
+        return results;
+    }
+    auto it = trees.find(fieldName);
+    if (it == trees.end()) return results;
+    it->second->searchBatch(k, results, payloads);
+    return results;
+}
+
 std::vector<long> IndexManager::searchGreaterEqual(const std::string& fieldName,
     const std::string& key)
 {
+    if (arts.count(fieldName)) return searchBetween(fieldName, key, "");
     std::vector<long> results;
     auto it = trees.find(fieldName);
-    if (it == trees.end()) return results;
+    const std::string k = indexKey(fieldName, key);
+    if (it == trees.end() || (k.empty() && !key.empty())) return results;
     // endKey = "" → no upper bound
-    it->second->rangeSearch(key, "", results);
+    it->second->rangeSearch(k, "", results);
     return results;
 }
 
 std::vector<long> IndexManager::searchLessEqual(const std::string& fieldName,
     const std::string& key)
 {
+    if (arts.count(fieldName)) return searchBetween(fieldName, "", key);
     std::vector<long> results;
     auto it = trees.find(fieldName);
-    if (it == trees.end()) return results;
+    const std::string k = indexKey(fieldName, key);
+    if (it == trees.end() || (k.empty() && !key.empty())) return results;
     // startKey = "" → start from leftmost
-    it->second->rangeSearch("", key, results);
+    it->second->rangeSearch("", k, results);
     return results;
 }
 
+void IndexManager::compactIndexes() {
+    for (auto& [_, tree] : trees) {
+        tree->compact();
+    }
+}
+
+bool IndexManager::getStats(const std::string& fieldName, BPlusTree::Stats& out) const {
+    if (auto h = hashes.find(fieldName); h != hashes.end()) {
+        HashIndex::Stats hs = h->second->stats();
+        out.keyCount = hs.keyCount;
+        out.height = hs.keyCount > 0 ? 1 : 0;
+        out.pageCount = hs.pageCount;
+        return true;
+    }
+    if (auto a = arts.find(fieldName); a != arts.end()) {
+        out.keyCount = a->second->size();
+        out.height = out.keyCount > 0 ? 1 : 0;
+        out.pageCount = 0;
+        return true;
+    }
+    auto it = trees.find(fieldName);
+    if (it == trees.end()) return false;
+    out = it->second->stats();
+    return true;
+}
+
 std::vector<long> IndexManager::searchBetween(const std::string& fieldName,
     const std::string& lowKey,
     const std::string& highKey)
 {
     std::vector<long> results;
+    // an empty bound is open; a number bound that is no number matches nothing
+    const std::string low = indexKey(fieldName, lowKey);
+    const std::string high = indexKey(fieldName, highKey);
+    if ((low.empty() && !lowKey.empty()) || (high.empty() && !highKey.empty())) return results;
+    if (auto a = arts.find(fieldName); a != arts.end()) {
+        std::vector<ArtIndex::Entry> entries;
+        a->second->rangeSearch(low, high, entries);
+        for (const auto& e : entries) results.push_back(e.second);
+        return results;
+    }
     auto it = trees.find(fieldName);
     if (it == trees.end()) return results;
-    it->second->rangeSearch(lowKey, highKey, results);
+    it->second->rangeSearch(low, high, results);
     return results;
 }
+
+std::vector<BPlusTree::Entry> IndexManager::searchBetweenCovering(const std::string& fieldName,
+    const std::string& lowKey,
+    const std::string& highKey,
+    bool                descending,
+    std::size_t         limit)
+{
+    std::vector<BPlusTree::Entry> results;
+    const std::string low = indexKey(fieldName, lowKey);
+    const std::string high = indexKey(fieldName, highKey);
+    if ((low.empty() && !lowKey.empty()) || (high.empty() && !highKey.empty())) return results;
+    if (auto a = arts.find(fieldName); a != arts.end()) {
+        std::vector<ArtIndex::Entry> entries;
+        a->second->rangeSearch(low, high, entries, descending, limit);
+        for (auto& e : entries) results.push_back({ std::move(e.first), e.second, std::string() });
+    }
+    else if (auto it = trees.find(fieldName); it != trees.end()) {
+        if (descending) it->second->rangeSearchDescending(low, high, results, limit);
+        else            it->second->rangeSearchCovering(low, high, results, limit);
+    }
+    for (auto& e : results) e.key = keyText(fieldName, e.key);
+    return results;
+}
+
+std::string IndexManager::indexKey(const std::string& fieldName, const std::string& key) const {
+    for (const auto& f : fields) {
+        if (f.name != fieldName) continue;
+        if (f.kind == Schema::Kind::Char) return key;
+        std::string bytes;
+        return Schema::encodeKey(f, key, bytes) ? bytes : std::string();
+    }
+    return key;
+}
+
+std::string IndexManager::keyText(const std::string& fieldName, const std::string& key) const {
+    for (const auto& f : fields) {
+        if (f.name == fieldName) return Schema::decodeKey(f, key);
+    }
+    return key;
+}
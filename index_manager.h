@@ -4,8 +4,14 @@
 #include <vector>
 #include <unordered_map>
 #include "BPlusTree.h"
+#include "hash_index.h"
+#include "art_index.h"
 #include "BufferManager.h"
+#include "schema.h"
 
+/// The indexes of one table's unique keys.  Keys cross this interface as
+/// text, as the row reads back; each index holds them in the form of
+/// Schema::encodeKey, so the keys of a number column sort as numbers.
 class IndexManager {
 public:
     /// tableName_: e.g. "users"
@@ -17,13 +23,48 @@ public:
 
     ~IndexManager();
 
-    /// Build (or re‐build) B+ trees for each unique field in uniqueFields.
+    /// Open the index of each unique field in uniqueFields: a B+ tree
+    /// (<field>.idx), or a hash index (<field>.hidx) for keys declared
+    /// "field:hash" in the table's meta.txt.  Range lookups on a hash-indexed
+    /// field find nothing; callers plan those as scans.  A key declared
+    /// "field:art" gets an in-memory adaptive radix tree instead, filled from
+    /// data.tbl the first time the table is opened in the process.  A B+ tree
+    /// key declared with INCLUDE columns ("field+col+...") is a covering index.
     void loadIndexes(const std::vector<std::string>& uniqueFields);
 
-    /// Insert (key → recordOffset) into the B+ tree for fieldName.
+    /// Insert (key → recordOffset) into the B+ tree for fieldName, with the
+    /// INCLUDE payload from makePayload if the index is covering.
     void insertIntoIndex(const std::string& fieldName,
         const std::string& key,
-        long                offset);
+        long                offset,
+        const std::string& payload = std::string());
+
+    /// Insert many entries into fieldName's B+ tree, writing each touched
+    /// leaf once.
+    void insertBatchIntoIndex(const std::string& fieldName,
+        std::vector<BPlusTree::Entry> entries);
+
+    /// True if fieldName's index holds every one of `columns` (its key or an
+    /// INCLUDE column), so a query needing only those can skip data.tbl.
+    bool covers(const std::string& fieldName,
+        const std::vector<std::string>& columns) const;
+
+    /// The INCLUDE payload of fieldName's index for the full record `row`,
+    /// each value encoded as data.tbl stores it.  "" if the index is not covering.
+    std::string makePayload(const std::string& fieldName,
+        const std::vector<std::string>& row) const;
+
+    /// A full-width record holding what fieldName's index knows about one
+    /// entry: the key and the INCLUDE columns.  Other columns are left empty.
+    std::vector<std::string> rowFromIndex(const std::string& fieldName,
+        const std::string& key,
+        const std::string& payload) const;
+
+    /// True if fieldName's index can hold `key`: every index kind keeps keys
+    /// shorter than BPlusTree::KEY_SIZE bytes, so a longer text value of a
+    /// unique column cannot be inserted (number keys always fit).
+    bool keyFits(const std::string& fieldName,
+        const std::string& key) const;
 
     /// Returns true if key exists in that field’s index.
     bool existsInIndex(const std::string& fieldName,
@@ -37,6 +78,13 @@ public:
     long searchIndex(const std::string& fieldName,
         const std::string& key);
 
+    /// Exact‐match lookup of many keys; result[i] is the recordOffset of
+    /// keys[i] or –1.  Keys in the same leaf share one descent.  If
+    /// `payloads` is given it receives each found key's INCLUDE payload.
+    std::vector<long> searchIndexBatch(const std::string& fieldName,
+        const std::vector<std::string>& keys,
+        std::vector<std::string>* payloads = nullptr);
+
     /// Find all recordOffsets whose key ≥ given key.
     std::vector<long> searchGreaterEqual(const std::string& fieldName,
         const std::string& key);
@@ -50,6 +98,24 @@ public:
         const std::string& lowKey,
         const std::string& highKey);
 
+    /// searchBetween returning whole leaf entries (key as text, offset,
+    /// payload); an empty bound is open.  `descending` walks the leaves
+    /// backwards from highKey; a non-zero `limit` stops after that many entries.
+    std::vector<BPlusTree::Entry> searchBetweenCovering(const std::string& fieldName,
+        const std::string& lowKey,
+        const std::string& highKey,
+        bool                descending = false,
+        std::size_t         limit = 0);
+
+    /// Rebuild every loaded index densely and give unused pages back to the file system.
+    void compactIndexes();
+
+    /// Key count / height / page count of fieldName's index, read from the
+    /// tree header without touching the leaves.  A hash index reports height 1
+    /// (one bucket read per probe), an in-memory tree height 1 and no pages.
+    /// False if not indexed.
+    bool getStats(const std::string& fieldName, BPlusTree::Stats& out) const;
+
 private:
     std::string                                  tableName;
     std::string                                  tablePath;
@@ -57,4 +123,29 @@ private:
 
     // Map: fieldName → pointer to its BPlusTree
     std::unordered_map<std::string, BPlusTree*>  trees;
+    // Map: fieldName → pointer to its HashIndex (fields declared "field:hash")
+    std::unordered_map<std::string, HashIndex*>  hashes;
+    // Map: fieldName → pointer to its ArtIndex (fields declared "field:art")
+    std::unordered_map<std::string, ArtIndex*>   arts;
+
+    // Table columns, and fieldName → schema positions of its INCLUDE columns
+    // (covering B+ tree indexes only)
+    std::vector<Schema::Field>                   fields;
+    bool                                         pax = false;   // data.tbl in PAX layout
+    std::unordered_map<std::string, std::vector<std::size_t>> included;
+
+    /// Resolve the INCLUDE columns of `field` against the schema; an unknown
+    /// column or a payload wider than BPlusTree::MAX_PAYLOAD_SIZE leaves the
+    /// index non-covering.
+    void loadIncludes(const std::string& field, const std::vector<std::string>& columns);
+
+    /// (key of `field`, record offset) for every live record in data.tbl.
+    std::vector<ArtIndex::Entry> scanKeys(const std::string& field);
+
+    /// `key` as fieldName's index holds it (see Schema::encodeKey); "" for a
+    /// number key that is not a number, which no number index holds.
+    std::string indexKey(const std::string& fieldName, const std::string& key) const;
+
+    /// The text of a key fieldName's index holds.
+    std::string keyText(const std::string& fieldName, const std::string& key) const;
 };
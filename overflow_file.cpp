@@ -0,0 +1,140 @@
+#include "overflow_file.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+    // Header page (page 0)
+    constexpr int HDR_PAGES = 0;   // 0 on a fresh file means the header alone
+    constexpr int HDR_FREE = 4;
+
+    // Chain pages
+    constexpr int PG_NEXT = 0;
+    constexpr int PG_USED = 4;
+
+    uint32_t load32(const char* p) {
+        uint32_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    void store32(char* p, uint32_t v) {
+        std::memcpy(p, &v, sizeof(v));
+    }
+
+    uint16_t load16(const char* p) {
+        uint16_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    void store16(char* p, int v) {
+        uint16_t u = static_cast<uint16_t>(v);
+        std::memcpy(p, &u, sizeof(u));
+    }
+}
+
+OverflowFile::OverflowFile(const std::string& tablePath, BufferManager& bm)
+    : filePath(tablePath + "/overflow.dat"),
+    bufferManager(bm)
+{
+}
+
+uint32_t OverflowFile::allocatePage() {
+    char* header = bufferManager.getPage(filePath, 0, PageType::DATA);
+    if (!header) {
+        std::cerr << "OverflowFile: cannot pin the header of " << filePath << "\n";
+        return 0;
+    }
+    uint32_t pageId = load32(header + HDR_FREE);
+    if (pageId != 0) {
+        // pop the free list
+        char* page = bufferManager.getPage(filePath, pageId, PageType::DATA);
+        if (!page) {
+            bufferManager.unpinPage(filePath, 0, PageType::DATA, false);
+            return 0;
+        }
+        store32(header + HDR_FREE, load32(page + PG_NEXT));
+        bufferManager.unpinPage(filePath, pageId, PageType::DATA, false);
+    }
+    else {
+        uint32_t pages = std::max<uint32_t>(load32(header + HDR_PAGES), 1);
+        pageId = pages;
+        store32(header + HDR_PAGES, pages + 1);
+    }
+    bufferManager.unpinPage(filePath, 0, PageType::DATA, true);
+    return pageId;
+}
+
+uint32_t OverflowFile::write(std::string_view value) {
+    std::lock_guard<std::mutex> guard(mtx);
+    uint32_t first = allocatePage();
+    uint32_t pageId = first;
+    std::size_t done = 0;
+    while (pageId != 0) {
+        const int used = static_cast<int>(std::min<std::size_t>(value.size() - done, PAGE_CAPACITY));
+        const bool last = done + used == value.size();
+        uint32_t next = last ? 0 : allocatePage();
+
+        char* page = bufferManager.getPage(filePath, pageId, PageType::DATA);
+        if (!page) {
+            std::cerr << "OverflowFile: cannot pin page " << pageId << " of " << filePath << "\n";
+            return 0;
+        }
+        store32(page + PG_NEXT, next);
+        store16(page + PG_USED, used);
+        std::memcpy(page + PAGE_HEADER, value.data() + done, used);
+        bufferManager.unpinPage(filePath, pageId, PageType::DATA, true);
+
+        done += used;
+        if (last) return first;
+        pageId = next;
+    }
+    return 0;
+}
+
+std::string OverflowFile::read(uint32_t firstPage, uint32_t length) {
+    std::lock_guard<std::mutex> guard(mtx);
+    std::string value;
+    value.reserve(length);
+    for (uint32_t pageId = firstPage; pageId != 0 && value.size() < length;) {
+        char* page = bufferManager.getPage(filePath, pageId, PageType::DATA);
+        if (!page) break;
+        const int used = std::min<int>(load16(page + PG_USED), PAGE_CAPACITY);
+        value.append(page + PAGE_HEADER, std::min<std::size_t>(used, length - value.size()));
+        uint32_t next = load32(page + PG_NEXT);
+        bufferManager.unpinPage(filePath, pageId, PageType::DATA, false);
+        pageId = next;
+    }
+    return value;
+}
+
+void OverflowFile::release(uint32_t firstPage) {
+    if (firstPage == 0) return;
+    std::lock_guard<std::mutex> guard(mtx);
+
+    // find the tail, then splice the whole chain onto the free list
+    uint32_t tail = firstPage;
+    for (;;) {
+        char* page = bufferManager.getPage(filePath, tail, PageType::DATA);
+        if (!page) return;
+        uint32_t next = load32(page + PG_NEXT);
+        bufferManager.unpinPage(filePath, tail, PageType::DATA, false);
+        if (next == 0) break;
+        tail = next;
+    }
+
+    char* header = bufferManager.getPage(filePath, 0, PageType::DATA);
+    if (!header) return;
+    char* page = bufferManager.getPage(filePath, tail, PageType::DATA);
+    if (!page) {
+        bufferManager.unpinPage(filePath, 0, PageType::DATA, false);
+        return;
+    }
+    store32(page + PG_NEXT, load32(header + HDR_FREE));
+    store32(header + HDR_FREE, firstPage);
+    bufferManager.unpinPage(filePath, tail, PageType::DATA, true);
+    bufferManager.unpinPage(filePath, 0, PageType::DATA, true);
+}
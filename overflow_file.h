@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include "BufferManager.h"
+
+/// overflow.dat: text values too long to keep in their row (see
+/// Schema::INLINE_LIMIT), each in a chain of pages of its own.
+///
+/// Page 0 is the header: u32 page count, u32 head of the free-page list.
+/// Every other page starts with the u32 next page of its chain (0 ends it)
+/// and the u16 bytes it holds, followed by the bytes.  The row keeps only
+/// the first page and the total length, so a value is read only when it is
+/// asked for, and a chain freed by a delete or update is reused by the
+/// next write.
+class OverflowFile {
+public:
+    static constexpr int PAGE_SIZE = 4096;
+    static constexpr int PAGE_HEADER = 6;                        // u32 next, u16 used
+    static constexpr int PAGE_CAPACITY = PAGE_SIZE - PAGE_HEADER;
+
+    /// tablePath: the table directory (e.g. "Tables/users")
+    OverflowFile(const std::string& tablePath, BufferManager& bm);
+
+    /// Store `value` in a new chain; returns its first page, or 0 if a page
+    /// could not be pinned.
+    uint32_t write(std::string_view value);
+
+    /// The `length` bytes of the chain starting at `firstPage`.
+    std::string read(uint32_t firstPage, uint32_t length);
+
+    /// Give every page of the chain back to the free list.
+    void release(uint32_t firstPage);
+
+private:
+    std::string    filePath;    // BufferManager file ID of overflow.dat
+    BufferManager& bufferManager;
+    std::mutex     mtx;         // the header and the free list
+
+    uint32_t allocatePage();    // caller holds mtx; 0 on failure
+};
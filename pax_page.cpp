@@ -0,0 +1,205 @@
+#include "pax_page.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+    // Header layout (byte offsets)
+    constexpr int HDR_CAPACITY = 0;   // 0 on a fresh (zero-filled) page: chosen by the first insert
+    constexpr int HDR_SLOTS = 2;
+    constexpr int HDR_START = 4;      // 0 means PAGE_SIZE
+    constexpr int HDR_LIVE = 6;
+
+    uint16_t load16(const char* p) {
+        uint16_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    void store16(char* p, int v) {
+        uint16_t u = static_cast<uint16_t>(v);
+        std::memcpy(p, &u, sizeof(u));
+    }
+
+    /// Heap bytes of a text entry with this length.
+    int heapLength(int length) {
+        return length == Schema::EXTERNAL ? static_cast<int>(sizeof(Schema::ExternalRef)) : length;
+    }
+}
+
+PaxPage::PaxPage(char* page, const std::vector<Schema::Field>& fields)
+    : page(page),
+    fields(fields),
+    fixedSize(fields.empty() ? 0 : fields.back().offset + Schema::fixedWidth(fields.back()))
+{
+}
+
+int PaxPage::capacity() const {
+    return load16(page + HDR_CAPACITY);
+}
+
+int PaxPage::slotCount() const {
+    return load16(page + HDR_SLOTS);
+}
+
+int PaxPage::textStart() const {
+    int start = load16(page + HDR_START);
+    return start == 0 ? PAGE_SIZE : start;
+}
+
+int PaxPage::liveText() const {
+    return load16(page + HDR_LIVE);
+}
+
+void PaxPage::setHeader(int capacity, int slots, int start, int live) {
+    store16(page + HDR_CAPACITY, capacity);
+    store16(page + HDR_SLOTS, slots);
+    store16(page + HDR_START, start == PAGE_SIZE ? 0 : start);
+    store16(page + HDR_LIVE, live);
+}
+
+int PaxPage::minipagesEnd() const {
+    return HEADER_SIZE + capacity() * (1 + fixedSize);
+}
+
+char* PaxPage::entry(const Schema::Field& f, int slot) const {
+    // the minipages before f's hold the widths of the fields before it: f.offset
+    const int cap = capacity();
+    return page + HEADER_SIZE + cap + cap * f.offset + slot * Schema::fixedWidth(f);
+}
+
+bool PaxPage::live(int slot) const {
+    return slot >= 0 && slot < slotCount() && page[HEADER_SIZE + slot] != 0;
+}
+
+int PaxPage::textBytes(int slot) const {
+    int bytes = 0;
+    for (const auto& f : fields) {
+        if (f.kind == Schema::Kind::Char) bytes += heapLength(load16(entry(f, slot) + 2));
+    }
+    return bytes;
+}
+
+int PaxPage::firstFreeSlot() const {
+    const int slots = slotCount();
+    const void* free = std::memchr(page + HEADER_SIZE, 0, slots);
+    return free ? static_cast<int>(static_cast<const char*>(free) - (page + HEADER_SIZE)) : slots;
+}
+
+std::string_view PaxPage::record(int slot, std::string& buf) const {
+    if (!live(slot)) return {};
+    buf.assign(fixedSize, '\0');
+    for (const auto& f : fields) {
+        const char* e = entry(f, slot);
+        if (f.kind != Schema::Kind::Char) {
+            std::memcpy(&buf[f.offset], e, f.length);
+            continue;
+        }
+        const int offset = load16(e), length = load16(e + 2);
+        store16(&buf[f.offset], static_cast<int>(buf.size()));
+        store16(&buf[f.offset + 2], length);
+        buf.append(page + offset, heapLength(length));
+    }
+    return buf;
+}
+
+std::string_view PaxPage::value(const Schema::Field& f, int slot) const {
+    const char* e = entry(f, slot);
+    if (f.kind != Schema::Kind::Char) return { e, static_cast<std::size_t>(f.length) };
+    return { page + load16(e), static_cast<std::size_t>(heapLength(load16(e + 2))) };
+}
+
+bool PaxPage::isExternal(const Schema::Field& f, int slot) const {
+    return f.kind == Schema::Kind::Char && load16(entry(f, slot) + 2) == Schema::EXTERNAL;
+}
+
+const char* PaxPage::column(const Schema::Field& f) const {
+    return entry(f, 0);
+}
+
+int PaxPage::freeSpace() const {
+    if (capacity() == 0) return MAX_RECORD_SIZE;
+    if (firstFreeSlot() >= capacity()) return 0;
+    return fixedSize + PAGE_SIZE - minipagesEnd() - liveText();
+}
+
+int PaxPage::insert(std::string_view rec) {
+    const int text = static_cast<int>(rec.size()) - fixedSize;
+    if (text < 0 || static_cast<int>(rec.size()) > freeSpace()) return -1;
+
+    if (capacity() == 0) {
+        const int cap = std::min((PAGE_SIZE - HEADER_SIZE) / (1 + fixedSize + text), PAGE_SIZE - 1);
+        setHeader(cap, 0, PAGE_SIZE, 0);
+    }
+    const int slot = firstFreeSlot();
+    if (textStart() - minipagesEnd() < text) compact();
+    place(slot, rec);
+    if (slot == slotCount()) setHeader(capacity(), slot + 1, textStart(), liveText());
+    return slot;
+}
+
+bool PaxPage::update(int slot, std::string_view rec) {
+    if (!live(slot)) return false;
+    const int text = static_cast<int>(rec.size()) - fixedSize;
+    const int live = liveText() - textBytes(slot);
+    if (text < 0 || text > PAGE_SIZE - minipagesEnd() - live) return false;
+
+    // Let the old text go, then place the record as insert() would, in the same slot.
+    page[HEADER_SIZE + slot] = 0;
+    setHeader(capacity(), slotCount(), textStart(), live);
+    if (textStart() - minipagesEnd() < text) compact();
+    place(slot, rec);
+    return true;
+}
+
+bool PaxPage::erase(int slot) {
+    if (!live(slot)) return false;
+    const int live = liveText() - textBytes(slot);
+    page[HEADER_SIZE + slot] = 0;
+    // trailing free slots leave the page; an empty page starts over
+    int slots = slotCount();
+    while (slots > 0 && page[HEADER_SIZE + slots - 1] == 0) --slots;
+    if (slots == 0) setHeader(0, 0, PAGE_SIZE, 0);
+    else setHeader(capacity(), slots, textStart(), live);
+    return true;
+}
+
+void PaxPage::compact() {
+    std::vector<char> copy(page, page + PAGE_SIZE);
+    const int slots = slotCount();
+    int start = PAGE_SIZE;
+    for (int s = 0; s < slots; ++s) {
+        if (!live(s)) continue;
+        for (const auto& f : fields) {
+            if (f.kind != Schema::Kind::Char) continue;
+            char* e = entry(f, s);
+            const int bytes = heapLength(load16(e + 2));
+            start -= bytes;
+            std::memcpy(page + start, copy.data() + load16(e), bytes);
+            store16(e, start);
+        }
+    }
+    setHeader(capacity(), slots, start, PAGE_SIZE - start);
+}
+
+void PaxPage::place(int slot, std::string_view rec) {
+    int start = textStart();
+    int live = liveText();
+    for (const auto& f : fields) {
+        char* e = entry(f, slot);
+        if (f.kind != Schema::Kind::Char) {
+            std::memcpy(e, rec.data() + f.offset, f.length);
+            continue;
+        }
+        const int offset = load16(rec.data() + f.offset), length = load16(rec.data() + f.offset + 2);
+        const int bytes = heapLength(length);
+        start -= bytes;
+        std::memcpy(page + start, rec.data() + offset, bytes);
+        store16(e, start);
+        store16(e + 2, length);
+        live += bytes;
+    }
+    page[HEADER_SIZE + slot] = 1;
+    setHeader(capacity(), slotCount(), start, live);
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "schema.h"
+
+/// A data.tbl page of a Pax table (see Schema::Storage), in PAX layout:
+///
+///   [header][live map][minipage 0][minipage 1] ... free ... [text][text]
+///
+/// Rows get slots 0 .. capacity-1, where the capacity is fixed when the
+/// page takes its first row.  The live map has a byte per slot, 1 for a
+/// live row.  Minipage i holds field i's fixed-part entry (see Schema) for
+/// every slot, one after another, so a scan of one column reads a dense
+/// array of it.  Text lives in a heap growing down from the end of the page,
+/// and a text entry's offset is into the page rather than into a record.
+///
+/// The capacity is chosen from the first row: as many rows of its size as
+/// the page holds.  Rows of about the same size then fill both the minipages
+/// and the text heap; a page runs out of one before the other otherwise.
+/// A page whose last row is erased forgets its capacity.
+///
+/// Records cross the page in the row format Schema::encodeRecord writes:
+/// insert() and update() split one into the minipages, record() puts one
+/// back together.  A record ID is pageId * PAGE_SIZE + slot, as for
+/// HeapPage, and a zero-filled page is an empty one.
+///
+/// PaxPage is a view over a pinned buffer; it owns nothing.
+class PaxPage {
+public:
+    static constexpr int PAGE_SIZE = 4096;
+    static constexpr int HEADER_SIZE = 8;   // u16 capacity, slot count, text start, live text bytes
+
+    /// The largest record a page holds: an empty page less one live byte.
+    static constexpr int MAX_RECORD_SIZE = PAGE_SIZE - HEADER_SIZE - 1;
+
+    /// fields: the table's, whose offsets give where each minipage starts.
+    PaxPage(char* page, const std::vector<Schema::Field>& fields);
+
+    /// Slots in use, live or free.
+    int slotCount() const;
+
+    /// True if `slot` holds a row.
+    bool live(int slot) const;
+
+    /// The record in `slot`, assembled in `buf`; empty if the slot is free.
+    std::string_view record(int slot, std::string& buf) const;
+
+    /// f's stored bytes in the live `slot`, as Schema::valueOf gives them
+    /// from a record, without copying.
+    std::string_view value(const Schema::Field& f, int slot) const;
+
+    /// True if f's value in the live `slot` is kept out of line.
+    bool isExternal(const Schema::Field& f, int slot) const;
+
+    /// f's minipage: its fixed-part entries for slots 0 .. slotCount()-1,
+    /// free ones included, Schema::fixedWidth(f) bytes apart.
+    const char* column(const Schema::Field& f) const;
+
+    /// The longest record insert() would take: 0 with no slot left.
+    int freeSpace() const;
+
+    /// Store `rec` in the first free slot, compacting the text heap if its
+    /// free bytes are scattered.  Returns the slot, or -1 if it does not fit.
+    int insert(std::string_view rec);
+
+    /// Replace the record in `slot`.  Returns false, leaving the page
+    /// unchanged, if the slot is free or the page cannot hold the new record.
+    bool update(int slot, std::string_view rec);
+
+    /// Free `slot`; its text comes back at the next compaction.  Returns
+    /// false if the slot was already free.
+    bool erase(int slot);
+
+    /// Move the live text together at the end of the page.
+    void compact();
+
+private:
+    char*                              page;
+    const std::vector<Schema::Field>&  fields;
+    int                                fixedSize;   // of a record, see Schema::getFixedSize
+
+    int   capacity() const;
+    int   textStart() const;                // start of the text heap
+    int   liveText() const;
+    void  setHeader(int capacity, int slots, int start, int live);
+    int   minipagesEnd() const;             // where free space starts
+    char* entry(const Schema::Field& f, int slot) const;
+    int   textBytes(int slot) const;        // heap bytes of a live slot
+    int   firstFreeSlot() const;            // slotCount() if none is free
+    void  place(int slot, std::string_view rec);   // room for its text is there
+};
@@ -1,4 +1,6 @@
 ﻿#include "record_manager.h"
+#include "table_handle.h"
+#include "heap_page.h"
 
 #include <fstream>
 #include <iostream>
@@ -6,6 +8,7 @@
 #include <vector>
 #include <cstring>
 #include <algorithm>
+#include <shared_mutex>
 
 namespace fs = std::filesystem;
 
@@ -13,46 +16,44 @@ namespace fs = std::filesystem;
 
 BufferManager* RecordManager::bufMgr = nullptr;
 void RecordManager::addRecord(const std::string& tableName) {
-    // 1) Load schema
-  
-    std::ifstream metaIn("Tables/" + tableName + "/meta.txt");
-    if (!metaIn) {
+    // 1) Open the table (schema, indexes, free-space map)
+    auto table = TableHandle::open(tableName, *bufMgr);
+    if (!table) {
         std::cerr << "[addRecord] No such table: " << tableName << "\n";
         return;
     }
-    std::string schemaStr, keysStr;
-    std::getline(metaIn, schemaStr);
-    std::getline(metaIn, keysStr);
-    Schema schema(schemaStr, keysStr);
-    const auto& fields = schema.getFields();
-    const auto& uniqueKeys = schema.getUniqueKeys();
+    std::shared_lock<std::shared_mutex> rowsLock(table->rowsMtx);
+    const auto& fields = table->fields;
+    const auto& uniqueKeys = table->uniqueKeys;
 
 
-    // 2) Read user data into a vector<string>
+    // 2) Read user data into a vector<string>, encoding each value as it
+    //    will be stored; the indexes get the values as they read back.
     std::vector<std::string> data(fields.size());
     for (size_t i = 0; i < fields.size(); ++i) {
         const auto& f = fields[i];
         std::cout << "Enter " << f.name << " (" << f.type << "): ";
         std::cin >> data[i];
-        if (f.type == "int") {
-            try {
-                std::stoi(data[i]);
-            }
-            catch (...) {
-                std::cerr << "[addRecord] Invalid integer for " << f.name << "\n";
-                return;
-            }
+        std::string bytes;
+        if (!Schema::encodeValue(f, data[i], bytes)) {
+            std::cerr << "[addRecord] Invalid " << f.type << " for " << f.name << "\n";
+            return;
         }
+        data[i] = Schema::decodeValue(f, bytes);
     }
 
 
     // 3) Duplicate-key check via IndexManager
-    IndexManager idxMgr(tableName, "Tables/" + tableName, *bufMgr);
-    idxMgr.loadIndexes(uniqueKeys);
+    IndexManager& idxMgr = table->indexes;
     for (size_t i = 0; i < fields.size(); ++i) {
         if (std::find(uniqueKeys.begin(), uniqueKeys.end(), fields[i].name)
             != uniqueKeys.end())
         {
+            if (!idxMgr.keyFits(fields[i].name, data[i])) {
+                std::cerr << "[addRecord] Key on " << fields[i].name << " is longer than "
+                    << BPlusTree::KEY_SIZE - 1 << " bytes\n";
+                return;
+            }
             if (idxMgr.existsInIndex(fields[i].name, data[i])) {
                 std::cerr << "[addRecord] Duplicate key on " << fields[i].name << "\n";
                 return;
@@ -60,93 +61,61 @@ void RecordManager::addRecord(const std::string& tableName) {
         }
     }
 
-    // 4) Compute payloadSize and slotWidth
-    const int PAGE_SIZE = 4096;
-    int payloadSize = 0;
-    for (auto& f : fields) {
-        payloadSize += f.length;
-    }
-    int slotWidth = 1 + payloadSize;  // 1 byte for isValid flag
-
-    // 5) Free-space manager (will read/write free_space.meta via buffer)
-    FreeSpaceManager fsm("Tables/" + tableName, payloadSize, *bufMgr);
-    fsm.load();
-    uint32_t pageId = fsm.getPageWithFreeSlot();
-
-    // 6) Pin the target data page via BufferManager
-    //    If the page does not yet exist on disk, BufferManager loads zero‐filled.
-
-    char* pageBuf = bufMgr->getPage(
-        "Tables/" + tableName + "/data.tbl",
-        pageId,
-        PageType::DATA
-    );
-    if (!pageBuf) {
-        std::cerr << "[addRecord] Cannot pin data page " << pageId << "\n";
+    // 4) Build the record; long text goes to the overflow file
+    std::string record;
+    if (!table->encode(data, record)) {
+        std::cerr << "[addRecord] Record is larger than a page\n";
         return;
     }
-    
 
-    // 6a) If this page was just created, ensure it is zero‐filled
-    //     BufferManager’s getPage already zero‐fills missing pages on disk.
+    // 5) Free-space manager (writes free_space.meta via buffer)
+    std::lock_guard<std::mutex> fsmLock(table->freeSpaceMtx);
+    FreeSpaceManager& fsm = table->freeSpace;
 
-    // 7) Find first free slot in that page’s buffer
-    int slotsPerPage = PAGE_SIZE / slotWidth;
-    int slotIdx = -1;
-    for (int i = 0; i < slotsPerPage; ++i) {
-        char flag = pageBuf[i * slotWidth];
-        if (flag == 0) {
-            slotIdx = i;
-            break;
+    // 6) Pin a data page with room and store the record in its next slot.
+    //    If the page does not yet exist on disk, BufferManager loads it
+    //    zero-filled, which is an empty page.
+    uint32_t pageId = 0;
+    int slot = -1;
+    while (slot < 0) {
+        pageId = fsm.getPageWithFreeSpace(static_cast<int>(record.size()));
+        char* pageBuf = bufMgr->getPage(
+            table->dataFile,
+            pageId,
+            PageType::DATA
+        );
+        if (!pageBuf) {
+            std::cerr << "[addRecord] Cannot pin data page " << pageId << "\n";
+            table->releaseExternal(record);
+            return;
         }
-    }
-    if (slotIdx < 0) {
-        std::cerr << "[addRecord] FSM inconsistency: no free slot on page "
-            << pageId << "\n";
+        DataPage page = table->page(pageBuf);
+        slot = page.insert(record);
+        if (slot < 0) {
+            std::cerr << "[addRecord] FSM inconsistency: page " << pageId
+                << " is fuller than recorded\n";
+        }
+
+        // 7) Record its zone, unpin the page (dirty => flushed later) and
+        //    record its free space, which itself calls save() via buffer
+        if (slot >= 0) table->zones.update(pageId, page);
         bufMgr->unpinPage(
-            "Tables/" + tableName + "/data.tbl",
+            table->dataFile,
             pageId,
             PageType::DATA,
-            /*isDirty=*/false
+            /*isDirty=*/slot >= 0
         );
-        return;
+        fsm.setFreeSpace(pageId, page.freeSpace());
     }
-    std::cout << "wrote record on rought" << std::endl;
-    // 8) Write record into the page buffer
-    long offset = static_cast<long>(pageId) * PAGE_SIZE + slotIdx * slotWidth;
-    // 8a) Set isValid = 1
-    pageBuf[slotIdx * slotWidth] = 1;
-
-    // 8b) Copy each field’s fixed‐length bytes
-    for (size_t i = 0; i < fields.size(); ++i) {
-        const auto& f = fields[i];
-        const auto& val = data[i];
-        // Destination address within pageBuf:
-        char* dest = pageBuf + slotIdx * slotWidth + 1  // skip valid flag
-            + static_cast<int>(i) * f.length;
-        // Zero out f.length bytes
-        std::memset(dest, 0, f.length);
-        // Copy up to f.length
-        std::memcpy(dest, val.c_str(), std::min<size_t>(val.size(), f.length));
-    }
-
-    // 9) Unpin page, marking dirty => will be flushed later
-    bufMgr->unpinPage(
-        "Tables/" + tableName + "/data.tbl",
-        pageId,
-        PageType::DATA,
-        /*isDirty=*/true
-    );
-
-    // 10) Update free‐space metadata (mark slot used) – this itself calls save() via buffer
-    fsm.markSlotUsed(pageId);
+    long offset = HeapPage::rid(pageId, slot);
 
-    // 11) Insert into each unique‐key index
+    // 8) Insert into each unique‐key index
     for (size_t i = 0; i < fields.size(); ++i) {
         if (std::find(uniqueKeys.begin(), uniqueKeys.end(), fields[i].name)
             != uniqueKeys.end())
         {
-            idxMgr.insertIntoIndex(fields[i].name, data[i], offset);
+            idxMgr.insertIntoIndex(fields[i].name, data[i], offset,
+                idxMgr.makePayload(fields[i].name, data));
         }
     }
     // No need to call idxMgr.saveIndexes(); writes happen as you insert
@@ -155,18 +124,15 @@ void RecordManager::addRecord(const std::string& tableName) {
 }
 
 void RecordManager::findRecord(const std::string& tableName) {
-    // 1) Load schema & unique keys
-    std::ifstream metaIn("Tables/" + tableName + "/meta.txt");
-    if (!metaIn) {
+    // 1) Open the table (schema, unique keys, indexes)
+    auto table = TableHandle::open(tableName, *bufMgr);
+    if (!table) {
         std::cout << "[findRecord] Table not found: " << tableName << "\n";
         return;
     }
-    std::string schemaStr, keysStr;
-    std::getline(metaIn, schemaStr);
-    std::getline(metaIn, keysStr);
-    Schema schema(schemaStr, keysStr);
-    const auto& fields = schema.getFields();
-    const auto& uniqueKeys = schema.getUniqueKeys();
+    std::shared_lock<std::shared_mutex> rowsLock(table->rowsMtx);
+    const auto& fields = table->fields;
+    const auto& uniqueKeys = table->uniqueKeys;
 
     // 2) Get user query "field=value"
     std::cout << "Enter query (field=value): ";
@@ -200,10 +166,10 @@ void RecordManager::findRecord(const std::string& tableName) {
         std::cout << "[findRecord] Field not in schema: " << field << "\n";
         return;
     }
+    value = table->keyOf(field, value);  // as stored, e.g. "007" -> "7"
 
-    // 4) Prepare IndexManager
-    IndexManager idxMgr(tableName, "Tables/" + tableName, *bufMgr);
-    idxMgr.loadIndexes(uniqueKeys);
+    // 4) The table's open indexes
+    IndexManager& idxMgr = table->indexes;
 
     if (isUnique) {
         // 5a) Use B+ Tree to find exact offset
@@ -213,10 +179,9 @@ void RecordManager::findRecord(const std::string& tableName) {
             return;
         }
         // 5b) Pin the page via buffer
-        const int PAGE_SIZE = 4096;
-        long pageId = off / PAGE_SIZE;
+        long pageId = HeapPage::pageOf(off);
         char* pageBuf = bufMgr->getPage(
-            "Tables/" + tableName + "/data.tbl",
+            table->dataFile,
             static_cast<uint32_t>(pageId),
             PageType::DATA
         );
@@ -224,16 +189,13 @@ void RecordManager::findRecord(const std::string& tableName) {
             std::cerr << "[findRecord] Cannot pin data page " << pageId << "\n";
             return;
         }
-        int slotWidth = 1;
-        for (auto& f : fields) slotWidth += f.length;
-        int slotIdx = static_cast<int>((off % PAGE_SIZE) / slotWidth);
-
-        // 5c) Check valid flag
-        char valid = pageBuf[slotIdx * slotWidth];
-        if (valid == 0) {
+        // 5c) Check the slot still holds a record
+        std::string assembled;
+        std::string_view rec = table->page(pageBuf).record(HeapPage::slotOf(off), assembled);
+        if (rec.empty()) {
             std::cout << "[findRecord] Record was deleted.\n";
             bufMgr->unpinPage(
-                "Tables/" + tableName + "/data.tbl",
+                table->dataFile,
                 static_cast<uint32_t>(pageId),
                 PageType::DATA,
                 /*isDirty=*/false
@@ -242,17 +204,13 @@ void RecordManager::findRecord(const std::string& tableName) {
         }
         // 5d) Print fields
         std::cout << "[findRecord] Found at offset " << off << ": ";
-        int base = slotIdx * slotWidth + 1; // skip valid flag
-        for (size_t i = 0; i < fields.size(); ++i) {
-            const auto& f = fields[i];
-            std::string val(pageBuf + base + i * f.length,
-                strnlen(pageBuf + base + i * f.length, f.length));
-            std::cout << f.name << ": " << val << "  ";
+        for (const auto& f : fields) {
+            std::cout << f.name << ": " << table->valueText(f, rec) << "  ";
         }
         std::cout << "\n";
 
         bufMgr->unpinPage(
-            "Tables/" + tableName + "/data.tbl",
+            table->dataFile,
             static_cast<uint32_t>(pageId),
             PageType::DATA,
             /*isDirty=*/false
@@ -261,11 +219,11 @@ void RecordManager::findRecord(const std::string& tableName) {
     else {
         // 5e) Linear scan all pages
         std::cout << "[findRecord] Scanning all records...\n";
-        const int PAGE_SIZE = 4096;
+        const int PAGE_SIZE = HeapPage::PAGE_SIZE;
         // Pin page 0 to find how many pages exist on disk:
         uint32_t pageNo = 0;
         // Instead of fstream, ask bufferMgr about file size:
-        std::ifstream dataProbe("Tables/" + tableName + "/data.tbl", std::ios::binary | std::ios::ate);
+        std::ifstream dataProbe(table->dataFile, std::ios::binary | std::ios::ate);
         if (!dataProbe) {
             std::cout << "[findRecord] Data file missing.\n";
             return;
@@ -273,12 +231,10 @@ void RecordManager::findRecord(const std::string& tableName) {
         long fileSize = dataProbe.tellg();
         dataProbe.close();
         size_t totalPages = static_cast<size_t>((fileSize + PAGE_SIZE - 1) / PAGE_SIZE);
-        int slotWidth = 1;
-        for (auto& f : fields) slotWidth += f.length;
 
         for (size_t pid = 0; pid < totalPages; ++pid) {
             char* pageBuf = bufMgr->getPage(
-                "Tables/" + tableName + "/data.tbl",
+                table->dataFile,
                 static_cast<uint32_t>(pid),
                 PageType::DATA
             );
@@ -286,29 +242,23 @@ void RecordManager::findRecord(const std::string& tableName) {
                 std::cerr << "[findRecord] Cannot pin data page " << pid << "\n";
                 continue;
             }
-            int slotsPerPage = PAGE_SIZE / slotWidth;
-            for (int s = 0; s < slotsPerPage; ++s) {
-                char valid = pageBuf[s * slotWidth];
-                if (valid == 0) continue;
+            DataPage page = table->page(pageBuf);
+            std::string assembled;
+            for (int s = 0; s < page.slotCount(); ++s) {
+                std::string_view rec = page.record(s, assembled);
+                if (rec.empty()) continue;
                 // Read field at idx
-                std::string val(pageBuf + s * slotWidth + 1 + idx * fields[idx].length,
-                    strnlen(pageBuf + s * slotWidth + 1 + idx * fields[idx].length,
-                        fields[idx].length));
-                if (val == value) {
+                if (table->valueText(fields[idx], rec) == value) {
                     // Print entire record
                     std::cout << "[Page " << pid << " | Slot " << s << "] ";
-                    for (size_t i = 0; i < fields.size(); ++i) {
-                        const auto& f = fields[i];
-                        std::string v(pageBuf + s * slotWidth + 1 + i * f.length,
-                            strnlen(pageBuf + s * slotWidth + 1 + i * f.length,
-                                f.length));
-                        std::cout << f.name << ": " << v << "  ";
+                    for (const auto& f : fields) {
+                        std::cout << f.name << ": " << table->valueText(f, rec) << "  ";
                     }
                     std::cout << "\n";
                 }
             }
             bufMgr->unpinPage(
-                "Tables/" + tableName + "/data.tbl",
+                table->dataFile,
                 static_cast<uint32_t>(pid),
                 PageType::DATA,
                 /*isDirty=*/false
@@ -318,18 +268,14 @@ void RecordManager::findRecord(const std::string& tableName) {
 }
 
 void RecordManager::deleteRecord(const std::string& tableName) {
-    // 1) Load schema & unique keys
-    std::ifstream metaIn("Tables/" + tableName + "/meta.txt");
-    if (!metaIn) {
+    // 1) Open the table (schema, unique keys, indexes)
+    auto table = TableHandle::open(tableName, *bufMgr);
+    if (!table) {
         std::cerr << "[deleteRecord] Table not found: " << tableName << "\n";
         return;
     }
-    std::string schemaStr, keysStr;
-    std::getline(metaIn, schemaStr);
-    std::getline(metaIn, keysStr);
-    Schema schema(schemaStr, keysStr);
-    const auto& fields = schema.getFields();
-    const auto& uniqueKeys = schema.getUniqueKeys();
+    std::shared_lock<std::shared_mutex> rowsLock(table->rowsMtx);
+    const auto& uniqueKeys = table->uniqueKeys;
 
     // 2) Parse user input "field=value"
     std::cout << "Enter delete query (field=value): ";
@@ -355,8 +301,8 @@ void RecordManager::deleteRecord(const std::string& tableName) {
     }
 
     // 4) Locate record offset via IndexManager
-    IndexManager idxMgr(tableName, "Tables/" + tableName, *bufMgr);
-    idxMgr.loadIndexes(uniqueKeys);
+    IndexManager& idxMgr = table->indexes;
+    value = table->keyOf(field, value);
     long offset = idxMgr.searchIndex(field, value);
     if (offset < 0) {
         std::cout << "[deleteRecord] Record not found.\n";
@@ -367,11 +313,12 @@ void RecordManager::deleteRecord(const std::string& tableName) {
     idxMgr.removeFromIndex(field, value);
     // (flush happens when buffer evicts if needed)
 
-    // 6) Pin the data page, check validity
-    const int PAGE_SIZE = 4096;
-    long pageId = offset / PAGE_SIZE;
+    // 6) Pin the data page, check the slot still holds a record.  Pages
+    //    change under the FSM lock.
+    std::lock_guard<std::mutex> fsmLock(table->freeSpaceMtx);
+    long pageId = HeapPage::pageOf(offset);
     char* pageBuf = bufMgr->getPage(
-        "Tables/" + tableName + "/data.tbl",
+        table->dataFile,
         static_cast<uint32_t>(pageId),
         PageType::DATA
     );
@@ -379,15 +326,13 @@ void RecordManager::deleteRecord(const std::string& tableName) {
         std::cerr << "[deleteRecord] Cannot pin data page " << pageId << "\n";
         return;
     }
-    int slotWidth = 1;
-    for (auto& f : fields) slotWidth += f.length;
-    int slotIdx = static_cast<int>((offset % PAGE_SIZE) / slotWidth);
-
-    char valid = pageBuf[slotIdx * slotWidth];
-    if (valid == 0) {
+    DataPage page = table->page(pageBuf);
+    std::string assembled;
+    table->releaseExternal(page.record(HeapPage::slotOf(offset), assembled));
+    if (!page.erase(HeapPage::slotOf(offset))) {
         std::cout << "[deleteRecord] Record already deleted.\n";
         bufMgr->unpinPage(
-            "Tables/" + tableName + "/data.tbl",
+            table->dataFile,
             static_cast<uint32_t>(pageId),
             PageType::DATA,
             /*isDirty=*/false
@@ -395,46 +340,35 @@ void RecordManager::deleteRecord(const std::string& tableName) {
         return;
     }
 
-    // 7) Mark isValid → 0 in buffer
-    pageBuf[slotIdx * slotWidth] = 0;
+    // 7) The slot is freed in the buffer; the page's zone shrinks to the
+    //    rows left.  Unpin dirty
+    table->zones.update(static_cast<uint32_t>(pageId), page);
     bufMgr->unpinPage(
-        "Tables/" + tableName + "/data.tbl",
+        table->dataFile,
         static_cast<uint32_t>(pageId),
         PageType::DATA,
         /*isDirty=*/true
     );
 
-    // 8) Update free-space metadata (mark slot free)
-    int recordSize = 1;
-    for (auto& f : fields) recordSize += f.length;
-    FreeSpaceManager fsm("Tables/" + tableName, recordSize, *bufMgr);
-    fsm.load();
-    fsm.markSlotFree(static_cast<uint32_t>(pageId));
+    // 8) Update free-space metadata
+    table->freeSpace.setFreeSpace(static_cast<uint32_t>(pageId), page.freeSpace());
 
     std::cout << "[deleteRecord] Record deleted successfully.\n";
 }
 
 void RecordManager::printAllRecords(const std::string& tableName) {
-    // 1) Load schema
-    std::ifstream metaIn("Tables/" + tableName + "/meta.txt");
-    if (!metaIn) {
+    // 1) Open the table
+    auto table = TableHandle::open(tableName, *bufMgr);
+    if (!table) {
         std::cerr << "[printAllRecords] Table not found: " << tableName << "\n";
         return;
     }
-    std::string schemaStr, keysStr;
-    std::getline(metaIn, schemaStr);
-    std::getline(metaIn, keysStr);
-    Schema schema(schemaStr, keysStr);
-    const auto& fields = schema.getFields();
-
-    // 2) Compute payload and slot widths
-    const int PAGE_SIZE = 4096;
-    int payloadSize = 0;
-    for (auto& f : fields) payloadSize += f.length;
-    int slotWidth = 1 + payloadSize;
+    std::shared_lock<std::shared_mutex> rowsLock(table->rowsMtx);
+    const auto& fields = table->fields;
 
-    // 3) Find how many pages exist on disk
-    std::ifstream dataProbe("Tables/" + tableName + "/data.tbl",
+    // 2) Find how many pages exist on disk
+    const int PAGE_SIZE = HeapPage::PAGE_SIZE;
+    std::ifstream dataProbe(table->dataFile,
         std::ios::binary | std::ios::ate);
     if (!dataProbe) {
         std::cerr << "[printAllRecords] Cannot open data.tbl\n";
@@ -444,10 +378,10 @@ void RecordManager::printAllRecords(const std::string& tableName) {
     dataProbe.close();
     size_t totalPages = static_cast<size_t>((fileSize + PAGE_SIZE - 1) / PAGE_SIZE);
 
-    // 4) For each page, pin via buffer and iterate slots
+    // 3) For each page, pin via buffer and iterate slots
     for (size_t pid = 0; pid < totalPages; ++pid) {
         char* pageBuf = bufMgr->getPage(
-            "Tables/" + tableName + "/data.tbl",
+            table->dataFile,
             static_cast<uint32_t>(pid),
             PageType::DATA
         );
@@ -456,24 +390,21 @@ void RecordManager::printAllRecords(const std::string& tableName) {
             continue;
         }
 
-        int slotsPerPage = PAGE_SIZE / slotWidth;
-        for (int s = 0; s < slotsPerPage; ++s) {
-            char valid = pageBuf[s * slotWidth];
-            if (valid == 0) continue;
+        DataPage page = table->page(pageBuf);
+        std::string assembled;
+        for (int s = 0; s < page.slotCount(); ++s) {
+            std::string_view rec = page.record(s, assembled);
+            if (rec.empty()) continue;
 
             std::cout << "[Page " << pid << " | Slot " << s << "] ";
-            int base = s * slotWidth + 1;
-            for (size_t i = 0; i < fields.size(); ++i) {
-                const auto& f = fields[i];
-                std::string val(pageBuf + base + i * f.length,
-                    strnlen(pageBuf + base + i * f.length, f.length));
-                std::cout << f.name << ": " << val << "  ";
+            for (const auto& f : fields) {
+                std::cout << f.name << ": " << table->valueText(f, rec) << "  ";
             }
             std::cout << "\n";
         }
 
         bufMgr->unpinPage(
-            "Tables/" + tableName + "/data.tbl",
+            table->dataFile,
             static_cast<uint32_t>(pid),
             PageType::DATA,
             /*isDirty=*/false
@@ -485,12 +416,9 @@ void RecordManager::printAllRecords(const std::string& tableName) {
     const std::vector<Schema::Field>& fields,
     long offset)
 {
-    const int PAGE_SIZE = 4096;
-    long pageId = offset / PAGE_SIZE;
-    int recordSize = 1;
-    for (auto& f : fields) recordSize += f.length;
-    int slotWidth = recordSize;
-    int slotIdx = static_cast<int>((offset % PAGE_SIZE) / slotWidth);
+    auto table = TableHandle::open(tableName, *bufMgr);
+    if (!table) return;
+    long pageId = HeapPage::pageOf(offset);
 
     char* pageBuf = bufMgr->getPage(
         "Tables/" + tableName + "/data.tbl",
@@ -499,8 +427,9 @@ void RecordManager::printAllRecords(const std::string& tableName) {
     );
     if (!pageBuf) return;
 
-    char valid = pageBuf[slotIdx * slotWidth];
-    if (!valid) {
+    std::string assembled;
+    std::string_view rec = table->page(pageBuf).record(HeapPage::slotOf(offset), assembled);
+    if (rec.empty()) {
         bufMgr->unpinPage(
             "Tables/" + tableName + "/data.tbl",
             static_cast<uint32_t>(pageId),
@@ -510,12 +439,8 @@ void RecordManager::printAllRecords(const std::string& tableName) {
         return;
     }
 
-    int base = slotIdx * slotWidth + 1;
-    for (size_t i = 0; i < fields.size(); ++i) {
-        const auto& f = fields[i];
-        std::string val(pageBuf + base + i * f.length,
-            strnlen(pageBuf + base + i * f.length, f.length));
-        std::cout << f.name << ": " << val << "  ";
+    for (const auto& f : fields) {
+        std::cout << f.name << ": " << table->valueText(f, rec) << "  ";
     }
     std::cout << "\n";
 
@@ -528,15 +453,12 @@ void RecordManager::printAllRecords(const std::string& tableName) {
 }
 
 void RecordManager::getGreaterEqual(const std::string& tableName) {
-    // 1) Load schema & unique keys
-    std::ifstream metaIn("Tables/" + tableName + "/meta.txt");
-    if (!metaIn) { std::cerr << "[getGreaterEqual] Table not found\n"; return; }
-    std::string schemaStr, keysStr;
-    std::getline(metaIn, schemaStr);
-    std::getline(metaIn, keysStr);
-    Schema schema(schemaStr, keysStr);
-    const auto& fields = schema.getFields();
-    const auto& uniqueKeys = schema.getUniqueKeys();
+    // 1) Open the table (schema, unique keys, indexes)
+    auto table = TableHandle::open(tableName, *bufMgr);
+    if (!table) { std::cerr << "[getGreaterEqual] Table not found\n"; return; }
+    std::shared_lock<std::shared_mutex> rowsLock(table->rowsMtx);
+    const auto& fields = table->fields;
+    const auto& uniqueKeys = table->uniqueKeys;
 
     // 2) Get user input "field=value"
     std::cout << "Enter field>=value (e.g. id=123): ";
@@ -558,9 +480,8 @@ void RecordManager::getGreaterEqual(const std::string& tableName) {
     }
 
     // 4) Use IndexManager to get offsets
-    IndexManager idxMgr(tableName, "Tables/" + tableName, *bufMgr);
-    idxMgr.loadIndexes(uniqueKeys);
-    std::vector<long> offsets = idxMgr.searchGreaterEqual(field, value);
+    IndexManager& idxMgr = table->indexes;
+    std::vector<long> offsets = idxMgr.searchGreaterEqual(field, table->keyOf(field, value));
     if (offsets.empty()) {
         std::cout << "[getGreaterEqual] No matching records\n";
         return;
@@ -573,15 +494,12 @@ void RecordManager::getGreaterEqual(const std::string& tableName) {
 }
 
 void RecordManager::getLessEqual(const std::string& tableName) {
-    // 1) Load schema & unique keys
-    std::ifstream metaIn("Tables/" + tableName + "/meta.txt");
-    if (!metaIn) { std::cerr << "[getLessEqual] Table not found\n"; return; }
-    std::string schemaStr, keysStr;
-    std::getline(metaIn, schemaStr);
-    std::getline(metaIn, keysStr);
-    Schema schema(schemaStr, keysStr);
-    const auto& fields = schema.getFields();
-    const auto& uniqueKeys = schema.getUniqueKeys();
+    // 1) Open the table (schema, unique keys, indexes)
+    auto table = TableHandle::open(tableName, *bufMgr);
+    if (!table) { std::cerr << "[getLessEqual] Table not found\n"; return; }
+    std::shared_lock<std::shared_mutex> rowsLock(table->rowsMtx);
+    const auto& fields = table->fields;
+    const auto& uniqueKeys = table->uniqueKeys;
 
     // 2) Get user input "field=value"
     std::cout << "Enter field<=value (e.g. id=456): ";
@@ -603,9 +521,8 @@ void RecordManager::getLessEqual(const std::string& tableName) {
     }
 
     // 4) Use IndexManager to get offsets
-    IndexManager idxMgr(tableName, "Tables/" + tableName, *bufMgr);
-    idxMgr.loadIndexes(uniqueKeys);
-    std::vector<long> offsets = idxMgr.searchLessEqual(field, value);
+    IndexManager& idxMgr = table->indexes;
+    std::vector<long> offsets = idxMgr.searchLessEqual(field, table->keyOf(field, value));
     if (offsets.empty()) {
         std::cout << "[getLessEqual] No matching records\n";
         return;
@@ -618,15 +535,12 @@ void RecordManager::getLessEqual(const std::string& tableName) {
 }
 
 void RecordManager::getBetween(const std::string& tableName) {
-    // 1) Load schema & unique keys
-    std::ifstream metaIn("Tables/" + tableName + "/meta.txt");
-    if (!metaIn) { std::cerr << "[getBetween] Table not found\n"; return; }
-    std::string schemaStr, keysStr;
-    std::getline(metaIn, schemaStr);
-    std::getline(metaIn, keysStr);
-    Schema schema(schemaStr, keysStr);
-    const auto& fields = schema.getFields();
-    const auto& uniqueKeys = schema.getUniqueKeys();
+    // 1) Open the table (schema, unique keys, indexes)
+    auto table = TableHandle::open(tableName, *bufMgr);
+    if (!table) { std::cerr << "[getBetween] Table not found\n"; return; }
+    std::shared_lock<std::shared_mutex> rowsLock(table->rowsMtx);
+    const auto& fields = table->fields;
+    const auto& uniqueKeys = table->uniqueKeys;
 
     // 2) Get user input "field=low:high"
     std::cout << "Enter field=low:high (e.g. id=100:200): ";
@@ -653,9 +567,9 @@ void RecordManager::getBetween(const std::string& tableName) {
     }
 
     // 4) Use IndexManager to get offsets
-    IndexManager idxMgr(tableName, "Tables/" + tableName, *bufMgr);
-    idxMgr.loadIndexes(uniqueKeys);
-    std::vector<long> offsets = idxMgr.searchBetween(field, lowVal, highVal);
+    IndexManager& idxMgr = table->indexes;
+    std::vector<long> offsets = idxMgr.searchBetween(field,
+        table->keyOf(field, lowVal), table->keyOf(field, highVal));
     if (offsets.empty()) {
         std::cout << "[getBetween] No matching records\n";
         return;
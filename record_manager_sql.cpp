@@ -1,159 +1,529 @@
 ﻿// File: record_manager_sqlin.cpp
 #include "record_manager_sql.h"
 #include "record_manager.h"
-#include "schema.h"
-#include "index_manager.h"
-#include "free_space_manager.h"
+#include "table_handle.h"
+#include "heap_page.h"
 
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
 #include <optional>
+#include <shared_mutex>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
 
-/// Helper to read a single row at byte‐offset off.
+namespace {
+
+    std::shared_ptr<TableHandle> openTable(const std::string& tableName) {
+        return TableHandle::open(tableName, *RecordManager::bufMgr);
+    }
+
+    /// Each of `values` as the index of `fieldName` holds it.
+    std::vector<std::string> keysOf(const TableHandle& table, const std::string& fieldName,
+        const std::vector<std::string>& values)
+    {
+        std::vector<std::string> keys;
+        keys.reserve(values.size());
+        for (const auto& v : values) keys.push_back(table.keyOf(fieldName, v));
+        return keys;
+    }
+
+    /// Batches at least this large update their indexes on one thread each.
+    constexpr size_t PARALLEL_INDEX_ROWS = 4096;
+
+    /// COPY reads its file in blocks of this many bytes.
+    constexpr size_t COPY_BLOCK = 16 << 20;
+
+    /// The fields of one CSV line.  A field in double quotes may hold commas
+    /// and "" for a quote; the quotes themselves are dropped.
+    Row parseCsvLine(std::string_view line) {
+        Row row;
+        std::string field;
+        bool quoted = false;
+        for (size_t i = 0; i <= line.size(); ++i) {
+            if (i == line.size() || (!quoted && line[i] == ',')) {
+                row.push_back(std::move(field));
+                field.clear();
+            }
+            else if (line[i] != '"') {
+                field += line[i];
+            }
+            else if (quoted && i + 1 < line.size() && line[i + 1] == '"') {
+                field += '"';
+                ++i;
+            }
+            else {
+                quoted = !quoted;
+            }
+        }
+        return row;
+    }
+
+    /// A row per non-empty line of `text`, in order, parsed on up to
+    /// `threads` threads: the text is cut at line ends, one piece each.
+    Rows parseCsv(std::string_view text, unsigned threads) {
+        std::vector<std::string_view> pieces;
+        size_t start = 0;
+        for (unsigned t = 0; t < threads && start < text.size(); ++t) {
+            size_t end = start + (text.size() - start) / (threads - t);
+            end = text.find('\n', end);
+            end = end == std::string_view::npos ? text.size() : end + 1;
+            pieces.push_back(text.substr(start, end - start));
+            start = end;
+        }
+
+        std::vector<Rows> parsed(pieces.size());
+        auto parse = [&](size_t p) {
+            std::string_view piece = pieces[p];
+            while (!piece.empty()) {
+                size_t eol = piece.find('\n');
+                std::string_view line = piece.substr(0, eol);
+                piece.remove_prefix(eol == std::string_view::npos ? piece.size() : eol + 1);
+                if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+                if (!line.empty()) parsed[p].push_back(parseCsvLine(line));
+            }
+        };
+        std::vector<std::thread> workers;
+        for (size_t p = 1; p < pieces.size(); ++p) workers.emplace_back(parse, p);
+        if (!pieces.empty()) parse(0);
+        for (auto& w : workers) w.join();
+
+        Rows rows;
+        for (auto& part : parsed) {
+            rows.insert(rows.end(), std::make_move_iterator(part.begin()),
+                std::make_move_iterator(part.end()));
+        }
+        return rows;
+    }
+}
+
+/// Helper to read the single row with record ID rid.
 static std::optional<Row> fetchRowAtOffset(
-    const std::string& tableName,
-    const std::vector<Schema::Field>& fields,
-    long offset
+    TableHandle& table,
+    long rid,
+    const ColumnMask& needed = {}
 ) {
-    const int PAGE_SIZE = 4096;
-    int recordSize = 1; // isValid flag
-    for (auto& f : fields) recordSize += f.length;
-
     // Pin page
-    uint32_t pageId = offset / PAGE_SIZE;
+    uint32_t pageId = HeapPage::pageOf(rid);
     char* buf = RecordManager::bufMgr->getPage(
-        "Tables/" + tableName + "/data.tbl",
+        table.dataFile,
         pageId, PageType::DATA
     );
     if (!buf) return std::nullopt;
 
-    int slotIdx = (offset % PAGE_SIZE) / recordSize;
-    char valid = buf[slotIdx * recordSize];
-    if (!valid) {
-        RecordManager::bufMgr->unpinPage(
-            "Tables/" + tableName + "/data.tbl", pageId,
-            PageType::DATA, false
-        );
-        return std::nullopt;
-    }
-
-    Row row; row.reserve(fields.size());
-    int base = slotIdx * recordSize + 1;
-    for (auto& f : fields) {
-        std::string val(buf + base, strnlen(buf + base, f.length));
-        row.push_back(std::move(val));
-        base += f.length;
+    std::optional<Row> row;
+    DataPage page = table.page(buf);
+    if (page.live(HeapPage::slotOf(rid))) {
+        row.emplace();
+        table.decode(page, HeapPage::slotOf(rid), *row, needed);
     }
 
     RecordManager::bufMgr->unpinPage(
-        "Tables/" + tableName + "/data.tbl", pageId,
+        table.dataFile, pageId,
         PageType::DATA, false
     );
     return row;
 }
 
+namespace {
+
+    /// Pages of data.tbl, as the free-space map counts them: pages not yet
+    /// flushed are in, pages VACUUM cut off the end are out.
+    size_t pageCount(TableHandle& table) {
+        std::lock_guard<std::mutex> fsmLock(table.freeSpaceMtx);
+        return table.freeSpace.pageCount();
+    }
+
+    /// Every row of data.tbl, or those a filter keeps.  The filter sees a
+    /// whole page and gives back its selection vector, the live slots that
+    /// pass, so a comparison FilterKernel handles runs over the page at once.
+    /// A page the skip test rules out (from its zone, see ZoneMap) is not
+    /// pinned at all.
+    /// A page is decoded whole, in one pin, and unpinned before its rows are
+    /// handed out; only the needed columns are read, so on a Pax table the
+    /// other minipages are never touched.  The page's rows are decoded into
+    /// buffers kept from page to page, and next() swaps the caller's row with
+    /// one of them, so a caller that reads into the same Row makes the scan
+    /// stop allocating once the buffers have grown.  An open cursor holds
+    /// the table's rowsMtx shared, so VACUUM moves no row under it.
+    class HeapCursor : public RowCursor {
+    public:
+        using Filter = std::function<void(const DataPage& page, std::vector<uint16_t>& sel)>;
+        using Skip = std::function<bool(uint32_t pageId)>;
+
+        HeapCursor(std::shared_ptr<TableHandle> table, const ColumnMask& needed, Filter filter,
+            Skip skip = nullptr)
+            : table(std::move(table)), needed(needed), filter(std::move(filter)),
+            skip(std::move(skip))
+        {
+            if (this->table) {
+                rowsLock = std::shared_lock<std::shared_mutex>(this->table->rowsMtx);
+                totalPages = pageCount(*this->table);
+            }
+        }
+
+        bool next(Row& row) override {
+            while (pos == filled) {
+                if (!table || page >= totalPages) return false;
+                const uint32_t pid = static_cast<uint32_t>(page++);
+                if (!skip || !skip(pid)) loadPage(pid);
+            }
+            row.swap(batch[pos++]);
+            return true;
+        }
+
+        void close() override {
+            batch.clear();
+            filled = pos = 0;
+            if (rowsLock) rowsLock.unlock();
+            table.reset();
+        }
+
+    private:
+        std::shared_ptr<TableHandle> table;
+        std::shared_lock<std::shared_mutex> rowsLock;
+        ColumnMask                   needed;
+        Filter                       filter;
+        Skip                         skip;
+        size_t                       totalPages = 0;
+        size_t                       page = 0;   // next page to load
+        Rows                         batch;      // row buffers; the first `filled` hold the last page
+        size_t                       filled = 0;
+        size_t                       pos = 0;
+        std::vector<uint16_t>        sel;        // slots of the last page to decode
+
+        void loadPage(uint32_t pid) {
+            filled = pos = 0;
+            char* buf = RecordManager::bufMgr->getPage(table->dataFile, pid, PageType::DATA);
+            if (!buf) return;
+            DataPage data = table->page(buf);
+            if (filter) {
+                filter(data, sel);
+            }
+            else {
+                sel.clear();
+                for (int s = 0; s < data.slotCount(); ++s) {
+                    if (data.live(s)) sel.push_back(static_cast<uint16_t>(s));
+                }
+            }
+            for (uint16_t s : sel) {
+                if (filled == batch.size()) batch.emplace_back();
+                table->decode(data, s, batch[filled++], needed);
+            }
+            RecordManager::bufMgr->unpinPage(table->dataFile, pid, PageType::DATA, false);
+        }
+    };
+
+    /// The rows of a key range, in key order or reversed, read from the index
+    /// RANGE_BATCH entries at a time.  Each batch resumes at the last key of
+    /// the one before, which it skips: keys are unique.  Like HeapCursor it
+    /// holds the table's rowsMtx shared while open.
+    class RangeCursor : public RowCursor {
+    public:
+        static constexpr size_t RANGE_BATCH = 256;
+
+        RangeCursor(std::shared_ptr<TableHandle> table, const std::string& field,
+            const std::string& low, const std::string& high,
+            bool descending, size_t limit, const ColumnMask& needed)
+            : table(std::move(table)), field(field), low(low), high(high),
+            descending(descending), remaining(limit), limited(limit > 0), needed(needed)
+        {
+            if (this->table) rowsLock = std::shared_lock<std::shared_mutex>(this->table->rowsMtx);
+        }
+
+        bool next(Row& row) override {
+            while (pos == batch.size()) {
+                if (!refill()) return false;
+            }
+            row = std::move(batch[pos++]);
+            return true;
+        }
+
+        void close() override {
+            batch.clear();
+            pos = 0;
+            if (rowsLock) rowsLock.unlock();
+            table.reset();
+        }
+
+    private:
+        std::shared_ptr<TableHandle> table;
+        std::shared_lock<std::shared_mutex> rowsLock;
+        std::string                  field, low, high;
+        bool                         descending;
+        size_t                       remaining;  // entries still to walk if limited
+        bool                         limited;
+        ColumnMask                   needed;
+        bool                         resumed = false;  // a batch was read: skip its last key
+        bool                         done = false;
+        Rows                         batch;
+        size_t                       pos = 0;
+
+        bool refill() {
+            batch.clear();
+            pos = 0;
+            if (!table || done) return false;
+            size_t want = RANGE_BATCH + (resumed ? 1 : 0);
+            if (limited) want = std::min(want, remaining + (resumed ? 1 : 0));
+            auto entries = table->indexes.searchBetweenCovering(field, low, high, descending, want);
+            if (entries.size() < want) done = true;
+
+            size_t i = resumed && !entries.empty()
+                && entries.front().key == (descending ? high : low) ? 1 : 0;
+            for (; i < entries.size(); ++i) {
+                if (limited && remaining-- == 0) {
+                    done = true;
+                    break;
+                }
+                auto r = fetchRowAtOffset(*table, entries[i].offset, needed);
+                if (r) batch.push_back(std::move(*r));
+            }
+            if (limited && remaining == 0) done = true;
+            if (!entries.empty()) {
+                // an empty bound means open, so an empty key cannot be resumed
+                // from; it is the lowest key, so only a walk down (which is
+                // over) or a short batch (also over) ends on it
+                const std::string& last = entries.back().key;
+                if (last.empty()) done = true;
+                (descending ? high : low) = last;
+                resumed = true;
+            }
+            return !batch.empty() || !done;
+        }
+    };
+
+    Rows drain(RowCursor& cursor) {
+        Rows out;
+        Row row;
+        while (cursor.next(row)) out.push_back(std::move(row));
+        cursor.close();
+        return out;
+    }
+}
+
 long RecordManagerSQL::insertRecord(
     const std::string& tableName,
     const std::vector<std::string>& data
 ) {
-    // Load schema
-    std::ifstream meta("Tables/" + tableName + "/meta.txt");
-    if (!meta) return -1;
-    std::string schemaStr, keysStr;
-    std::getline(meta, schemaStr);
-    std::getline(meta, keysStr);
-    Schema schema(schemaStr, keysStr);
-    auto fields = schema.getFields();
-    auto uniqueKeys = schema.getUniqueKeys();
-
-    // Duplicate‑key check
-    IndexManager idx(tableName, "Tables/" + tableName, *RecordManager::bufMgr);
-    idx.loadIndexes(uniqueKeys);
+    return insertRecords(tableName, { data }).front();
+}
+
+std::vector<long> RecordManagerSQL::insertRecords(
+    const std::string& tableName,
+    const std::vector<std::vector<std::string>>& rows
+) {
+    std::vector<long> offsets(rows.size(), -1);
+
+    auto table = openTable(tableName);
+    if (!table) return offsets;
+    // the record IDs placed below stay put until the indexes hold them
+    std::shared_lock<std::shared_mutex> rowsLock(table->rowsMtx);
+    const auto& fields = table->fields;
+    IndexManager& idx = table->indexes;
+
+    // Encode every value once; a row with the wrong arity or a value its
+    // column cannot hold is rejected.  The keys and payloads below are the
+    // values as they read back, so the indexes see exactly what data.tbl holds.
+    std::vector<Row> stored(rows.size());
+    std::vector<bool> accepted(rows.size());
+    for (size_t r = 0; r < rows.size(); ++r) {
+        accepted[r] = rows[r].size() == fields.size();
+        std::string bytes;
+        for (size_t i = 0; accepted[r] && i < fields.size(); ++i) {
+            accepted[r] = Schema::encodeValue(fields[i], rows[r][i], bytes);
+            if (accepted[r]) stored[r].push_back(Schema::decodeValue(fields[i], bytes));
+        }
+    }
+
+    // Duplicate‑key check: one batched probe per unique key, which also
+    // rejects a key repeated within the batch itself.  A key too long for
+    // the index is rejected first: it could never be found again.
     for (size_t i = 0; i < fields.size(); ++i) {
-        if (std::find(uniqueKeys.begin(), uniqueKeys.end(), fields[i].name)
-            != uniqueKeys.end()
-            ) {
-            if (idx.existsInIndex(fields[i].name, data[i])) {
-                return -1;
-            }
+        if (!table->isUnique(fields[i].name)) continue;
+        std::vector<std::string> keys;
+        for (size_t r = 0; r < rows.size(); ++r) {
+            if (accepted[r]) accepted[r] = idx.keyFits(fields[i].name, stored[r][i]);
+            keys.push_back(accepted[r] ? stored[r][i] : std::string());
+        }
+        auto existing = idx.searchIndexBatch(fields[i].name, keys);
+        std::unordered_set<std::string> seen;
+        for (size_t r = 0; r < rows.size(); ++r) {
+            if (!accepted[r]) continue;
+            if (existing[r] >= 0 || !seen.insert(keys[r]).second) accepted[r] = false;
         }
     }
 
-    // Free space + pin page
-    int payload = 0; for (auto& f : fields) payload += f.length;
-    FreeSpaceManager fsm(tableName, payload, *RecordManager::bufMgr);
-    fsm.load();
-    uint32_t pageId = fsm.getPageWithFreeSlot();
+    // Only now are the records built: long text is written to the overflow
+    // file, which must not happen for a row the checks above turned away.
+    std::vector<std::string> records(rows.size());
+    for (size_t r = 0; r < rows.size(); ++r) {
+        if (accepted[r]) accepted[r] = table->encode(stored[r], records[r]);
+    }
 
-    const int PAGE_SIZE = 4096;
-    int slotWidth = 1 + payload;
-    char* buf = RecordManager::bufMgr->getPage(
-        "Tables/" + tableName + "/data.tbl",
-        pageId, PageType::DATA
-    );
-    if (!buf) return -1;
+    // Free space
+    std::lock_guard<std::mutex> fsmLock(table->freeSpaceMtx);
+    FreeSpaceManager& fsm = table->freeSpace;
 
-    // find slot
-    int slotIdx = -1, slotsPerPage = PAGE_SIZE / slotWidth;
-    for (int i = 0;i < slotsPerPage;++i) {
-        if (buf[i * slotWidth] == 0) { slotIdx = i; break; }
-    }
-    if (slotIdx < 0) {
+    // The page a row went to stays pinned for the rows after it until one
+    // does not fit, so a large batch fills whole pages with one pin and one
+    // free-space update each.
+    uint32_t pageId = 0;
+    char* buf = nullptr;
+    bool dirty = false;
+    auto release = [&] {
+        fsm.setFreeSpace(pageId, table->page(buf).freeSpace());
+        if (dirty) table->zones.update(pageId, table->page(buf));
         RecordManager::bufMgr->unpinPage(
-            "Tables/" + tableName + "/data.tbl", pageId,
-            PageType::DATA, false
+            table->dataFile, pageId,
+            PageType::DATA, dirty
         );
-        return -1;
+        buf = nullptr;
+        dirty = false;
+    };
+    for (size_t r = 0; r < rows.size(); ++r) {
+        if (!accepted[r]) continue;
+        const std::string& rec = records[r];
+
+        // a page too full for the row (or a stale free-space entry) is
+        // corrected and left for the next one with room
+        int slot = -1;
+        while (slot < 0) {
+            if (!buf) {
+                pageId = fsm.getPageWithFreeSpace(static_cast<int>(rec.size()));
+                buf = RecordManager::bufMgr->getPage(
+                    table->dataFile,
+                    pageId, PageType::DATA
+                );
+                if (!buf) break;
+            }
+            slot = table->page(buf).insert(rec);
+            if (slot < 0) release();
+            else dirty = true;
+        }
+        if (slot < 0) {
+            table->releaseExternal(rec);
+            continue;
+        }
+        offsets[r] = HeapPage::rid(pageId, slot);
     }
+    if (buf) release();
 
-    long offset = pageId * PAGE_SIZE + slotIdx * slotWidth;
-    // write
-    buf[slotIdx * slotWidth] = 1;
-    int off = slotIdx * slotWidth + 1;
+    // update indexes: the whole batch goes into each tree at once, and a
+    // large batch builds the indexes of its unique keys side by side
+    auto buildIndex = [&](size_t i) {
+        std::vector<BPlusTree::Entry> entries;
+        for (size_t r = 0; r < rows.size(); ++r) {
+            if (offsets[r] >= 0) {
+                entries.push_back({ stored[r][i], offsets[r],
+                    idx.makePayload(fields[i].name, stored[r]) });
+            }
+        }
+        idx.insertBatchIntoIndex(fields[i].name, std::move(entries));
+    };
+    std::vector<std::thread> builders;
     for (size_t i = 0;i < fields.size();++i) {
-        std::memset(buf + off, 0, fields[i].length);
-        std::memcpy(buf + off, data[i].c_str(),
-            std::min(data[i].size(), (size_t)fields[i].length));
-        off += fields[i].length;
+        if (!table->isUnique(fields[i].name)) continue;
+        if (rows.size() >= PARALLEL_INDEX_ROWS) builders.emplace_back(buildIndex, i);
+        else buildIndex(i);
     }
+    for (auto& t : builders) t.join();
+    return offsets;
+}
 
-    RecordManager::bufMgr->unpinPage(
-        "Tables/" + tableName + "/data.tbl", pageId,
-        PageType::DATA, true
-    );
-    fsm.markSlotUsed(pageId);
+long RecordManagerSQL::copyFrom(
+    const std::string& tableName,
+    const std::string& path,
+    long& rejected
+) {
+    rejected = 0;
+    if (!openTable(tableName)) return -1;
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return -1;
 
-    // update indexes
-    for (size_t i = 0;i < fields.size();++i) {
-        if (std::find(uniqueKeys.begin(), uniqueKeys.end(), fields[i].name)
-            != uniqueKeys.end()
-            ) {
-            idx.insertIntoIndex(fields[i].name, data[i], offset);
+    const unsigned threads = std::clamp(std::thread::hardware_concurrency(), 1u, 8u);
+    long loaded = 0;
+    std::string pending;   // read but not yet loaded: whole lines, then the start of one
+    std::vector<char> chunk(COPY_BLOCK);
+    for (bool more = true; more;) {
+        in.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        pending.append(chunk.data(), static_cast<size_t>(in.gcount()));
+        more = static_cast<bool>(in);
+
+        // load every complete line; the rest waits for the next block
+        size_t end = more ? pending.rfind('\n') + 1 : pending.size();
+        if (end == 0) continue;
+        Rows rows = parseCsv(std::string_view(pending.data(), end), threads);
+        for (long offset : insertRecords(tableName, rows)) {
+            if (offset >= 0) ++loaded;
+            else ++rejected;
         }
+        pending.erase(0, end);
     }
-    return offset;
+    return loaded;
 }
 
 std::optional<Row> RecordManagerSQL::findRecord(
     const std::string& tableName,
     const std::string& fieldName,
-    const std::string& value
+    const std::string& value,
+    const ColumnMask& needed
 ) {
-    // load schema
-    std::ifstream meta("Tables/" + tableName + "/meta.txt");
-    if (!meta) return std::nullopt;
-    std::string schemaStr, keysStr;
-    std::getline(meta, schemaStr);
-    std::getline(meta, keysStr);
-    Schema schema(schemaStr, keysStr);
-    auto fields = schema.getFields();
-    auto uniqueKeys = schema.getUniqueKeys();
+    auto table = openTable(tableName);
+    if (!table) return std::nullopt;
+    std::shared_lock<std::shared_mutex> rowsLock(table->rowsMtx);
 
     // index lookup
-    IndexManager idx(tableName, "Tables/" + tableName, *RecordManager::bufMgr);
-    idx.loadIndexes(uniqueKeys);
-    long offset = idx.searchIndex(fieldName, value);
+    long offset = table->indexes.searchIndex(fieldName, table->keyOf(fieldName, value));
     if (offset < 0) return std::nullopt;
 
-    return fetchRowAtOffset(tableName, fields, offset);
+    return fetchRowAtOffset(*table, offset, needed);
+}
+
+Rows RecordManagerSQL::findRecords(
+    const std::string& tableName,
+    const std::string& fieldName,
+    const std::vector<std::string>& values,
+    const ColumnMask& needed
+) {
+    Rows out;
+    auto table = openTable(tableName);
+    if (!table) return out;
+    std::shared_lock<std::shared_mutex> rowsLock(table->rowsMtx);
+
+    // one batched index lookup for the whole list
+    auto offsets = table->indexes.searchIndexBatch(fieldName, keysOf(*table, fieldName, values));
+    for (auto off : offsets) {
+        if (off < 0) continue;
+        auto r = fetchRowAtOffset(*table, off, needed);
+        if (r) out.push_back(*r);
+    }
+    return out;
+}
+
+Rows RecordManagerSQL::findRecordsIndexOnly(
+    const std::string& tableName,
+    const std::string& fieldName,
+    const std::vector<std::string>& values
+) {
+    Rows out;
+    auto table = openTable(tableName);
+    if (!table) return out;
+    // no record ID is kept, but VACUUM takes a moving row's keys out of the
+    // index until the move is done: wait for it, or the row is missed
+    std::shared_lock<std::shared_mutex> rowsLock(table->rowsMtx);
+
+    // the leaves hold everything asked for: no data page is pinned
+    IndexManager& idx = table->indexes;
+    std::vector<std::string> keys = keysOf(*table, fieldName, values);
+    std::vector<std::string> payloads;
+    auto offsets = idx.searchIndexBatch(fieldName, keys, &payloads);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (offsets[i] < 0) continue;
+        out.push_back(idx.rowFromIndex(fieldName, keys[i], payloads[i]));
+    }
+    return out;
 }
 
 DMLResult RecordManagerSQL::deleteRecord(
@@ -161,98 +531,190 @@ DMLResult RecordManagerSQL::deleteRecord(
     const std::string& fieldName,
     const std::string& value
 ) {
-    // locate
-    auto rec = findRecord(tableName, fieldName, value);
-    if (!rec) return DMLResult::NotFound;
+    auto table = openTable(tableName);
+    if (!table) return DMLResult::Error;
+    std::shared_lock<std::shared_mutex> rowsLock(table->rowsMtx);
+    const auto& fields = table->fields;
+    IndexManager& idx = table->indexes;
 
-    // remove from index
-    IndexManager idx(tableName, "Tables/" + tableName, *RecordManager::bufMgr);
-    idx.loadIndexes({ fieldName });
-    idx.removeFromIndex(fieldName, value);
+    // locate, before the key leaves the index
+    long offset = idx.searchIndex(fieldName, table->keyOf(fieldName, value));
+    if (offset < 0) return DMLResult::NotFound;
+    auto rec = fetchRowAtOffset(*table, offset);
+    if (!rec) return DMLResult::NotFound;
 
-    // mark invalid
-    long offset = idx.searchIndex(fieldName, value); // old offset
-    const int PAGE_SIZE = 4096;
-    auto schemaRow = rec.value();
-    int payload = 0; for (auto& s : schemaRow) payload += s.size();
-    int slotWidth = 1 + payload;
-    uint32_t pageId = offset / PAGE_SIZE;
+    // remove the row from every unique key's index (each key as stored)
+    for (size_t i = 0; i < fields.size(); ++i) {
+        if (table->isUnique(fields[i].name)) {
+            idx.removeFromIndex(fields[i].name, (*rec)[i]);
+        }
+    }
 
+    // free the slot; the page's free space changes under the FSM lock
+    std::lock_guard<std::mutex> fsmLock(table->freeSpaceMtx);
+    uint32_t pageId = HeapPage::pageOf(offset);
     char* buf = RecordManager::bufMgr->getPage(
-        "Tables/" + tableName + "/data.tbl",
+        table->dataFile,
         pageId, PageType::DATA
     );
     if (!buf) return DMLResult::Error;
-    int slotIdx = (offset % PAGE_SIZE) / slotWidth;
-    buf[slotIdx * slotWidth] = 0;
+    DataPage page = table->page(buf);
+    std::string assembled;
+    table->releaseExternal(page.record(HeapPage::slotOf(offset), assembled));
+    page.erase(HeapPage::slotOf(offset));
+    table->freeSpace.setFreeSpace(pageId, page.freeSpace());
+    table->zones.update(pageId, page);
     RecordManager::bufMgr->unpinPage(
-        "Tables/" + tableName + "/data.tbl", pageId,
+        table->dataFile, pageId,
         PageType::DATA, true
     );
-
-    // free‐space
-    FreeSpaceManager fsm(tableName, payload, *RecordManager::bufMgr);
-    fsm.load();
-    fsm.markSlotFree(pageId);
     return DMLResult::Deleted;
 }
 
-Rows RecordManagerSQL::scanAll(const std::string& tableName) {
-    Rows out;
-    // load schema
-    std::ifstream meta("Tables/" + tableName + "/meta.txt");
-    if (!meta) return out;
-    std::string s1, s2; std::getline(meta, s1); std::getline(meta, s2);
-    Schema schema(s1, s2);
-    auto fields = schema.getFields();
-
-    // file size
-    std::ifstream f("Tables/" + tableName + "/data.tbl", std::ios::binary | std::ios::ate);
-    long fileSize = f.tellg(); f.close();
-    const int PAGE_SIZE = 4096;
-    size_t totalPages = (fileSize + PAGE_SIZE - 1) / PAGE_SIZE;
-    int recordSize = 1; for (auto& fld : fields) recordSize += fld.length;
-
-    for (size_t pid = 0;pid < totalPages;++pid) {
-        char* buf = RecordManager::bufMgr->getPage(
-            "Tables/" + tableName + "/data.tbl",
-            pid, PageType::DATA
-        );
-        if (!buf) continue;
-        int slots = PAGE_SIZE / recordSize;
-        for (int s = 0;s < slots;++s) {
-            if (buf[s * recordSize] == 0) continue;
-            long offset = pid * PAGE_SIZE + s * recordSize;
-            auto row = fetchRowAtOffset(tableName, fields, offset);
-            if (row) out.push_back(*row);
+std::unique_ptr<RowCursor> RecordManagerSQL::openScan(
+    const std::string& tableName,
+    const ColumnMask& needed
+) {
+    return std::make_unique<HeapCursor>(openTable(tableName), needed, nullptr);
+}
+
+std::unique_ptr<RowCursor> RecordManagerSQL::openScanWhere(
+    const std::string& tableName,
+    const std::string& fieldName,
+    const std::string& op,
+    const std::vector<std::string>& values,
+    const ColumnMask& needed
+) {
+    auto table = openTable(tableName);
+    if (!table) return std::make_unique<HeapCursor>(nullptr, needed, nullptr);
+    auto f = std::find_if(table->fields.begin(), table->fields.end(),
+        [&](const Schema::Field& sf) { return sf.name == fieldName; });
+    if (f == table->fields.end()) return nullptr;
+    if (op != "=" && op != "!=" && op != "<" && op != "<=" && op != ">" && op != ">="
+        && op != "IN") {
+        return nullptr;
+    }
+
+    // The executor compares numerically whenever both sides are numbers, so a
+    // text column is only compared byte-wise here when the operand is not one.
+    std::vector<std::string> operands;
+    for (const auto& v : values) {
+        if (f->kind == Schema::Kind::Char) {
+            char* end = nullptr;
+            std::strtod(v.c_str(), &end);
+            if (!v.empty() && *end == '\0') return nullptr;
         }
-        RecordManager::bufMgr->unpinPage(
-            "Tables/" + tableName + "/data.tbl",
-            pid, PageType::DATA, false
-        );
+        std::string bytes;
+        if (!Schema::encodeValue(*f, v, bytes)) return nullptr;
+        operands.push_back(std::move(bytes));
     }
-    return out;
+    if (operands.empty()) return nullptr;
+
+    // A comparison on a number column runs as a kernel over each page, and
+    // skips the pages whose zone cannot hold a match; text and IN are tested
+    // a row at a time.
+    TableHandle* t = table.get();
+    const size_t column = static_cast<size_t>(f - table->fields.begin());
+    FilterKernel::Op kernelOp;
+    if (FilterKernel::supports(f->kind) && FilterKernel::parseOp(op, kernelOp)) {
+        auto select = [field = *f, kernelOp, operand = operands.front()](const DataPage& page,
+            std::vector<uint16_t>& sel)
+        {
+            page.select(field, kernelOp, operand, sel);
+        };
+        auto skip = [t, column, kernelOp, operand = operands.front()](uint32_t pageId) {
+            return !t->zones.mayMatch(pageId, column, kernelOp, operand);
+        };
+        return std::make_unique<HeapCursor>(std::move(table), needed, std::move(select),
+            std::move(skip));
+    }
+    HeapCursor::Skip skip;
+    if (FilterKernel::supports(f->kind)) {
+        skip = [t, column, operands](uint32_t pageId) {
+            return std::none_of(operands.begin(), operands.end(), [&](const std::string& o) {
+                return t->zones.mayMatch(pageId, column, FilterKernel::Op::Eq, o);
+            });
+        };
+    }
+
+
+    auto holds = [t, field = *f, op, operands = std::move(operands)](const DataPage& page, int slot) {
+        std::string_view stored = page.value(field, slot);
+        std::string external;
+        if (page.isExternal(field, slot)) {
+            Schema::ExternalRef ref = page.externalRef(field, slot);
+            external = t->overflow.read(ref.firstPage, ref.length);
+            stored = external;
+        }
+        if (op == "IN") {
+            return std::any_of(operands.begin(), operands.end(), [&](const std::string& o) {
+                return Schema::compareValues(field, stored, o) == 0;
+            });
+        }
+        int cmp = Schema::compareValues(field, stored, operands.front());
+        if (op == "=")  return cmp == 0;
+        if (op == "!=") return cmp != 0;
+        if (op == "<")  return cmp < 0;
+        if (op == "<=") return cmp <= 0;
+        if (op == ">")  return cmp > 0;
+        return cmp >= 0;
+    };
+    auto select = [holds = std::move(holds)](const DataPage& page, std::vector<uint16_t>& sel) {
+        sel.clear();
+        for (int s = 0; s < page.slotCount(); ++s) {
+            if (page.live(s) && holds(page, s)) sel.push_back(static_cast<uint16_t>(s));
+        }
+    };
+    return std::make_unique<HeapCursor>(std::move(table), needed, std::move(select),
+        std::move(skip));
+}
+
+std::unique_ptr<RowCursor> RecordManagerSQL::openRange(
+    const std::string& tableName,
+    const std::string& fieldName,
+    const std::string& low,
+    const std::string& high,
+    bool descending,
+    std::size_t limit,
+    const ColumnMask& needed
+) {
+    auto table = openTable(tableName);
+    std::string lo = table ? table->keyOf(fieldName, low) : low;
+    std::string hi = table ? table->keyOf(fieldName, high) : high;
+    return std::make_unique<RangeCursor>(std::move(table), fieldName, lo, hi,
+        descending, limit, needed);
+}
+
+Rows RecordManagerSQL::scanAll(const std::string& tableName, const ColumnMask& needed) {
+    return drain(*openScan(tableName, needed));
+}
+
+std::optional<Rows> RecordManagerSQL::scanWhere(
+    const std::string& tableName,
+    const std::string& fieldName,
+    const std::string& op,
+    const std::vector<std::string>& values,
+    const ColumnMask& needed
+) {
+    auto cursor = openScanWhere(tableName, fieldName, op, values, needed);
+    if (!cursor) return std::nullopt;
+    return drain(*cursor);
 }
 
 Rows RecordManagerSQL::scanGreaterEqual(
     const std::string& tableName,
     const std::string& fieldName,
-    const std::string& value
+    const std::string& value,
+    const ColumnMask& needed
 ) {
     Rows out;
-    // load schema
-    std::ifstream meta("Tables/" + tableName + "/meta.txt");
-    if (!meta) return out;
-    std::string s1, s2; std::getline(meta, s1); std::getline(meta, s2);
-    Schema schema(s1, s2);
-    auto fields = schema.getFields();
-    auto ukeys = schema.getUniqueKeys();
-
-    IndexManager idx(tableName, "Tables/" + tableName, *RecordManager::bufMgr);
-    idx.loadIndexes(ukeys);
-    auto offsets = idx.searchGreaterEqual(fieldName, value);
+    auto table = openTable(tableName);
+    if (!table) return out;
+    std::shared_lock<std::shared_mutex> rowsLock(table->rowsMtx);
+
+    auto offsets = table->indexes.searchGreaterEqual(fieldName, table->keyOf(fieldName, value));
     for (auto off : offsets) {
-        auto r = fetchRowAtOffset(tableName, fields, off);
+        auto r = fetchRowAtOffset(*table, off, needed);
         if (r) out.push_back(*r);
     }
     return out;
@@ -261,22 +723,17 @@ Rows RecordManagerSQL::scanGreaterEqual(
 Rows RecordManagerSQL::scanLessEqual(
     const std::string& tableName,
     const std::string& fieldName,
-    const std::string& value
+    const std::string& value,
+    const ColumnMask& needed
 ) {
     Rows out;
-    // load schema
-    std::ifstream meta("Tables/" + tableName + "/meta.txt");
-    if (!meta) return out;
-    std::string s1, s2; std::getline(meta, s1); std::getline(meta, s2);
-    Schema schema(s1, s2);
-    auto fields = schema.getFields();
-    auto ukeys = schema.getUniqueKeys();
-
-    IndexManager idx(tableName, "Tables/" + tableName, *RecordManager::bufMgr);
-    idx.loadIndexes(ukeys);
-    auto offsets = idx.searchLessEqual(fieldName, value);
+    auto table = openTable(tableName);
+    if (!table) return out;
+    std::shared_lock<std::shared_mutex> rowsLock(table->rowsMtx);
+
+    auto offsets = table->indexes.searchLessEqual(fieldName, table->keyOf(fieldName, value));
     for (auto off : offsets) {
-        auto r = fetchRowAtOffset(tableName, fields, off);
+        auto r = fetchRowAtOffset(*table, off, needed);
         if (r) out.push_back(*r);
     }
     return out;
@@ -286,23 +743,145 @@ Rows RecordManagerSQL::scanBetween(
     const std::string& tableName,
     const std::string& fieldName,
     const std::string& low,
-    const std::string& high
+    const std::string& high,
+    bool descending,
+    std::size_t limit,
+    const ColumnMask& needed
+) {
+    return drain(*openRange(tableName, fieldName, low, high, descending, limit, needed));
+}
+
+Rows RecordManagerSQL::scanBetweenIndexOnly(
+    const std::string& tableName,
+    const std::string& fieldName,
+    const std::string& low,
+    const std::string& high,
+    bool descending,
+    std::size_t limit
 ) {
     Rows out;
-    // load schema
-    std::ifstream meta("Tables/" + tableName + "/meta.txt");
-    if (!meta) return out;
-    std::string s1, s2; std::getline(meta, s1); std::getline(meta, s2);
-    Schema schema(s1, s2);
-    auto fields = schema.getFields();
-    auto ukeys = schema.getUniqueKeys();
-
-    IndexManager idx(tableName, "Tables/" + tableName, *RecordManager::bufMgr);
-    idx.loadIndexes(ukeys);
-    auto offsets = idx.searchBetween(fieldName, low, high);
-    for (auto off : offsets) {
-        auto r = fetchRowAtOffset(tableName, fields, off);
-        if (r) out.push_back(*r);
+    auto table = openTable(tableName);
+    if (!table) return out;
+    std::shared_lock<std::shared_mutex> rowsLock(table->rowsMtx);  // as findRecordsIndexOnly
+
+    IndexManager& idx = table->indexes;
+    for (const auto& e : idx.searchBetweenCovering(fieldName,
+        table->keyOf(fieldName, low), table->keyOf(fieldName, high), descending, limit)) {
+        out.push_back(idx.rowFromIndex(fieldName, e.key, e.payload));
     }
     return out;
 }
+
+bool RecordManagerSQL::reindex(const std::string& tableName) {
+    auto table = openTable(tableName);
+    if (!table) return false;
+    table->indexes.compactIndexes();
+    return true;
+}
+
+VacuumResult RecordManagerSQL::vacuumStep(
+    const std::string& tableName,
+    std::size_t maxRows,
+    long& moved,
+    long& freedPages
+) {
+    moved = freedPages = 0;
+    auto table = openTable(tableName);
+    if (!table) return VacuumResult::Missing;
+
+    // No statement may hold a record ID while rows move; one that does makes
+    // this step wait for the next try instead of the other way round.
+    std::unique_lock<std::shared_mutex> rowsLock(table->rowsMtx, std::try_to_lock);
+    if (!rowsLock) return VacuumResult::Busy;
+    std::lock_guard<std::mutex> fsmLock(table->freeSpaceMtx);
+    FreeSpaceManager& fsm = table->freeSpace;
+    BufferManager& bm = *RecordManager::bufMgr;
+    const auto& fields = table->fields;
+    IndexManager& idx = table->indexes;
+
+    // Rows leave the last page that has any for the lowest page with room,
+    // a page at a time from the end, until a row fits nowhere before its own
+    // page.  Each moved row's keys come out of the indexes now and go back
+    // in with the new record ID as one batch per index below.
+    std::vector<std::vector<BPlusTree::Entry>> repointed(fields.size());
+    bool done = false;
+    std::string assembled;
+    Row values;
+    for (uint32_t last = fsm.pageCount(); last-- > 0 && !done && static_cast<std::size_t>(moved) < maxRows;) {
+        char* src = bm.getPage(table->dataFile, last, PageType::DATA);
+        if (!src) break;
+        DataPage from = table->page(src);
+        bool changed = false;
+        for (int s = 0; s < from.slotCount() && static_cast<std::size_t>(moved) < maxRows; ++s) {
+            if (!from.live(s)) continue;
+            const std::string rec(from.record(s, assembled));
+
+            // a stale free-space entry is corrected and the next page tried
+            long target = -1;
+            int slot = -1;
+            while (slot < 0) {
+                target = fsm.firstPageWithFreeSpace(static_cast<int>(rec.size()));
+                if (target < 0 || target >= last) break;
+                char* dst = bm.getPage(table->dataFile, static_cast<uint32_t>(target), PageType::DATA);
+                if (!dst) break;
+                DataPage to = table->page(dst);
+                slot = to.insert(rec);
+                if (slot >= 0) table->zones.update(static_cast<uint32_t>(target), to);
+                fsm.setFreeSpace(static_cast<uint32_t>(target), to.freeSpace());
+                bm.unpinPage(table->dataFile, static_cast<uint32_t>(target), PageType::DATA, slot >= 0);
+            }
+            if (slot < 0) {
+                done = true;
+                break;
+            }
+
+            // the overflow chains move with the record: they are not released
+            from.erase(s);
+            changed = true;
+            ++moved;
+            const long rid = HeapPage::rid(static_cast<uint32_t>(target), slot);
+            table->decode(rec, values);
+            for (size_t i = 0; i < fields.size(); ++i) {
+                if (!table->isUnique(fields[i].name)) continue;
+                idx.removeFromIndex(fields[i].name, values[i]);
+                repointed[i].push_back({ values[i], rid, idx.makePayload(fields[i].name, values) });
+            }
+        }
+        if (changed) {
+            fsm.setFreeSpace(last, from.freeSpace());
+            table->zones.update(last, from);
+        }
+        bm.unpinPage(table->dataFile, last, PageType::DATA, changed);
+    }
+    for (size_t i = 0; i < fields.size(); ++i) {
+        if (!repointed[i].empty()) idx.insertBatchIntoIndex(fields[i].name, std::move(repointed[i]));
+    }
+
+    // Cut the pages left without rows off the end of data.tbl.  Their cached
+    // copies go first, so a later flush cannot write them back.
+    uint32_t keep = fsm.pageCount();
+    for (; keep > 1; --keep) {
+        char* buf = bm.getPage(table->dataFile, keep - 1, PageType::DATA);
+        if (!buf) break;
+        DataPage page = table->page(buf);
+        bool empty = true;
+        for (int s = 0; s < page.slotCount() && empty; ++s) empty = !page.live(s);
+        bm.unpinPage(table->dataFile, keep - 1, PageType::DATA, false);
+        if (!empty) break;
+    }
+    if (keep < fsm.pageCount()) {
+        freedPages = static_cast<long>(fsm.pageCount() - keep);
+        bm.discardPages(table->dataFile, keep, PageType::DATA);
+        const std::uintmax_t bytes = static_cast<std::uintmax_t>(keep) * HeapPage::PAGE_SIZE;
+        std::error_code ec;
+        if (std::filesystem::file_size(table->dataFile, ec) > bytes && !ec) {
+            std::filesystem::resize_file(table->dataFile, bytes, ec);
+        }
+        if (ec) {
+            std::cerr << "[VACUUM] cannot truncate " << table->dataFile << ": " << ec.message() << "\n";
+        }
+        fsm.truncate(keep);
+        table->zones.truncate(keep);
+    }
+    return done || static_cast<std::size_t>(moved) < maxRows ? VacuumResult::Done : VacuumResult::Moved;
+}
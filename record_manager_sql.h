@@ -1,18 +1,40 @@
-// File: record_manager_sqlin.hpp
+﻿// File: record_manager_sqlin.hpp
 #pragma once
 
 #include <string>
 #include <vector>
 #include <optional>
 #include <fstream>
+#include <memory>
 
 /// Row is a simple vector of stringified field values.
 using Row = std::vector<std::string>;
 using Rows = std::vector<Row>;
 
+/// The columns a read needs, by schema position; empty means all of them.
+/// Text kept out of line (see OverflowFile) is only fetched for needed
+/// columns and comes back empty for the others; inline values always come back.
+using ColumnMask = std::vector<bool>;
+
+/// Rows pulled one at a time from a scan or an index range, so a result
+/// never has to be held whole.  A cursor is open from the call that makes
+/// it; next() fills `row` and returns false once there are no more, and
+/// close() (or destruction) lets go of the table.  Cursors read ahead at
+/// most one data page, or one small batch of index entries.
+class RowCursor {
+public:
+    virtual ~RowCursor() = default;
+    virtual bool next(Row& row) = 0;
+    virtual void close() = 0;
+};
+
 /// Outcomes for delete/update operations.
 enum class DMLResult { NotFound, Deleted, Error };
 
+/// Outcomes of one step of VACUUM: rows moved and more may follow, nothing
+/// left to move, the table in use (try again later), or no such table.
+enum class VacuumResult { Moved, Done, Busy, Missing };
+
 /// A SQL?style interface into your storage engine.
 ///
 /// Exactly mirrors add/find/delete/get... but via function calls.
@@ -25,11 +47,49 @@ public:
         const std::vector<std::string>& fields
     );
 
+    /// Add many records with one duplicate check and one index update per
+    /// unique key.  Returns each row's byte offset, or -1 for rows that were
+    /// rejected (wrong arity, duplicate key or a key too long for its index).
+    static std::vector<long> insertRecords(
+        const std::string& tableName,
+        const std::vector<std::vector<std::string>>& rows
+    );
+
+    /// Load a CSV file: one row per line, fields separated by commas, a
+    /// field in double quotes may hold commas and "" for a quote.  Lines are
+    /// parsed on several threads and stored through insertRecords in large
+    /// batches.  Returns the rows stored, or -1 if the table or the file
+    /// cannot be opened; `rejected` counts the lines turned away.
+    static long copyFrom(
+        const std::string& tableName,
+        const std::string& path,
+        long& rejected
+    );
+
     /// Find by unique key.  Returns one Row if found, or nullopt.
     static std::optional<Row> findRecord(
         const std::string& tableName,
         const std::string& fieldName,
-        const std::string& value
+        const std::string& value,
+        const ColumnMask& needed = {}
+    );
+
+    /// Find every row whose unique key is in 'values' (duplicates in the list
+    /// yield the row more than once).  Missing values are skipped.
+    static Rows findRecords(
+        const std::string& tableName,
+        const std::string& fieldName,
+        const std::vector<std::string>& values,
+        const ColumnMask& needed = {}
+    );
+
+    /// findRecords answered from a covering index alone: each Row holds the
+    /// key and the index's INCLUDE columns, with the other columns empty.
+    /// data.tbl is not read.
+    static Rows findRecordsIndexOnly(
+        const std::string& tableName,
+        const std::string& fieldName,
+        const std::vector<std::string>& values
     );
 
     /// Delete by unique key.  Returns Deleted / NotFound / Error.
@@ -39,28 +99,106 @@ public:
         const std::string& value
     );
 
+    /// Cursor over every row of the table, in no particular order (empty if
+    /// the table is missing).
+    static std::unique_ptr<RowCursor> openScan(
+        const std::string& tableName,
+        const ColumnMask& needed = {}
+    );
+
+    /// openScan keeping only the rows scanWhere would return; nullptr when
+    /// scanWhere would return nullopt.
+    static std::unique_ptr<RowCursor> openScanWhere(
+        const std::string& tableName,
+        const std::string& fieldName,
+        const std::string& op,
+        const std::vector<std::string>& values,
+        const ColumnMask& needed = {}
+    );
+
+    /// Cursor over the rows scanBetween would return, in the same order,
+    /// walking the index a batch of entries at a time.
+    static std::unique_ptr<RowCursor> openRange(
+        const std::string& tableName,
+        const std::string& fieldName,
+        const std::string& low,
+        const std::string& high,
+        bool descending = false,
+        std::size_t limit = 0,
+        const ColumnMask& needed = {}
+    );
+
     /// Return all rows in the table, in no particular order.
-    static Rows scanAll(const std::string& tableName);
+    static Rows scanAll(const std::string& tableName, const ColumnMask& needed = {});
+
+    /// scanAll keeping only the rows whose fieldName satisfies `op` ("=",
+    /// "!=", "<", "<=", ">", ">=" or "IN") against `values`: one value, or
+    /// the IN list.  The operands are encoded once and compared with each
+    /// stored value in place; only matching rows are decoded.  Returns
+    /// nullopt, without scanning, if that comparison could differ from the
+    /// executor's (an operand the column cannot hold, or a number against a
+    /// text column); the caller then filters scanAll itself.
+    static std::optional<Rows> scanWhere(
+        const std::string& tableName,
+        const std::string& fieldName,
+        const std::string& op,
+        const std::vector<std::string>& values,
+        const ColumnMask& needed = {}
+    );
 
     /// Return all rows with field >= value (field must be unique).
     static Rows scanGreaterEqual(
         const std::string& tableName,
         const std::string& fieldName,
-        const std::string& value
+        const std::string& value,
+        const ColumnMask& needed = {}
     );
 
     /// Return all rows with field <= value (field must be unique).
     static Rows scanLessEqual(
         const std::string& tableName,
         const std::string& fieldName,
-        const std::string& value
+        const std::string& value,
+        const ColumnMask& needed = {}
     );
 
-    /// Return all rows with low <= field <= high (field must be unique).
+    /// Return all rows with low <= field <= high (field must be unique), in
+    /// key order or, if `descending`, highest key first.  An empty bound is
+    /// open; a non-zero `limit` stops the index walk after that many rows.
     static Rows scanBetween(
         const std::string& tableName,
         const std::string& fieldName,
         const std::string& low,
-        const std::string& high
+        const std::string& high,
+        bool descending = false,
+        std::size_t limit = 0,
+        const ColumnMask& needed = {}
+    );
+
+    /// scanBetween answered from a covering index alone, rows filled as by
+    /// findRecordsIndexOnly.
+    static Rows scanBetweenIndexOnly(
+        const std::string& tableName,
+        const std::string& fieldName,
+        const std::string& low,
+        const std::string& high,
+        bool descending = false,
+        std::size_t limit = 0
+    );
+
+    /// Compact every index of the table.  Returns false if the table is missing.
+    static bool reindex(const std::string& tableName);
+
+    /// One step of VACUUM: move up to maxRows live rows off the last pages
+    /// of data.tbl into room on the lowest pages before them, re-point every
+    /// index at their new record IDs, then cut the empty pages off the end
+    /// of the file.  The step runs only while nothing else is using the
+    /// table and returns Busy at once otherwise.  Done once the last page's
+    /// rows fit no earlier page.  `moved` and `freedPages` count this step's work.
+    static VacuumResult vacuumStep(
+        const std::string& tableName,
+        std::size_t maxRows,
+        long& moved,
+        long& freedPages
     );
 };
@@ -2,8 +2,95 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
 
-Schema::Schema(const std::string& schemaStr, const std::string& uniqueKeysStr) {
+namespace {
+
+    const int MAX_TEXT_LENGTH = 1 << 24;  // a "string" column; also the char(N) limit
+
+    /// Kind and width of a declared column type; throws std::runtime_error
+    /// for a type the engine cannot store.
+    void resolveType(const std::string& declared, Schema::Kind& kind, int& length) {
+        std::string type = declared;
+        std::transform(type.begin(), type.end(), type.begin(),
+            [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        if (type == "int" || type == "integer") {
+            kind = Schema::Kind::Int32; length = sizeof(int32_t);
+        }
+        else if (type == "bigint") {
+            kind = Schema::Kind::Int64; length = sizeof(int64_t);
+        }
+        else if (type == "double" || type == "float") {
+            kind = Schema::Kind::Double; length = sizeof(double);
+        }
+        else if (type == "string") {
+            kind = Schema::Kind::Char; length = MAX_TEXT_LENGTH;
+        }
+        else if (type.compare(0, 5, "char(") == 0 && type.back() == ')') {
+            char* end = nullptr;
+            long n = std::strtol(type.c_str() + 5, &end, 10);
+            if (end != type.c_str() + type.size() - 1 || n < 1 || n > MAX_TEXT_LENGTH) {
+                throw std::runtime_error("bad column type '" + declared + "': char(N) needs 1 <= N <= "
+                    + std::to_string(MAX_TEXT_LENGTH));
+            }
+            kind = Schema::Kind::Char; length = static_cast<int>(n);
+        }
+        else {
+            throw std::runtime_error("unknown column type '" + declared
+                + "' (expected int, bigint, double, string or char(N))");
+        }
+    }
+
+    /// Whole-string integer parse; false on junk, overflow or an empty string.
+    bool parseInt(const std::string& text, int64_t lo, int64_t hi, int64_t& out) {
+        if (text.empty() || std::isspace(static_cast<unsigned char>(text[0]))) return false;
+        char* end = nullptr;
+        errno = 0;
+        long long v = std::strtoll(text.c_str(), &end, 10);
+        if (errno == ERANGE || *end != '\0' || v < lo || v > hi) return false;
+        out = v;
+        return true;
+    }
+
+    bool parseDouble(const std::string& text, double& out) {
+        if (text.empty() || std::isspace(static_cast<unsigned char>(text[0]))) return false;
+        char* end = nullptr;
+        double v = std::strtod(text.c_str(), &end);
+        if (*end != '\0' || !std::isfinite(v)) return false;
+        out = v;
+        return true;
+    }
+
+    template <typename T>
+    T load(const char* src) {
+        T v;
+        std::memcpy(&v, src, sizeof(T));
+        return v;
+    }
+
+    template <typename T>
+    int threeWay(T a, T b) {
+        return (a > b) - (a < b);
+    }
+
+    // Sign bits of the index keys of numbers (see Schema::encodeKey)
+    constexpr uint32_t SIGN_32 = 0x80000000u;
+    constexpr uint64_t SIGN_64 = 0x8000000000000000ull;
+}
+
+Schema::Schema(const std::string& schemaStr, const std::string& uniqueKeysStr,
+    const std::string& storageStr)
+{
     std::stringstream ss(schemaStr);
     std::string token;
 
@@ -15,14 +102,36 @@ Schema::Schema(const std::string& schemaStr, const std::string& uniqueKeysStr) {
         Field f;
         f.type = type;
         f.name = name;
-        f.length = (type == "string") ? 40 : sizeof(int); // default string size
+        resolveType(type, f.kind, f.length);
+        f.offset = fields.empty() ? 0 : fields.back().offset + fixedWidth(fields.back());
 
         fields.push_back(f);
     }
 
     std::stringstream keyStream(uniqueKeysStr);
     while (std::getline(keyStream, token, ',')) {
-        uniqueKeys.push_back(token);
+        // "name", "name:type", either followed by "+col" per INCLUDE column
+        std::stringstream partStream(token);
+        std::string key, col;
+        std::getline(partStream, key, '+');
+        std::vector<std::string> included;
+        while (std::getline(partStream, col, '+')) included.push_back(col);
+
+        size_t colon = key.find(':');
+        uniqueKeys.push_back(key.substr(0, colon));
+        indexTypes.push_back(colon == std::string::npos ? "btree" : key.substr(colon + 1));
+        includes.push_back(included);
+    }
+
+    std::string layout;
+    std::stringstream(storageStr) >> layout;
+    std::transform(layout.begin(), layout.end(), layout.begin(),
+        [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (layout == "pax") {
+        storage = Storage::Pax;
+    }
+    else if (!layout.empty() && layout != "row") {
+        throw std::runtime_error("unknown storage '" + storageStr + "' (expected row or pax)");
     }
 }
 
@@ -37,10 +146,17 @@ void Schema::saveToFile(const std::string& path) {
 
     for (size_t i = 0; i < uniqueKeys.size(); ++i) {
         out << uniqueKeys[i];
+        if (indexTypes[i] != "btree")
+            out << ":" << indexTypes[i];
+        for (const auto& col : includes[i])
+            out << "+" << col;
         if (i < uniqueKeys.size() - 1)
             out << ",";
     }
     out << "\n";
+
+    if (storage == Storage::Pax)
+        out << "pax\n";
 }
 
 std::vector<Schema::Field> Schema::getFields() const {
@@ -54,3 +170,243 @@ std::vector<std::string> Schema::getUniqueKeys() const {
     // for (auto e : uniqueKeys) std::cout << e << std::endl;
     return uniqueKeys;
 }
+
+std::string Schema::getIndexType(const std::string& key) const {
+    for (size_t i = 0; i < uniqueKeys.size(); ++i) {
+        if (uniqueKeys[i] == key) return indexTypes[i];
+    }
+    return "btree";
+}
+
+std::vector<std::string> Schema::getIncludedColumns(const std::string& key) const {
+    for (size_t i = 0; i < uniqueKeys.size(); ++i) {
+        if (uniqueKeys[i] == key) return includes[i];
+    }
+    return {};
+}
+
+Schema::Storage Schema::getStorage() const {
+    return storage;
+}
+
+int Schema::getFixedSize() const {
+    return fields.empty() ? 0 : fields.back().offset + fixedWidth(fields.back());
+}
+
+int Schema::fixedWidth(const Field& f) {
+    return f.kind == Kind::Char ? 2 * sizeof(uint16_t) : f.length;
+}
+
+bool Schema::encodeValue(const Field& f, const std::string& value, std::string& bytes) {
+    switch (f.kind) {
+    case Kind::Int32: {
+        int64_t v;
+        if (!parseInt(value, std::numeric_limits<int32_t>::min(),
+            std::numeric_limits<int32_t>::max(), v)) return false;
+        int32_t n = static_cast<int32_t>(v);
+        bytes.assign(reinterpret_cast<const char*>(&n), sizeof(n));
+        return true;
+    }
+    case Kind::Int64: {
+        int64_t v;
+        if (!parseInt(value, std::numeric_limits<int64_t>::min(),
+            std::numeric_limits<int64_t>::max(), v)) return false;
+        bytes.assign(reinterpret_cast<const char*>(&v), sizeof(v));
+        return true;
+    }
+    case Kind::Double: {
+        double v;
+        if (!parseDouble(value, v)) return false;
+        bytes.assign(reinterpret_cast<const char*>(&v), sizeof(v));
+        return true;
+    }
+    case Kind::Char:
+        // stored text ends at its first '\0', as it always has
+        bytes.assign(value.c_str(), std::min<std::size_t>(strnlen(value.c_str(), value.size()), f.length));
+        return true;
+    }
+    return false;
+}
+
+std::string Schema::decodeValue(const Field& f, std::string_view bytes) {
+    std::string text;
+    decodeValue(f, bytes, text);
+    return text;
+}
+
+void Schema::decodeValue(const Field& f, std::string_view bytes, std::string& text) {
+    char buf[32];
+    switch (f.kind) {
+    case Kind::Int32: {
+        auto res = std::to_chars(buf, buf + sizeof(buf), load<int32_t>(bytes.data()));
+        text.assign(buf, res.ptr);
+        return;
+    }
+    case Kind::Int64: {
+        auto res = std::to_chars(buf, buf + sizeof(buf), load<int64_t>(bytes.data()));
+        text.assign(buf, res.ptr);
+        return;
+    }
+    case Kind::Double: {
+        // shortest text that reads back as the same double
+        // (to_chars with a precision writes exactly what "%.*g" would)
+        double v = load<double>(bytes.data());
+        char* end = buf;
+        for (int precision = 15; precision <= 17; ++precision) {
+            end = std::to_chars(buf, buf + sizeof(buf), v, std::chars_format::general, precision).ptr;
+            double back = 0;
+            std::from_chars(buf, end, back);
+            if (back == v) break;
+        }
+        text.assign(buf, end);
+        return;
+    }
+    case Kind::Char:
+        text.assign(bytes);
+        return;
+    }
+    text.clear();
+}
+
+bool Schema::encodeRecord(const std::vector<std::string>& values, std::string& record,
+    const StoreExternal& store) const
+{
+    if (values.size() != fields.size()) return false;
+    record.assign(getFixedSize(), '\0');
+    std::string bytes;
+    for (std::size_t i = 0; i < fields.size(); ++i) {
+        const Field& f = fields[i];
+        if (!encodeValue(f, values[i], bytes)) return false;
+        if (f.kind != Kind::Char) {
+            std::memcpy(&record[f.offset], bytes.data(), bytes.size());
+            continue;
+        }
+        if (store && bytes.size() > static_cast<std::size_t>(INLINE_LIMIT)) {
+            ExternalRef ref{ store(bytes), static_cast<uint32_t>(bytes.size()) };
+            bytes.assign(reinterpret_cast<const char*>(&ref), sizeof(ref));
+            uint16_t entry[2] = { static_cast<uint16_t>(record.size()), EXTERNAL };
+            std::memcpy(&record[f.offset], entry, sizeof(entry));
+            record += bytes;
+            continue;
+        }
+        if (record.size() + bytes.size() > std::numeric_limits<uint16_t>::max()) return false;
+        uint16_t entry[2] = { static_cast<uint16_t>(record.size()), static_cast<uint16_t>(bytes.size()) };
+        std::memcpy(&record[f.offset], entry, sizeof(entry));
+        record += bytes;
+    }
+    return true;
+}
+
+std::vector<std::string> Schema::decodeRecord(std::string_view record,
+    const FetchExternal& fetch, const std::vector<bool>& needed) const
+{
+    std::vector<std::string> values;
+    decodeRecord(record, values, fetch, needed);
+    return values;
+}
+
+void Schema::decodeRecord(std::string_view record, std::vector<std::string>& values,
+    const FetchExternal& fetch, const std::vector<bool>& needed) const
+{
+    values.resize(fields.size());
+    for (std::size_t i = 0; i < fields.size(); ++i) {
+        const Field& f = fields[i];
+        if (!needed.empty() && (i >= needed.size() || !needed[i])) {
+            values[i].clear();
+        }
+        else if (!isExternal(f, record)) {
+            decodeValue(f, valueOf(f, record), values[i]);
+        }
+        else if (fetch) {
+            values[i] = fetch(externalRef(f, record));
+        }
+        else {
+            values[i].clear();
+        }
+    }
+}
+
+std::string_view Schema::valueOf(const Field& f, std::string_view record) {
+    if (f.kind != Kind::Char) return record.substr(f.offset, f.length);
+    uint16_t entry[2];
+    std::memcpy(entry, record.data() + f.offset, sizeof(entry));
+    return record.substr(entry[0], entry[1] == EXTERNAL ? sizeof(ExternalRef) : entry[1]);
+}
+
+bool Schema::isExternal(const Field& f, std::string_view record) {
+    return f.kind == Kind::Char
+        && load<uint16_t>(record.data() + f.offset + sizeof(uint16_t)) == EXTERNAL;
+}
+
+Schema::ExternalRef Schema::externalRef(const Field& f, std::string_view record) {
+    return load<ExternalRef>(valueOf(f, record).data());
+}
+
+int Schema::compareValues(const Field& f, std::string_view a, std::string_view b) {
+    switch (f.kind) {
+    case Kind::Int32:  return threeWay(load<int32_t>(a.data()), load<int32_t>(b.data()));
+    case Kind::Int64:  return threeWay(load<int64_t>(a.data()), load<int64_t>(b.data()));
+    case Kind::Double: return threeWay(load<double>(a.data()), load<double>(b.data()));
+    case Kind::Char: {
+        int cmp = a.compare(b);
+        return (cmp > 0) - (cmp < 0);
+    }
+    }
+    return 0;
+}
+
+std::string Schema::canonical(const Field& f, const std::string& value) {
+    std::string bytes;
+    if (!encodeValue(f, value, bytes)) return value;
+    return decodeValue(f, bytes);
+}
+
+bool Schema::encodeKey(const Field& f, const std::string& value, std::string& key) {
+    if (!encodeValue(f, value, key)) return false;
+    uint64_t bits = 0;
+    switch (f.kind) {
+    case Kind::Int32:
+        bits = static_cast<uint32_t>(load<int32_t>(key.data())) ^ SIGN_32;
+        break;
+    case Kind::Int64:
+        bits = static_cast<uint64_t>(load<int64_t>(key.data())) ^ SIGN_64;
+        break;
+    case Kind::Double: {
+        double v = load<double>(key.data());
+        if (v == 0) v = 0;  // -0 and 0 are one key, as they compare equal
+        std::memcpy(&bits, &v, sizeof(bits));
+        bits = (bits & SIGN_64) ? ~bits : bits ^ SIGN_64;
+        break;
+    }
+    case Kind::Char:
+        return true;
+    }
+    for (std::size_t i = key.size(); i-- > 0; bits >>= 8) key[i] = static_cast<char>(bits & 0xFF);
+    return true;
+}
+
+std::string Schema::decodeKey(const Field& f, std::string_view key) {
+    if (f.kind == Kind::Char || key.size() != static_cast<std::size_t>(f.length)) {
+        return std::string(key);
+    }
+    uint64_t bits = 0;
+    for (char c : key) bits = bits << 8 | static_cast<uint8_t>(c);
+    char bytes[sizeof(uint64_t)];
+    switch (f.kind) {
+    case Kind::Int32: {
+        int32_t v = static_cast<int32_t>(static_cast<uint32_t>(bits) ^ SIGN_32);
+        std::memcpy(bytes, &v, sizeof(v));
+        break;
+    }
+    case Kind::Int64: {
+        int64_t v = static_cast<int64_t>(bits ^ SIGN_64);
+        std::memcpy(bytes, &v, sizeof(v));
+        break;
+    }
+    default:
+        bits = (bits & SIGN_64) ? bits ^ SIGN_64 : ~bits;
+        std::memcpy(bytes, &bits, sizeof(bits));
+        break;
+    }
+    return decodeValue(f, std::string_view(bytes, f.length));
+}
@@ -1,28 +1,147 @@
 #pragma once
+#include <cstdint>
+#include <functional>
 #include <string>
+#include <string_view>
 #include <vector>
 
+/// Column names, types and unique keys of a table, as kept in meta.txt.
+///
+/// Records are stored in binary, in two parts.  The fixed part has one
+/// entry per field, at the field's `offset`: numbers in native byte order
+/// (int: int32, bigint: int64, double: IEEE double), text as the u16
+/// (offset, length) of its bytes in the variable part that follows.  Text
+/// takes only its own length, up to the field's `length` (string: 16 MB,
+/// char(N): N).  Values cross the rest of the engine as text, so
+/// encodeValue/decodeValue are the only places that convert between the two.
+///
+/// Text longer than INLINE_LIMIT is kept out of line (see OverflowFile):
+/// its entry's length is EXTERNAL and its bytes in the variable part are
+/// the u32 first page and u32 length of the overflow chain holding it.
 class Schema {
 public:
+    enum class Kind { Int32, Int64, Double, Char };
+
+    /// How data.tbl lays out its pages: Row keeps each record whole in a
+    /// slotted page (HeapPage), Pax splits every page into one minipage per
+    /// column (PaxPage), so a scan of a few columns touches only their bytes.
+    /// Chosen with CREATE TABLE ... USING PAX; a Pax table's meta.txt has
+    /// a third line, "pax".
+    enum class Storage { Row, Pax };
+
+    /// Longest text kept in the row itself.
+    static constexpr int INLINE_LIMIT = 256;
+
+    /// Fixed-part length marking an out-of-line value.
+    static constexpr int EXTERNAL = 0xFFFF;
+
+    /// Where an out-of-line value lives.
+    struct ExternalRef {
+        uint32_t firstPage;
+        uint32_t length;
+    };
+
+    /// Stores a value longer than INLINE_LIMIT; returns its first page.
+    using StoreExternal = std::function<uint32_t(std::string_view bytes)>;
+
+    /// Reads an out-of-line value back.
+    using FetchExternal = std::function<std::string(const ExternalRef& ref)>;
+
     struct Field {
-        std::string type;
+        std::string type;    // as declared: int, bigint, double, string or char(N)
         std::string name;
-        int length;  // Only used for strings
+        int length;          // most bytes a value takes
+        int offset;          // of its fixed-part entry, from the start of the record
+        Kind kind;
     };
 
-    Schema(const std::string& schemaStr, const std::string& uniqueKeysStr);
+    /// storageStr: the third meta.txt line, "pax" or "row" (also when empty).
+    Schema(const std::string& schemaStr, const std::string& uniqueKeysStr,
+        const std::string& storageStr = "");
     void saveToFile(const std::string& path);
     std::vector<Field> getFields() const;
     std::vector<std::string> getUniqueKeys() const;
 
-    int getRecordSize() const {
-        int sum = 0;
-        for (auto& f : fields) sum += f.length;
-        return sum;
-    }
+    /// Index structure of a unique key: "btree" (the default), "hash" or
+    /// "art" (in memory only).  Chosen in the keys line of meta.txt by
+    /// writing "name:hash" or "name:art".
+    std::string getIndexType(const std::string& key) const;
+
+    /// Columns stored in the leaves of a unique key's index next to the key
+    /// (a covering index), written "name+col1+col2" in meta.txt.  Empty if none.
+    std::vector<std::string> getIncludedColumns(const std::string& key) const;
+
+    Storage getStorage() const;
+
+    /// Bytes of a record's fixed part; every record is at least this long.
+    int getFixedSize() const;
+
+    /// Bytes of f's fixed-part entry: the value for a number, the u16
+    /// (offset, length) for text.
+    static int fixedWidth(const Field& f);
+
+    /// The stored bytes of `value` in f: a native number, or the text cut to
+    /// f.length.  Returns false if a number column gets text that is not a
+    /// number of its type (e.g. "12abc", "1.5" for an int, or out of range).
+    static bool encodeValue(const Field& f, const std::string& value, std::string& bytes);
+
+    /// The text of stored bytes from encodeValue or valueOf.
+    static std::string decodeValue(const Field& f, std::string_view bytes);
+
+    /// decodeValue into `text`, reusing its buffer.
+    static void decodeValue(const Field& f, std::string_view bytes, std::string& text);
+
+    /// Encode one value per field into `record`, handing text longer than
+    /// INLINE_LIMIT to `store` if one is given.  Returns false on a wrong
+    /// value count, a value encodeValue rejects or a record over 64 KB.
+    bool encodeRecord(const std::vector<std::string>& values, std::string& record,
+        const StoreExternal& store = nullptr) const;
+
+    /// Every field of a record, as text.  Only the positions set in `needed`
+    /// (all if it is empty) are decoded; the others come back empty.
+    /// Out-of-line values are read with `fetch`, and without it come back
+    /// empty too.
+    std::vector<std::string> decodeRecord(std::string_view record,
+        const FetchExternal& fetch = nullptr, const std::vector<bool>& needed = {}) const;
+
+    /// decodeRecord into `values`, reusing the strings already there, so a
+    /// scan that decodes row after row into the same vector stops allocating
+    /// once its buffers have grown to the widest values.
+    void decodeRecord(std::string_view record, std::vector<std::string>& values,
+        const FetchExternal& fetch = nullptr, const std::vector<bool>& needed = {}) const;
+
+    /// The stored bytes of f inside `record`, without copying; for an
+    /// out-of-line value, the bytes of its ExternalRef.
+    static std::string_view valueOf(const Field& f, std::string_view record);
+
+    /// True if f's value in `record` is kept out of line.
+    static bool isExternal(const Field& f, std::string_view record);
+
+    /// The overflow chain of an out-of-line value.
+    static ExternalRef externalRef(const Field& f, std::string_view record);
+
+    /// Three-way comparison of two stored values of f: numbers by value,
+    /// text byte-wise.
+    static int compareValues(const Field& f, std::string_view a, std::string_view b);
+
+    /// The text `value` reads back as once stored in f (e.g. "007" -> "7",
+    /// a long string cut to its length), or `value` itself if f would reject it.
+    static std::string canonical(const Field& f, const std::string& value);
+
+    /// The index key of `value` in f: text is its own key; a number is its
+    /// stored value big-endian with the sign bit flipped (a negative double
+    /// has every bit flipped instead), so keys compare byte-wise in numeric
+    /// order and a B+ tree range or leaf walk comes out in number order.
+    /// Returns false where encodeValue would.
+    static bool encodeKey(const Field& f, const std::string& value, std::string& key);
 
+    /// The text of a key from encodeKey.
+    static std::string decodeKey(const Field& f, std::string_view key);
 
 private:
     std::vector<Field> fields;
     std::vector<std::string> uniqueKeys;
+    std::vector<std::string> indexTypes;  // parallel to uniqueKeys
+    std::vector<std::vector<std::string>> includes;  // parallel to uniqueKeys
+    Storage storage = Storage::Row;
 };
@@ -0,0 +1,147 @@
+#include "table_handle.h"
+#include "heap_page.h"
+
+#include <algorithm>
+#include <fstream>
+#include <unordered_map>
+
+namespace {
+
+    std::mutex registryMtx;
+    std::unordered_map<std::string, std::shared_ptr<TableHandle>> registry;
+}
+
+TableHandle::TableHandle(const std::string& tableName, const Schema& tableSchema, BufferManager& bm)
+    : name(tableName),
+    path("Tables/" + tableName),
+    dataFile("Tables/" + tableName + "/data.tbl"),
+    schema(tableSchema),
+    fields(tableSchema.getFields()),
+    uniqueKeys(tableSchema.getUniqueKeys()),
+    indexes(tableName, "Tables/" + tableName, bm),
+    freeSpace("Tables/" + tableName, bm),
+    zones("Tables/" + tableName, fields, bm),
+    overflow("Tables/" + tableName, bm)
+{
+    indexes.loadIndexes(uniqueKeys);
+    freeSpace.load();
+
+    // pages without a zone (all of them, for a table from before zone maps)
+    // get one from their rows
+    std::ifstream data(dataFile, std::ios::binary | std::ios::ate);
+    const uint32_t dataPages = data ? static_cast<uint32_t>(data.tellg() / HeapPage::PAGE_SIZE) : 0;
+    for (uint32_t pid = zones.load(); pid < dataPages; ++pid) {
+        char* buf = bm.getPage(dataFile, pid, PageType::DATA);
+        if (!buf) break;
+        zones.update(pid, page(buf));
+        bm.unpinPage(dataFile, pid, PageType::DATA, false);
+    }
+}
+
+bool TableHandle::isUnique(const std::string& field) const {
+    return std::find(uniqueKeys.begin(), uniqueKeys.end(), field) != uniqueKeys.end();
+}
+
+std::string TableHandle::keyOf(const std::string& field, const std::string& value) const {
+    for (const auto& f : fields) {
+        if (f.name == field) return Schema::canonical(f, value);
+    }
+    return value;
+}
+
+bool TableHandle::encode(const std::vector<std::string>& values, std::string& record) {
+    std::vector<uint32_t> chains;
+    bool ok = schema.encodeRecord(values, record, [&](std::string_view bytes) {
+        chains.push_back(overflow.write(bytes));
+        return chains.back();
+    });
+    ok = ok && record.size() <= HeapPage::MAX_RECORD_SIZE
+        && std::find(chains.begin(), chains.end(), 0u) == chains.end();
+    if (!ok) {
+        for (uint32_t first : chains) overflow.release(first);
+    }
+    return ok;
+}
+
+std::vector<std::string> TableHandle::decode(std::string_view record, const std::vector<bool>& needed) {
+    std::vector<std::string> values;
+    decode(record, values, needed);
+    return values;
+}
+
+void TableHandle::decode(std::string_view record, std::vector<std::string>& values,
+    const std::vector<bool>& needed)
+{
+    schema.decodeRecord(record, values, [this](const Schema::ExternalRef& ref) {
+        return overflow.read(ref.firstPage, ref.length);
+    }, needed);
+}
+
+void TableHandle::decode(const DataPage& page, int slot, std::vector<std::string>& values,
+    const std::vector<bool>& needed)
+{
+    values.resize(fields.size());
+    for (std::size_t i = 0; i < fields.size(); ++i) {
+        const Schema::Field& f = fields[i];
+        if (!needed.empty() && (i >= needed.size() || !needed[i])) {
+            values[i].clear();
+        }
+        else if (page.isExternal(f, slot)) {
+            Schema::ExternalRef ref = page.externalRef(f, slot);
+            values[i] = overflow.read(ref.firstPage, ref.length);
+        }
+        else {
+            Schema::decodeValue(f, page.value(f, slot), values[i]);
+        }
+    }
+}
+
+DataPage TableHandle::page(char* buf) const {
+    return DataPage(buf, schema.getStorage() == Schema::Storage::Pax ? &fields : nullptr);
+}
+
+std::string TableHandle::valueText(const Schema::Field& f, std::string_view record) {
+    if (Schema::isExternal(f, record)) {
+        Schema::ExternalRef ref = Schema::externalRef(f, record);
+        return overflow.read(ref.firstPage, ref.length);
+    }
+    return Schema::decodeValue(f, Schema::valueOf(f, record));
+}
+
+void TableHandle::releaseExternal(std::string_view record) {
+    if (record.empty()) return;
+    for (const auto& f : fields) {
+        if (Schema::isExternal(f, record)) overflow.release(Schema::externalRef(f, record).firstPage);
+    }
+}
+
+std::shared_ptr<TableHandle> TableHandle::open(const std::string& tableName, BufferManager& bm) {
+    std::lock_guard<std::mutex> guard(registryMtx);
+    if (auto it = registry.find(tableName); it != registry.end()) return it->second;
+
+    std::ifstream meta("Tables/" + tableName + "/meta.txt");
+    if (!meta) return nullptr;
+    std::string schemaStr, keysStr, storageStr;
+    std::getline(meta, schemaStr);
+    std::getline(meta, keysStr);
+    std::getline(meta, storageStr);
+    // Registered only once built: if Schema throws (say, an unknown type in
+    // meta.txt) nothing is left behind for the next open to find.
+    auto handle = std::make_shared<TableHandle>(tableName, Schema(schemaStr, keysStr, storageStr), bm);
+    registry.emplace(tableName, handle);
+    return handle;
+}
+
+void TableHandle::close(const std::string& tableName) {
+    std::shared_ptr<TableHandle> dropped;  // released outside the lock
+    std::lock_guard<std::mutex> guard(registryMtx);
+    auto it = registry.find(tableName);
+    if (it == registry.end()) return;
+    dropped = std::move(it->second);
+    registry.erase(it);
+}
+
+void TableHandle::closeAll() {
+    std::lock_guard<std::mutex> guard(registryMtx);
+    registry.clear();
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include "schema.h"
+#include "index_manager.h"
+#include "free_space_manager.h"
+#include "overflow_file.h"
+#include "zone_map.h"
+#include "data_page.h"
+#include "BufferManager.h"
+
+/// One open table: its schema, the index of every unique key, its
+/// free-space map, its zone map, its overflow file and the BufferManager
+/// file ID of its data file.
+///
+/// Handles are opened on first use and kept for the life of the process,
+/// so a statement no longer rereads meta.txt, reopens each index and
+/// reloads free_space.meta.  The SQL executor, the CLI RecordManager and
+/// TransactionController share them.  Creating or deleting a table drops
+/// its handle; statements already holding it finish on the old one.
+struct TableHandle {
+    const std::string                name;        // e.g. "users"
+    const std::string                path;        // e.g. "Tables/users"
+    const std::string                dataFile;    // BufferManager file ID of data.tbl
+    const Schema                     schema;
+    const std::vector<Schema::Field> fields;
+    const std::vector<std::string>   uniqueKeys;
+
+    /// Every unique key's index.  Safe to share: each index locks itself.
+    IndexManager                     indexes;
+
+    /// Loaded once from free_space.meta and written through on every
+    /// change.  Hold freeSpaceMtx while using it.
+    FreeSpaceManager                 freeSpace;
+    std::mutex                       freeSpaceMtx;
+
+    /// Per-page min/max of the number columns, updated with freeSpace
+    /// wherever a page changes.  Locks itself, so scans read it unlocked.
+    ZoneMap                          zones;
+
+    /// Held shared by everything that finds a row by its record ID or keeps
+    /// one (scans, lookups, inserts, deletes, updates), so the ID stays the
+    /// row's until it lets go, and by index-only reads, which would miss a
+    /// row whose keys are out of the index mid-move; VACUUM holds it
+    /// exclusively while it moves rows.  Take it before freeSpaceMtx.
+    std::shared_mutex                rowsMtx;
+
+    /// Text values longer than Schema::INLINE_LIMIT.  Locks itself.
+    OverflowFile                     overflow;
+
+    TableHandle(const std::string& tableName, const Schema& tableSchema, BufferManager& bm);
+
+    /// True if `field` is one of the table's unique keys.
+    bool isUnique(const std::string& field) const;
+
+    /// `value` as `field` holds it once stored, and so as its index reads
+    /// back (see Schema::canonical); `value` itself for an unknown field.
+    std::string keyOf(const std::string& field, const std::string& value) const;
+
+    /// Encode a row as data.tbl stores it, long text going to the overflow
+    /// file.  Returns false, leaving nothing behind, if a value is rejected
+    /// or the record does not fit a page.
+    bool encode(const std::vector<std::string>& values, std::string& record);
+
+    /// A stored record as text, only the positions set in `needed` (all if
+    /// empty) filled in; see Schema::decodeRecord.
+    std::vector<std::string> decode(std::string_view record, const std::vector<bool>& needed = {});
+
+    /// decode into `values`, reusing its strings.
+    void decode(std::string_view record, std::vector<std::string>& values,
+        const std::vector<bool>& needed = {});
+
+    /// decode the row in a live `slot` of `page` straight from the page,
+    /// reading only the needed columns' bytes (of a Pax page, only their
+    /// minipages).
+    void decode(const DataPage& page, int slot, std::vector<std::string>& values,
+        const std::vector<bool>& needed = {});
+
+    /// A pinned data.tbl page of this table, in its layout.
+    DataPage page(char* buf) const;
+
+    /// The text of one field of a stored record.
+    std::string valueText(const Schema::Field& f, std::string_view record);
+
+    /// Free the overflow chains of a record leaving data.tbl.
+    void releaseExternal(std::string_view record);
+
+    /// The handle of `tableName`, opened on first use; nullptr if the table
+    /// has no meta.txt.
+    static std::shared_ptr<TableHandle> open(const std::string& tableName, BufferManager& bm);
+
+    /// Drop the cached handle of `tableName`; the next open rereads everything.
+    static void close(const std::string& tableName);
+
+    /// Drop every handle, so index headers are written back.  Call at
+    /// shutdown, before the final flush.
+    static void closeAll();
+};
@@ -3,17 +3,56 @@
 #include "record_manager.h"
 #include "index_manager.h"
 #include "free_space_manager.h"
+#include "table_handle.h"
+#include "vacuum.h"
 
 #include <iostream>
 #include <filesystem>
 #include <fstream>
 #include <limits>
+#include <memory>
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
 
 namespace fs = std::filesystem;
 
 // Define the static BufferManager* member:
 BufferManager* TableManager::bufMgr = nullptr;
 
+namespace {
+
+    /// INCLUDE columns must exist, belong to a B+ tree key, and fit in the
+    /// payload a leaf entry can carry.  Throws std::runtime_error otherwise.
+    void checkIncludes(const Schema& schema) {
+        auto fields = schema.getFields();
+        for (const auto& key : schema.getUniqueKeys()) {
+            auto cols = schema.getIncludedColumns(key);
+            if (cols.empty()) continue;
+            if (schema.getIndexType(key) != "btree") {
+                std::string type = schema.getIndexType(key);
+                std::transform(type.begin(), type.end(), type.begin(),
+                    [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+                throw std::runtime_error("INCLUDE needs a B+ tree index; '" + key + "' uses " + type);
+            }
+            int width = 0;
+            for (const auto& col : cols) {
+                auto f = std::find_if(fields.begin(), fields.end(),
+                    [&](const Schema::Field& sf) { return sf.name == col; });
+                if (f == fields.end()) {
+                    throw std::runtime_error("INCLUDE column '" + col + "' is not in the table");
+                }
+                width += f->length;
+            }
+            if (width > BPlusTree::MAX_PAYLOAD_SIZE) {
+                throw std::runtime_error("INCLUDE columns of '" + key + "' need "
+                    + std::to_string(width) + " bytes, more than "
+                    + std::to_string(BPlusTree::MAX_PAYLOAD_SIZE));
+            }
+        }
+    }
+}
+
 void TableManager::createTable() {
     if (!bufMgr) {
         std::cerr << "[createTable] ERROR: BufferManager not set.\n";
@@ -39,10 +78,19 @@ void TableManager::createTable() {
         return;
     }
 
+    std::unique_ptr<Schema> parsed;
+    try {
+        parsed = std::make_unique<Schema>(schemaInput, keys);
+        checkIncludes(*parsed);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "[createTable] " << e.what() << "\n";
+        return;
+    }
+    Schema& schema = *parsed;
  
     fs::create_directories(tablePath);
 
-    Schema schema(schemaInput, keys);
     schema.saveToFile(tablePath + "/meta.txt");
 
    
@@ -52,17 +100,12 @@ void TableManager::createTable() {
     }
 
  
-    int recordSize = 0;
-    for (auto& f : schema.getFields()) {
-        recordSize += f.length;
-    }
-
-    FreeSpaceManager fsm(tablePath, recordSize, *bufMgr);
+    FreeSpaceManager fsm(tablePath, *bufMgr);
     fsm.initialize();
 
 
-    IndexManager idxMgr(tableName, tablePath, *bufMgr);
-    idxMgr.loadIndexes(schema.getUniqueKeys());
+    // Opening the table creates its (empty) indexes and caches the handle.
+    TableHandle::open(tableName, *bufMgr);
 
 
     std::cout << "Table '" << tableName << "' created successfully.\n";
@@ -137,14 +180,24 @@ void TableManager::deleteTable() {
         return;
     }
 
+    // Nothing cached for the old files may outlive them: a table created
+    // again under the same name would read the old pages and index roots.
+    // A VACUUM step still running could dirty pages again, so it goes first.
+    Vacuum::forget(tableName);
+    TableHandle::close(tableName);
+    BPlusTree::forget(tablePath);
+    if (bufMgr) bufMgr->discardDirectory(tablePath);
     fs::remove_all(tablePath);
+    ArtIndex::forget(tablePath);
+    HashIndex::forget(tablePath);
     std::cout << "Table '" << tableName << "' deleted.\n";
 }
 
 void TableManager::createTable(
     const std::string& tableName,
     const std::string& schemaInput,
-    const std::string& keys
+    const std::string& keys,
+    const std::string& storage
 ) {
     if (!bufMgr) {
         std::cerr << "[createTable] ERROR: BufferManager not set.\n";
@@ -155,11 +208,12 @@ void TableManager::createTable(
     if (fs::exists(tablePath)) {
         throw std::runtime_error("Table '" + tableName + "' already exists.");
     }
+    Schema schema(schemaInput, keys, storage);
+    checkIncludes(schema);
 
     fs::create_directories(tablePath);
 
     // 1) write meta.txt
-    Schema schema(schemaInput, keys);
     schema.saveToFile(tablePath + "/meta.txt");
 
     // 2) create empty data file
@@ -168,14 +222,11 @@ void TableManager::createTable(
     }
 
     // 3) initialize free‑space
-    int recordSize = 0;
-    for (auto& f : schema.getFields()) recordSize += f.length;
-    FreeSpaceManager fsm(tablePath, recordSize, *bufMgr);
+    FreeSpaceManager fsm(tablePath, *bufMgr);
     fsm.initialize();
 
-    // 4) initialize indexes (empty)
-    IndexManager idxMgr(tableName, tablePath, *bufMgr);
-    idxMgr.loadIndexes(schema.getUniqueKeys());
+    // 4) open the table: creates the (empty) indexes and caches the handle
+    TableHandle::open(tableName, *bufMgr);
 
     std::cout << "[EXEC] Table '" << tableName << "' created.\n";
 }
\ No newline at end of file
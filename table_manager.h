@@ -29,11 +29,12 @@ public:
     ///   5) Exit
     static void useTable();
 
+    /// storageStr: "pax" for a Pax table (see Schema::Storage), else "".
     static void createTable(
         const std::string& tableName,
         const std::string& schemaStr,
-        const std::string& keysStr
-		
+        const std::string& keysStr,
+        const std::string& storageStr = ""
     );
 
 
@@ -2,6 +2,7 @@
 #include <string>
 #include <vector>
 #include <utility>
+#include <cstdint>
 
 namespace Utils {
     std::string trim(const std::string& str);
@@ -12,4 +13,12 @@ namespace Utils {
     bool fileExists(const std::string& path);
     bool folderExists(const std::string& path);
     void createFolder(const std::string& path);
+
+    /// FNV-1a over the key's bytes.  Spelled out rather than taken from
+    /// std::hash because on-disk structures (Bloom filters, hash indexes)
+    /// depend on it staying the same across compilers and library versions.
+    uint64_t fnv1a(const std::string& key);
+
+    /// splitmix64 finalizer: spreads every input bit over the whole word.
+    uint64_t mixHash(uint64_t x);
 }
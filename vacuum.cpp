@@ -0,0 +1,111 @@
+#include "vacuum.h"
+#include "record_manager_sql.h"
+#include "record_manager.h"
+#include "table_handle.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+    /// The queue and its worker.  A function-local static, so it is built
+    /// after the BufferManager the worker uses and torn down (worker
+    /// stopped) before it.
+    struct Worker {
+        std::mutex              mtx;
+        std::condition_variable wake;
+        std::condition_variable stepped;   // a step just ended
+        std::deque<std::string> queue;     // tables waiting their turn
+        std::string             current;   // the table being compacted; "" once forgotten
+        std::string             stepping;  // the table a step is running on, or ""
+        bool                    stopping = false;
+        std::thread             thread;
+
+        ~Worker() { stop(); }
+
+        void stop() {
+            {
+                std::lock_guard<std::mutex> guard(mtx);
+                stopping = true;
+                queue.clear();
+            }
+            wake.notify_all();
+            if (thread.joinable()) thread.join();
+            current.clear();
+            stopping = false;
+        }
+
+        void run() {
+            std::unique_lock<std::mutex> lock(mtx);
+            for (;;) {
+                wake.wait(lock, [this] { return stopping || !queue.empty(); });
+                if (stopping) return;
+                current = queue.front();
+                queue.pop_front();
+                const std::string table = current;
+                long moved = 0, freed = 0;
+                for (;;) {
+                    stepping = table;
+                    lock.unlock();
+                    long stepMoved = 0, stepFreed = 0;
+                    VacuumResult r = RecordManagerSQL::vacuumStep(table, Vacuum::STEP_ROWS,
+                        stepMoved, stepFreed);
+                    moved += stepMoved;
+                    freed += stepFreed;
+                    lock.lock();
+                    stepping.clear();
+                    stepped.notify_all();
+                    if (stopping) return;
+                    if (current.empty() || r == VacuumResult::Done || r == VacuumResult::Missing) break;
+                    if (wake.wait_for(lock, Vacuum::PAUSE,
+                        [this] { return stopping || current.empty(); })) {
+                        if (stopping) return;
+                        break;
+                    }
+                }
+                if (!current.empty()) {
+                    std::cout << "[VACUUM] " << table << ": moved " << moved << " rows, freed "
+                        << freed << " pages\n";
+                }
+                current.clear();
+            }
+        }
+    };
+
+    Worker& worker() {
+        static Worker w;
+        return w;
+    }
+}
+
+bool Vacuum::start(const std::string& tableName) {
+    if (!TableHandle::open(tableName, *RecordManager::bufMgr)) return false;
+    Worker& w = worker();
+    std::lock_guard<std::mutex> guard(w.mtx);
+    if (w.current != tableName
+        && std::find(w.queue.begin(), w.queue.end(), tableName) == w.queue.end()) {
+        w.queue.push_back(tableName);
+    }
+    if (!w.thread.joinable()) w.thread = std::thread(&Worker::run, &w);
+    w.wake.notify_all();
+    return true;
+}
+
+void Vacuum::forget(const std::string& tableName) {
+    Worker& w = worker();
+    std::unique_lock<std::mutex> lock(w.mtx);
+    w.queue.erase(std::remove(w.queue.begin(), w.queue.end(), tableName), w.queue.end());
+    if (w.current == tableName) {
+        w.current.clear();
+        w.wake.notify_all();
+    }
+    w.stepped.wait(lock, [&] { return w.stepping != tableName; });
+}
+
+void Vacuum::stop() {
+    worker().stop();
+}
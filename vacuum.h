@@ -0,0 +1,31 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+/// VACUUM in the background.  Tables handed to start() are compacted one
+/// after another by a single worker thread, in steps of STEP_ROWS rows (see
+/// RecordManagerSQL::vacuumStep) with a PAUSE after each, so statements on
+/// the table wait at most one short step, and only when they start during
+/// one.  A step that finds the table in use is tried again after the pause.
+/// Every step leaves the table whole, so stopping between steps is safe.
+class Vacuum {
+public:
+    static constexpr std::size_t STEP_ROWS = 512;
+    static constexpr std::chrono::milliseconds PAUSE{ 20 };
+
+    /// Queue `tableName` for compaction, starting the worker if it is not
+    /// running.  Returns false if there is no such table; a table already
+    /// queued is not queued twice.
+    static bool start(const std::string& tableName);
+
+    /// Take `tableName` off the queue and stop compacting it, returning only
+    /// once no step on it is running.  Call before deleting the table, so no
+    /// step dirties its pages after they are discarded.
+    static void forget(const std::string& tableName);
+
+    /// Stop the worker after its current step and drop the queue.  Call at
+    /// shutdown, before TableHandle::closeAll.
+    static void stop();
+};
@@ -0,0 +1,126 @@
+#include "zone_map.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+    // Entry states
+    constexpr char ZONE_NONE = 0;    // never written: the page must be read
+    constexpr char ZONE_EMPTY = 1;
+    constexpr char ZONE_ROWS = 2;
+}
+
+ZoneMap::ZoneMap(const std::string& tablePath, const std::vector<Schema::Field>& fields,
+    BufferManager& bm)
+    : metaPath(tablePath + "/zone_map.meta"),
+    bufferManager(bm),
+    fields(fields),
+    bounds(fields.size(), -1)
+{
+    // every number column, as long as an entry still fits a meta page
+    for (std::size_t i = 0; i < fields.size(); ++i) {
+        const int width = Schema::fixedWidth(fields[i]);
+        if (!FilterKernel::supports(fields[i].kind) || entrySize + 2 * width > PAGE_SIZE) continue;
+        bounds[i] = entrySize;
+        entrySize += 2 * width;
+    }
+    entriesPerPage = PAGE_SIZE / entrySize;
+}
+
+uint32_t ZoneMap::load() {
+    std::lock_guard<std::mutex> guard(mtx);
+    entries.clear();
+    bool more = true;
+    for (uint32_t pageNum = 0; more; ++pageNum) {
+        char* pageBuf = bufferManager.getPage(metaPath, pageNum, PageType::META);
+        if (!pageBuf) {
+            std::cerr << "ZoneMap::load: Cannot pin meta page " << pageNum << "\n";
+            break;
+        }
+        for (int i = 0; i < entriesPerPage && more; ++i) {
+            const char* e = pageBuf + i * entrySize;
+            more = *e != ZONE_NONE;
+            if (more) entries.insert(entries.end(), e, e + entrySize);
+        }
+        bufferManager.unpinPage(metaPath, pageNum, PageType::META, false);
+    }
+    return static_cast<uint32_t>(entries.size() / entrySize);
+}
+
+void ZoneMap::update(uint32_t pageId, const DataPage& page) {
+    // computed before taking the lock: the caller holds the page still
+    std::vector<char> zone(entrySize, 0);
+    zone[0] = ZONE_EMPTY;
+    for (int s = 0; s < page.slotCount(); ++s) {
+        if (!page.live(s)) continue;
+        const bool first = zone[0] == ZONE_EMPTY;
+        zone[0] = ZONE_ROWS;
+        for (std::size_t i = 0; i < fields.size(); ++i) {
+            if (bounds[i] < 0) continue;
+            const Schema::Field& f = fields[i];
+            const std::string_view v = page.value(f, s);
+            char* lo = &zone[bounds[i]];
+            char* hi = lo + v.size();
+            if (first || Schema::compareValues(f, v, { lo, v.size() }) < 0) std::memcpy(lo, v.data(), v.size());
+            if (first || Schema::compareValues(f, v, { hi, v.size() }) > 0) std::memcpy(hi, v.data(), v.size());
+        }
+    }
+
+    std::lock_guard<std::mutex> guard(mtx);
+    const std::size_t at = static_cast<std::size_t>(pageId) * entrySize;
+    if (entries.size() < at + entrySize) entries.resize(at + entrySize, ZONE_NONE);
+    std::memcpy(&entries[at], zone.data(), entrySize);
+    writeEntry(pageId);
+}
+
+bool ZoneMap::mayMatch(uint32_t pageId, std::size_t column, FilterKernel::Op op,
+    std::string_view operand) const
+{
+    if (column >= fields.size() || bounds[column] < 0) return true;
+    const Schema::Field& f = fields[column];
+    const std::size_t width = static_cast<std::size_t>(Schema::fixedWidth(f));
+
+    std::lock_guard<std::mutex> guard(mtx);
+    const std::size_t at = static_cast<std::size_t>(pageId) * entrySize;
+    if (at + entrySize > entries.size() || entries[at] == ZONE_NONE) return true;
+    if (entries[at] == ZONE_EMPTY) return false;
+    const std::string_view lo(&entries[at + bounds[column]], width);
+    const std::string_view hi(lo.data() + width, width);
+    switch (op) {
+    case FilterKernel::Op::Eq: return Schema::compareValues(f, lo, operand) <= 0
+        && Schema::compareValues(f, hi, operand) >= 0;
+    case FilterKernel::Op::Ne: return Schema::compareValues(f, lo, operand) != 0
+        || Schema::compareValues(f, hi, operand) != 0;
+    case FilterKernel::Op::Lt: return Schema::compareValues(f, lo, operand) < 0;
+    case FilterKernel::Op::Le: return Schema::compareValues(f, lo, operand) <= 0;
+    case FilterKernel::Op::Gt: return Schema::compareValues(f, hi, operand) > 0;
+    case FilterKernel::Op::Ge: return Schema::compareValues(f, hi, operand) >= 0;
+    }
+    return true;
+}
+
+void ZoneMap::truncate(uint32_t count) {
+    std::lock_guard<std::mutex> guard(mtx);
+    const std::size_t keep = static_cast<std::size_t>(count) * entrySize;
+    if (entries.size() <= keep) return;
+    std::fill(entries.begin() + keep, entries.end(), ZONE_NONE);
+    const uint32_t total = static_cast<uint32_t>(entries.size() / entrySize);
+    for (uint32_t pageId = count; pageId < total; ++pageId) writeEntry(pageId);
+    entries.resize(keep);
+}
+
+/// Write entries[pageId] into its slot of zone_map.meta: one entry copied,
+/// one meta page dirtied.
+void ZoneMap::writeEntry(uint32_t pageId) const {
+    const uint32_t pageNum = pageId / entriesPerPage;
+    char* pageBuf = bufferManager.getPage(metaPath, pageNum, PageType::META);
+    if (!pageBuf) {
+        std::cerr << "ZoneMap::writeEntry: Cannot pin meta page " << pageNum << "\n";
+        return;
+    }
+    std::memcpy(pageBuf + (pageId % entriesPerPage) * entrySize,
+        &entries[static_cast<std::size_t>(pageId) * entrySize], entrySize);
+    bufferManager.unpinPage(metaPath, pageNum, PageType::META, true);
+}
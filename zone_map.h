@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "schema.h"
+#include "data_page.h"
+#include "filter_kernel.h"
+#include "BufferManager.h"
+
+/// zone_map.meta: for every data.tbl page, the smallest and largest value
+/// of each number column among its live rows, so a scan comparing such a
+/// column to a constant passes over pages that cannot hold a match without
+/// pinning them.  On columns whose values follow insertion order (an
+/// auto-increment ID, a timestamp) a range predicate then reads only the
+/// pages holding the range.
+///
+/// Entry i describes data page i: a state byte (0 never written, 1 no live
+/// row, 2 rows), then min and max in stored encoding (see Schema) of each
+/// tracked column, Schema::fixedWidth bytes each.  Text columns are
+/// variable-length and are not tracked.  Entries do not straddle meta
+/// pages.  A page's entry is recomputed from its rows whenever the page
+/// changes, at the same points as its free-space entry, and written back
+/// at once, so deletes narrow the bounds again.
+class ZoneMap {
+public:
+    static constexpr int PAGE_SIZE = 4096;
+
+    /// tablePath: the table directory (e.g. "Tables/users")
+    ZoneMap(const std::string& tablePath, const std::vector<Schema::Field>& fields,
+        BufferManager& bm);
+
+    /// Load the entries from zone_map.meta, up to the first never-written
+    /// one, and return how many there are: the pages after them have no
+    /// zone until update() gives them one.
+    uint32_t load();
+
+    /// Recompute pageId's zone from the live rows of `page` and write its
+    /// entry back, dirtying only the meta page that holds it.
+    void update(uint32_t pageId, const DataPage& page);
+
+    /// False if no live row of pageId can have fields[column] compare `op`
+    /// to `operand` (stored bytes); true if one may, or if the page or the
+    /// column has no zone.
+    bool mayMatch(uint32_t pageId, std::size_t column, FilterKernel::Op op,
+        std::string_view operand) const;
+
+    /// Forget pages `count` and after, as data.tbl is cut to `count` pages,
+    /// clearing their entries in zone_map.meta.
+    void truncate(uint32_t count);
+
+private:
+    std::string                 metaPath;        // e.g. "Tables/users/zone_map.meta"
+    BufferManager&              bufferManager;
+    std::vector<Schema::Field>  fields;
+    std::vector<int>            bounds;          // per field: offset of its min in an entry, -1 if untracked
+    int                         entrySize = 1;
+    int                         entriesPerPage = 0;
+    std::vector<char>           entries;         // entrySize bytes per page
+    mutable std::mutex          mtx;             // entries; a scan reads them while rows change
+
+    void writeEntry(uint32_t pageId) const;      // caller holds mtx
+};